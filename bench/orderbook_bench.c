@@ -0,0 +1,464 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/orderbook.h"
+#include "../src/histogram.h"
+#include "../src/order_protocol.h"
+#include "../src/market_data.h"
+#include "../src/quote_view.h"
+#include "../src/event_clock.h"
+#include "../src/risk_gate.h"
+#include "../src/stats.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//Benchmark operation types
+typedef enum {
+    BENCH_ADD,
+    BENCH_CANCEL,
+    BENCH_MODIFY,
+    BENCH_OP_TYPES
+} BenchOpType;
+
+static const char* bench_op_names[BENCH_OP_TYPES] = {"add", "cancel", "modify"};
+
+//One pre-generated operation; cancel/modify use order.id, quantity and price
+typedef struct {
+    BenchOpType type;
+    Order order;
+} BenchOp;
+
+//Benchmark settings
+typedef struct {
+    int operations;
+    int add_pct;
+    int cancel_pct;
+    Price mid;
+    int depth;              // Passive orders rest within this many ticks of the mid
+    int aggressive_pct;     // Share of adds priced through the mid
+    int max_quantity;
+    uint64_t seed;
+    const char* input_file;
+    const char* json_file;
+    const char* label;
+    bool protocol;          // Also time binary decoding of the stream
+    int market_data_depth;  // Publish L2/L3 updates for this many levels (0 = all), -1 for none
+    int quote_depth;        // Publish a quote view of this many levels to a reader thread, 0 for none
+    bool risk;              // Check every add against risk limits it stays within
+    bool stats;             // Time every command's stages into engine stats
+} BenchConfig;
+
+//Reader thread polling the quote view while the book is driven
+typedef struct {
+    QuoteView* view;
+    int done;
+    uint64_t reads;
+} BenchQuoteReader;
+
+// xorshift64* generator, deterministic for a given seed
+static uint64_t bench_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Event clock in nanoseconds: the calibrated TSC when there is one, so
+// timing each call adds a few nanoseconds rather than a clock_gettime
+static uint64_t bench_now_ns(void) {
+    return event_clock_ns();
+}
+
+// Read the quote view as fast as possible, as a risk thread polling the top of book would
+static void* read_quotes(void* arg) {
+    BenchQuoteReader* reader = arg;
+    BookQuote quote;
+    while (!__atomic_load_n(&reader->done, __ATOMIC_ACQUIRE)) {
+        read_quote_view(reader->view, &quote);
+        reader->reads++;
+    }
+    return NULL;
+}
+
+// Generate a synthetic order stream around the mid price
+static BenchOp* generate_ops(const BenchConfig* config) {
+    BenchOp* ops = calloc((size_t)config->operations, sizeof(BenchOp));
+    if (ops == NULL) {
+        perror("Failed to allocate memory for benchmark operations");
+        return NULL;
+    }
+    
+    uint64_t state = config->seed ? config->seed : 1;
+    int adds = 0;
+    
+    for (int i = 0; i < config->operations; i++) {
+        BenchOp* op = &ops[i];
+        int roll = (int)(bench_random(&state) % 100);
+        strcpy(op->order.symbol, "BENCH");
+        op->order.quantity = 1 + (int)(bench_random(&state) % (uint64_t)config->max_quantity);
+        
+        if (adds == 0 || roll < config->add_pct) {
+            op->type = BENCH_ADD;
+            op->order.side = (bench_random(&state) & 1) ? BUY : SELL;
+            snprintf(op->order.id, MAX_ID_LENGTH, "%d", adds++);
+            
+            // Passive orders rest behind the mid, aggressive ones cross it
+            Price offset = 1 + (Price)(bench_random(&state) % (uint64_t)config->depth);
+            if ((int)(bench_random(&state) % 100) < config->aggressive_pct) {
+                offset = -offset;
+            }
+            op->order.price = (op->order.side == BUY) ? config->mid - offset : config->mid + offset;
+        } else {
+            // Target a recent order; some will already have filled
+            int window = (adds < 1000) ? adds : 1000;
+            int target = adds - 1 - (int)(bench_random(&state) % (uint64_t)window);
+            snprintf(op->order.id, MAX_ID_LENGTH, "%d", target);
+            
+            if (roll < config->add_pct + config->cancel_pct) {
+                op->type = BENCH_CANCEL;
+            } else {
+                op->type = BENCH_MODIFY;
+                Price offset = 1 + (Price)(bench_random(&state) % (uint64_t)config->depth);
+                op->order.price = (bench_random(&state) & 1) ? config->mid - offset : config->mid + offset;
+            }
+        }
+    }
+    return ops;
+}
+
+//Context for collecting CSV orders into the operation list
+typedef struct {
+    BenchOp* ops;
+    int count;
+    int capacity;
+} BenchLoad;
+
+// Append one CSV order as an add operation
+static void collect_csv_order(void* context, Order* order) {
+    BenchLoad* load = context;
+    if (load->count == load->capacity) {
+        int capacity = load->capacity ? load->capacity * 2 : 1024;
+        BenchOp* ops = realloc(load->ops, (size_t)capacity * sizeof(BenchOp));
+        if (ops == NULL) {
+            return;
+        }
+        load->ops = ops;
+        load->capacity = capacity;
+    }
+    load->ops[load->count].type = BENCH_ADD;
+    load->ops[load->count].order = *order;
+    load->count++;
+}
+
+// Encode the stream as binary frames and time decoding it; returns ns per message
+static double time_protocol_decode(const BenchOp* ops, int op_count) {
+    uint8_t* buffer = malloc((size_t)op_count * MSG_ORDER_SIZE);
+    if (buffer == NULL) {
+        perror("Failed to allocate memory for encoded messages");
+        return 0.0;
+    }
+    
+    size_t length = 0;
+    for (int i = 0; i < op_count; i++) {
+        OrderMessage message = {0};
+        message.type = (ops[i].type == BENCH_ADD) ? MSG_NEW_ORDER :
+                       (ops[i].type == BENCH_CANCEL) ? MSG_CANCEL : MSG_MODIFY;
+        message.side = ops[i].order.side;
+        message.order_id = strtoull(ops[i].order.id, NULL, 10);
+        message.price = ops[i].order.price;
+        message.quantity = ops[i].order.quantity;
+        length += encode_order_message(&message, buffer + length);
+    }
+    
+    // Fold the decoded fields into a checksum so the loop is not optimized away
+    uint64_t checksum = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t offset = 0; offset < length; ) {
+        OrderMessage message;
+        int size = decode_order_message(buffer + offset, length - offset, &message);
+        if (size <= 0) {
+            break;
+        }
+        checksum += message.order_id + (uint64_t)message.price;
+        offset += (size_t)size;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    
+    free(buffer);
+    printf("Protocol decode: %.1f ns/message (%zu bytes, checksum %llx)\n",
+           (double)elapsed / op_count, length, (unsigned long long)checksum);
+    return (double)elapsed / op_count;
+}
+
+// Print one latency row of the report table
+static void print_histogram_row(const char* name, const Histogram* histogram) {
+    printf("%-8s %10llu %8.0f %8llu %8llu %8llu %10llu\n", name,
+           (unsigned long long)histogram->count, histogram_mean(histogram),
+           (unsigned long long)histogram_percentile(histogram, 50.0),
+           (unsigned long long)histogram_percentile(histogram, 99.0),
+           (unsigned long long)histogram_percentile(histogram, 99.9),
+           (unsigned long long)histogram->max);
+}
+
+// Write one latency object of the JSON report
+static void write_histogram_json(FILE* json, const char* name, const Histogram* histogram, bool first) {
+    fprintf(json, "%s\"%s\":{\"count\":%llu,\"mean_ns\":%.1f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}",
+            first ? "" : ",", name, (unsigned long long)histogram->count, histogram_mean(histogram),
+            (unsigned long long)histogram_percentile(histogram, 50.0),
+            (unsigned long long)histogram_percentile(histogram, 99.0),
+            (unsigned long long)histogram_percentile(histogram, 99.9),
+            (unsigned long long)histogram->max);
+}
+
+static void print_usage(void) {
+    printf("Usage: orderbook_bench [options]\n"
+           "  --ops <n>           Operations to generate (default 1000000)\n"
+           "  --mix <a>/<c>/<m>   Add/cancel/modify percentages (default 60/30/10)\n"
+           "  --mid <price>       Mid price (default 100.00)\n"
+           "  --depth <ticks>     Passive price range around the mid (default 50)\n"
+           "  --aggressive <pct>  Share of adds that cross the mid (default 10)\n"
+           "  --max-qty <n>       Maximum order quantity (default 100)\n"
+           "  --seed <n>          Random seed (default 42)\n"
+           "  --input <file.csv>  Replay adds from an order CSV instead of generating\n"
+           "  --json <file>       Append results as one JSON line ('-' for stdout)\n"
+           "  --label <text>      Run label recorded in the JSON output\n"
+           "  --protocol          Also time decoding the stream as binary order-entry frames\n"
+           "  --md-depth <n>      Publish L2/L3 market data for the top n levels (0 = all) while timing\n"
+           "  --quote-depth <n>   Publish a top-n quote view read by another thread while timing\n"
+           "  --risk              Pass every add through a risk gate with limits it never hits\n"
+           "  --stats             Time the stages of every command into engine stats\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config = {1000000, 60, 30, 0, 50, 10, 100, 42, NULL, NULL, "default", false, -1, 0, false, false};
+    config.mid = price_from_double(100.0);
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--protocol") == 0) {
+            config.protocol = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--risk") == 0) {
+            config.risk = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--stats") == 0) {
+            config.stats = true;
+            continue;
+        }
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--help") == 0 || value == NULL) {
+            print_usage();
+            return (strcmp(argv[i], "--help") == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--ops") == 0) {
+            config.operations = atoi(value);
+        } else if (strcmp(argv[i], "--mix") == 0) {
+            int modify_pct;
+            if (sscanf(value, "%d/%d/%d", &config.add_pct, &config.cancel_pct, &modify_pct) != 3 ||
+                config.add_pct + config.cancel_pct + modify_pct != 100) {
+                fprintf(stderr, "Invalid mix: %s (percentages must sum to 100)\n", value);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--mid") == 0) {
+            config.mid = price_from_double(atof(value));
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            config.depth = atoi(value);
+        } else if (strcmp(argv[i], "--aggressive") == 0) {
+            config.aggressive_pct = atoi(value);
+        } else if (strcmp(argv[i], "--max-qty") == 0) {
+            config.max_quantity = atoi(value);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--input") == 0) {
+            config.input_file = value;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            config.json_file = value;
+        } else if (strcmp(argv[i], "--label") == 0) {
+            config.label = value;
+        } else if (strcmp(argv[i], "--md-depth") == 0) {
+            config.market_data_depth = atoi(value);
+        } else if (strcmp(argv[i], "--quote-depth") == 0) {
+            config.quote_depth = atoi(value);
+        } else {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+    
+    if (config.operations <= 0 || config.depth <= 0 || config.max_quantity <= 0) {
+        fprintf(stderr, "Operations, depth and max quantity must be positive\n");
+        return EXIT_FAILURE;
+    }
+    
+    // Build the operation stream before timing anything
+    BenchOp* ops;
+    int op_count;
+    if (config.input_file != NULL) {
+        BenchLoad load = {NULL, 0, 0};
+        if (read_orders_from_csv(config.input_file, collect_csv_order, &load) != 0 || load.count == 0) {
+            fprintf(stderr, "No orders loaded from %s\n", config.input_file);
+            free(load.ops);
+            return EXIT_FAILURE;
+        }
+        ops = load.ops;
+        op_count = load.count;
+    } else {
+        ops = generate_ops(&config);
+        op_count = config.operations;
+    }
+    if (ops == NULL) {
+        return EXIT_FAILURE;
+    }
+    
+    calibrate_event_clock();
+    double decode_ns = config.protocol ? time_protocol_decode(ops, op_count) : 0.0;
+    
+    // Size the book so that the pool never runs dry
+    int ladder_size = (config.depth * 4 > PRICE_LADDER_SIZE) ? config.depth * 4 : PRICE_LADDER_SIZE;
+    OrderBook* book = create_order_book_with_capacity("BENCH", (uint32_t)op_count + 1, ladder_size);
+    Histogram* histograms = malloc(BENCH_OP_TYPES * sizeof(Histogram));
+    if (book == NULL || histograms == NULL) {
+        fprintf(stderr, "Failed to set up benchmark\n");
+        free(ops);
+        free(histograms);
+        free_order_book(book);
+        return EXIT_FAILURE;
+    }
+    for (int t = 0; t < BENCH_OP_TYPES; t++) {
+        histogram_reset(&histograms[t]);
+    }
+    
+    // Updates are built but not written, so only publication cost is measured
+    MarketDataFeed* feed = NULL;
+    if (config.market_data_depth >= 0) {
+        feed = create_market_data_feed(NULL, config.market_data_depth, true, 0);
+        book->market_data = feed;
+    }
+    
+    // The reader spins on the view for the whole run, so its cost shows up in the timings
+    BenchQuoteReader reader = {NULL, 0, 0};
+    pthread_t reader_thread;
+    if (config.quote_depth > 0) {
+        reader.view = create_quote_view(config.quote_depth);
+        if (reader.view == NULL || pthread_create(&reader_thread, NULL, read_quotes, &reader) != 0) {
+            fprintf(stderr, "Failed to start quote reader\n");
+            free_quote_view(reader.view);
+            reader.view = NULL;
+        } else {
+            attach_quote_view(book, reader.view);
+        }
+    }
+    
+    // Every rule is switched on, so each add pays for the full check
+    RiskGate* gate = NULL;
+    if (config.risk) {
+        RiskLimits limits = {config.max_quantity, INT64_MAX / 2, config.mid, (uint32_t)op_count + 1,
+                             1000000000, (uint32_t)op_count + 1};
+        gate = create_risk_gate(1, &limits);
+        book->risk_gate = gate;
+    }
+    EngineStats* stats = config.stats ? create_engine_stats(NULL, NULL, 0) : NULL;
+    book->stats = stats;
+    
+    // Drive the book directly, timing every call
+    int misses = 0;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < op_count; i++) {
+        BenchOp* op = &ops[i];
+        uint64_t t0 = bench_now_ns();
+        switch (op->type) {
+            case BENCH_ADD:
+                add_order(book, &op->order);
+                break;
+            case BENCH_CANCEL:
+                misses += (cancel_order(book, op->order.id) != 0);
+                break;
+            case BENCH_MODIFY:
+                misses += (modify_order(book, op->order.id, op->order.quantity, op->order.price) != 0);
+                break;
+            default:
+                break;
+        }
+        histogram_record(&histograms[op->type], bench_now_ns() - t0);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    if (reader.view != NULL) {
+        __atomic_store_n(&reader.done, 1, __ATOMIC_RELEASE);
+        pthread_join(reader_thread, NULL);
+    }
+    double throughput = (double)op_count / ((double)elapsed / 1e9);
+    
+    // Human-readable report
+    printf("=== ORDER BOOK BENCHMARK: %s ===\n", config.label);
+    printf("Operations: %d, Elapsed: %.3f s, Throughput: %.0f ops/s, Clock: %s\n",
+           op_count, (double)elapsed / 1e9, throughput, event_clock_uses_tsc() ? "tsc" : "clock_gettime");
+    printf("Resting orders: %u, Bid levels: %d, Ask levels: %d, Missed cancels/modifies: %d\n",
+           book->pool.live_count, book->bids.level_count, book->asks.level_count, misses);
+    if (feed != NULL) {
+        printf("Market data updates: %llu (depth %d)\n", (unsigned long long)(feed->next_sequence - 1),
+               config.market_data_depth);
+    }
+    if (gate != NULL) {
+        printf("Risk checks: %llu accepted, %llu rejected\n", (unsigned long long)gate->counts[RISK_ACCEPTED],
+               (unsigned long long)(gate->counts[RISK_UNKNOWN_ACCOUNT] + gate->accounts[0].rejected));
+    }
+    if (reader.view != NULL) {
+        printf("Quote view versions: %llu, reader copies: %llu (depth %d)\n",
+               (unsigned long long)reader.view->quote.version, (unsigned long long)reader.reads,
+               reader.view->depth);
+    }
+    printf("%-8s %10s %8s %8s %8s %8s %10s\n", "Op", "Count", "Mean", "p50", "p99", "p99.9", "Max");
+    
+    Histogram all;
+    histogram_reset(&all);
+    for (int t = 0; t < BENCH_OP_TYPES; t++) {
+        histogram_merge(&all, &histograms[t]);
+        if (histograms[t].count > 0) {
+            print_histogram_row(bench_op_names[t], &histograms[t]);
+        }
+    }
+    print_histogram_row("all", &all);
+    if (stats != NULL) {
+        print_engine_stats(stats);
+    }
+    
+    // Machine-readable report, one JSON object per run
+    if (config.json_file != NULL) {
+        FILE* json = (strcmp(config.json_file, "-") == 0) ? stdout : fopen(config.json_file, "a");
+        if (json == NULL) {
+            perror("Failed to open JSON output");
+        } else {
+            fprintf(json, "{\"label\":\"%s\",\"operations\":%d,\"elapsed_ns\":%llu,\"throughput_ops\":%.0f,",
+                    config.label, op_count, (unsigned long long)elapsed, throughput);
+            if (config.protocol) {
+                fprintf(json, "\"decode_ns_per_message\":%.2f,", decode_ns);
+            }
+            fprintf(json, "\"latency\":{");
+            bool first = true;
+            for (int t = 0; t < BENCH_OP_TYPES; t++) {
+                if (histograms[t].count > 0) {
+                    write_histogram_json(json, bench_op_names[t], &histograms[t], first);
+                    first = false;
+                }
+            }
+            write_histogram_json(json, "all", &all, first);
+            fprintf(json, "}}\n");
+            if (json != stdout) {
+                fclose(json);
+            }
+        }
+    }
+    
+    free(histograms);
+    free_order_book(book);
+    free_market_data_feed(feed);
+    free_quote_view(reader.view);
+    free_risk_gate(gate);
+    free_engine_stats(stats);
+    free(ops);
+    return EXIT_SUCCESS;
+}
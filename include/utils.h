@@ -6,11 +6,21 @@
 #include <string.h>
 #include <time.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define MAX_ID_LENGTH 16
 #define MAX_SYMBOL_LENGTH 8
 #define MAX_ORDERS 10000
-#define MAX_PRICE_LEVELS 100
+#define PRICE_SCALE 100           // Ticks per currency unit (0.01 tick size)
+#define PRICE_LADDER_SIZE 4096    // Ticks covered by each side's ladder window
+#define NO_ORDER UINT32_MAX       // Null link in a price level queue
+#define NO_OWNER 0                // Owner of orders exempt from self-trade prevention
+
+//Prices are integer ticks
+typedef int64_t Price;
+
+//Generation-tagged order reference: generation in the high word, pool slot in the low word
+typedef uint64_t OrderHandle;
 
 //Order types
 
@@ -19,59 +29,254 @@ typedef enum {
     SELL
 } OrderSide;
 
+//Order types: how much of an order may trade and whether the rest may rest
+typedef enum {
+    LIMIT,      // Trade up to the limit price, rest the remainder
+    MARKET,     // Trade at any price, cancel the remainder
+    IOC,        // Trade up to the limit price, cancel the remainder
+    FOK,        // Trade the whole quantity up to the limit price or nothing
+    STOP,       // Wait for a trade through the stop price, then trade as MARKET
+    STOP_LIMIT, // Wait for a trade through the stop price, then trade as LIMIT
+    ICEBERG     // LIMIT that shows display_quantity at a time and hides the rest
+} OrderType;
+
+//Self-trade prevention: what the incoming order's mode does when it would
+//trade with a resting order of the same owner
+typedef enum {
+    STP_CANCEL_NEWEST,  // Cancel the incoming order's remainder
+    STP_CANCEL_OLDEST,  // Cancel the resting order and keep matching
+    STP_CANCEL_BOTH,    // Cancel both
+    STP_DECREMENT       // Take the smaller open quantity off both, without a trade
+} SelfTradeMode;
+
 //Order status
 typedef enum {
     OPEN,
     FILLED,
     PARTIALLY_FILLED,
-    CANCELLED
+    CANCELLED,
+    REJECTED        // Turned away by the risk gate before reaching the book
 } OrderStatus;
 
-//Order Struct
+//Order Struct: an order as it is submitted, and as the book reports it back
 
 typedef struct {
     char id[MAX_ID_LENGTH];
     char symbol[MAX_SYMBOL_LENGTH];
     OrderSide side;
-    double price;
+    OrderType type;
+    Price price;
+    Price stop_price;       // Trigger price for STOP and STOP_LIMIT orders
     int quantity;
     int filled_quantity;
-    time_t timestamp;
+    int display_quantity;   // Peak size of an ICEBERG order
+    uint32_t owner;         // Account ID, NO_OWNER for none
+    SelfTradeMode stp;      // Self-trade prevention mode against the owner's resting orders
+    uint64_t sequence;      // Event sequence of the add that created it, set by the book
+    uint64_t timestamp_ns;  // Event clock time of that add, set by the book
     OrderStatus status;
 } Order;
 
-//Price level struct
+//Resting order: only the fields matching touches, two records to a cache
+//line. Matching trades at the level's price, so the order's own price is
+//cold. The enums are stored in a byte each.
+typedef struct {
+    uint32_t owner;         // Compared against the incoming order for self-trade prevention
+    int quantity;
+    int filled_quantity;
+    int displayed;          // Unfilled part of the shown peak while resting
+    uint32_t prev;          // Intrusive FIFO links (order slots), owned by the book;
+                            // an armed stop keeps its heap position here
+    uint32_t next;          // Also chains free slots in the pool
+    uint8_t side;           // OrderSide
+    uint8_t type;           // OrderType
+    uint8_t status;         // OrderStatus
+    uint8_t stp;            // SelfTradeMode
+    uint32_t reserved;
+} RestingOrder;
+
+//Cold fields of a resting order, in an array parallel to the resting records
+//that is only read to report, index, trigger or replenish an order
 typedef struct {
-    double price;
-    int total_quantity;
-    struct Order* orders;
+    char id[MAX_ID_LENGTH];
+    Price price;
+    Price stop_price;
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+    int display_quantity;
+    uint32_t generation;    // Bumped each time the pool slot is released
+} OrderInfo;
+
+//Price level struct: FIFO queue of order slots linked through RestingOrder.prev/next
+typedef struct {
+    Price price;
+    int total_quantity;      // Everything that can trade here, hidden reserves included
+    int displayed_quantity;  // What the level shows: full size, or the peak of an iceberg
+    uint32_t head;
+    uint32_t tail;
     int order_count;
 } PriceLevel;
 
+//Price ladder: one side of the book, levels indexed by tick offset from base_price
+typedef struct {
+    PriceLevel* levels;
+    int size;
+    Price base_price;
+    int level_count;     // Non-empty levels
+    int low;             // Lowest non-empty index, -1 when empty
+    int high;            // Highest non-empty index, -1 when empty
+    OrderSide side;
+} PriceLadder;
+
+//Fixed-capacity order pool; free slots are chained through RestingOrder.next
+typedef struct {
+    RestingOrder* orders;   // Hot records, indexed by slot
+    OrderInfo* info;        // Cold fields, same slots
+    uint32_t capacity;
+    uint32_t free_head;
+    uint32_t live_count;
+} OrderPool;
+
+//Order ID index entry: 16-byte ID as two words mapped to a live order slot
+typedef struct {
+    uint64_t key[2];
+    uint32_t slot;          // NO_ORDER marks an empty entry
+} OrderIndexEntry;
+
+//Open-addressing hash index from order ID to live order slot
+typedef struct {
+    OrderIndexEntry* entries;
+    uint32_t mask;          // Capacity - 1, capacity is a power of two
+    uint32_t count;
+} OrderIndex;
+
+//Armed stop order: trigger price and arrival sequence of a pool slot
+typedef struct {
+    Price stop_price;
+    uint64_t sequence;
+    uint32_t slot;
+} StopEntry;
+
+//Binary heap of one side's armed stops with the next to trigger on top:
+//lowest stop price for buys, highest for sells, arrival order within a price
+typedef struct {
+    StopEntry* entries;
+    uint32_t count;
+    uint32_t capacity;
+    OrderSide side;
+} StopHeap;
+
+//Call auction state of a book. During the call phase orders rest without
+//matching, and the indicative uncross is kept current after each event;
+//after it, the last uncross's price and traded quantity are kept.
+typedef struct {
+    bool call_phase;
+    bool changed;            // The values changed since they were last published
+    Price indicative_price;  // Price the book would uncross at now, 0 while it does not cross
+    int matched_quantity;    // Quantity that would trade at that price
+    int imbalance;           // Quantity left over there, positive for buys, negative for sells
+} AuctionState;
+
+//Activity counters of a book, kept by the thread that owns the book with
+//plain increments. Levels destroyed are the levels created less those still
+//occupied.
+typedef struct {
+    uint64_t adds;              // New orders that took a pool slot
+    uint64_t cancels;
+    uint64_t modifies;
+    uint64_t trades;
+    uint64_t traded_quantity;
+    uint64_t rejects;           // New orders turned away by the risk gate or the book, killed
+                                // fill-or-kill orders included
+    uint64_t levels_created;    // Price levels that went from empty to occupied
+    uint32_t max_queue_depth;   // Most orders queued at one level
+    uint32_t max_levels;        // Most occupied levels on one side
+    uint32_t max_live_orders;   // Most pool slots in use at once
+} BookCounters;
+
+//Execution report ring (see src/exec_report.h)
+typedef struct ExecRing ExecRing;
+
+//Append-only command journal (see src/journal.h)
+typedef struct Journal Journal;
+
+//Incremental market data publisher (see src/market_data.h)
+typedef struct MarketDataFeed MarketDataFeed;
+
+//Lock-free top-of-book view for other threads (see src/quote_view.h)
+typedef struct QuoteView QuoteView;
+
+//Pre-trade risk gate with per-account limits (see src/risk_gate.h)
+typedef struct RiskGate RiskGate;
+
+//Per-thread stage timings and periodic stats dump (see src/stats.h)
+typedef struct EngineStats EngineStats;
+
+//Registry of books by symbol (see src/symbol_registry.h)
+typedef struct SymbolRegistry SymbolRegistry;
+
 //Order book struct
 typedef struct {
     char symbol[MAX_SYMBOL_LENGTH];
-    PriceLevel* buy_levels;
-    int buy_level_count;
-    PriceLevel* sell_levels;
-    int sell_level_count;
-    struct Order* all_orders;
-    int order_count;
+    PriceLadder bids;
+    PriceLadder asks;
+    OrderPool pool;
+    OrderIndex order_index;
+    StopHeap buy_stops;
+    StopHeap sell_stops;
+    uint64_t stop_sequence;  // Arrival counter for stop priority
+    Price trade_high;        // Trade price range of the current command,
+    Price trade_low;         // empty while trade_high < trade_low
+    Price last_trade_price;  // 0 until the book's first trade
+    uint64_t event_sequence; // Global sequence number of the command being applied
+    uint64_t event_time_ns;  // and its event clock time
+    bool event_stamped;      // The next command's stamp was assigned upstream (sequencer, replay)
+    AuctionState auction;
+    BookCounters counters;
+    ExecRing* exec_ring;    // Trade reports go here when attached, not owned
+    Journal* journal;       // Commands and trades are journaled when attached, not owned
+    MarketDataFeed* market_data;  // Level and order changes are published when attached, not owned
+    Price published_bound[2];     // Worst price of each side's last published view, by OrderSide
+    QuoteView* quote_view;        // Top levels are republished after each event when attached, not owned
+    RiskGate* risk_gate;          // New orders are checked before they reach the book when attached, not owned
+    EngineStats* stats;           // Command stages are timed into the owning thread's stats when attached, not owned
+    bool mapped;            // Arrays live in a snapshot mapping owned by the registry
 } OrderBook;
 
+//Callback receiving each order read from an input source
+typedef void (*OrderHandler)(void* context, Order* order);
+
 //Functions
 
 OrderBook* create_order_book(const char* symbol);
+OrderBook* create_order_book_with_capacity(const char* symbol, uint32_t max_orders, int ladder_size);
 void free_order_book(OrderBook* book);
-void add_order(OrderBook* book, Order* order);
-void cancel_order(OrderBook* book, const char* order_id);
-void modify_order(OrderBook* book, const char* order_id, int new_quantity, double new_price);
+void stamp_next_event(OrderBook* book, uint64_t sequence, uint64_t timestamp_ns);
+RestingOrder* add_order(OrderBook* book, Order* order);
+int cancel_order(OrderBook* book, const char* order_id);
+int modify_order(OrderBook* book, const char* order_id, int new_quantity, Price new_price);
+int modify_order_by_handle(OrderBook* book, OrderHandle handle, int new_quantity, Price new_price);
+RestingOrder* cancel_replace_order(OrderBook* book, const char* order_id, Order* order);
 void match_orders(OrderBook* book);
+void start_auction(OrderBook* book);
+int uncross_auction(OrderBook* book);
 void print_order_book(const OrderBook* book);
 void print_order(const Order* order);
-int load_orders_from_csv(OrderBook* book, const char* filename);
-Order* find_order_by_id(OrderBook* book, const char* order_id);
-void process_user_input(OrderBook* book);
+int load_orders_from_csv(SymbolRegistry* registry, const char* filename);
+int read_orders_from_csv(const char* filename, OrderHandler handler, void* context);
+int save_orders_to_csv(const OrderBook* book, const char* filename);
+RestingOrder* find_order_by_id(OrderBook* book, const char* order_id);
+uint32_t order_slot(const OrderBook* book, const RestingOrder* order);
+const OrderInfo* order_info(const OrderBook* book, const RestingOrder* order);
+void load_order(const OrderBook* book, uint32_t slot, Order* order);
+PriceLevel* best_price_level(const OrderBook* book, OrderSide side);
+int parse_order_type(const char* text, size_t length, OrderType* type);
+const char* order_type_to_string(OrderType type);
+int parse_stp_mode(const char* text, size_t length, SelfTradeMode* mode);
+const char* stp_mode_to_string(SelfTradeMode mode);
+Price price_from_double(double price);
+double price_to_double(Price price);
+void process_user_input(SymbolRegistry* registry, const char* symbol);
 void display_help();
 
 #endif //UTILS_H
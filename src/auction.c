@@ -0,0 +1,104 @@
+#include "../include/utils.h"
+#include "../src/auction.h"
+#include "../src/orderbook.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Total quantity resting at a price on one side, 0 for an empty level. The
+// walks below stay inside both ladders' occupied ranges, so this is one load.
+static inline int level_quantity(const PriceLadder* ladder, Price price) {
+    const PriceLevel* level = &ladder->levels[price - ladder->base_price];
+    return (level->order_count > 0) ? level->total_quantity : 0;
+}
+
+// Find the price a call auction would uncross the book at. Only prices from
+// the best ask up to the best bid can trade, so the cumulative demand (bids at
+// or above a price) and supply (asks at or below it) curves are built in one
+// ascending walk over that range. The price with the most executable quantity
+// wins, then the one with the smallest imbalance, then the one closest to the
+// reference price: the last trade, or the middle of the range before any.
+// Hidden iceberg quantity counts. A book that does not cross gets price 0.
+void auction_equilibrium(const OrderBook* book, Price* price, int* matched_quantity, int* imbalance) {
+    *price = 0;
+    *matched_quantity = 0;
+    *imbalance = 0;
+    
+    const PriceLevel* best_bid = ladder_best_level(&book->bids);
+    const PriceLevel* best_ask = ladder_best_level(&book->asks);
+    if (best_bid == NULL || best_ask == NULL || best_bid->price < best_ask->price) {
+        return;
+    }
+    Price low = best_ask->price;
+    Price high = best_bid->price;
+    Price reference = (book->last_trade_price != 0) ? book->last_trade_price : low + (high - low) / 2;
+    
+    // The lowest bid and highest ask may lie inside the range
+    Price bid_floor = book->bids.base_price + book->bids.low;
+    Price ask_ceiling = book->asks.base_price + book->asks.high;
+    if (bid_floor < low) {
+        bid_floor = low;
+    }
+    
+    // Every bid in the range is demand at the lowest price
+    long long demand = 0;
+    for (Price p = bid_floor; p <= high; p++) {
+        demand += level_quantity(&book->bids, p);
+    }
+    
+    long long supply = 0;
+    long long best_matched = 0;
+    long long best_imbalance = 0;
+    Price best_distance = 0;
+    for (Price p = low; p <= high; p++) {
+        if (p <= ask_ceiling) {
+            supply += level_quantity(&book->asks, p);
+        }
+        long long matched = (demand < supply) ? demand : supply;
+        long long surplus = demand - supply;
+        Price distance = llabs(p - reference);
+        if (matched > best_matched ||
+            (matched == best_matched && (llabs(surplus) < llabs(best_imbalance) ||
+                                         (llabs(surplus) == llabs(best_imbalance) && distance < best_distance)))) {
+            *price = p;
+            best_matched = matched;
+            best_imbalance = surplus;
+            best_distance = distance;
+        }
+        // Bids at this price are not demand at the next one up
+        if (p >= bid_floor) {
+            demand -= level_quantity(&book->bids, p);
+        }
+    }
+    *matched_quantity = (int)best_matched;
+    *imbalance = (int)best_imbalance;
+}
+
+// Recompute a book's indicative uncross during the call phase, noting whether
+// it changed so it is only republished when it does
+void update_indicative(OrderBook* book) {
+    Price price;
+    int matched_quantity;
+    int imbalance;
+    auction_equilibrium(book, &price, &matched_quantity, &imbalance);
+    
+    AuctionState* auction = &book->auction;
+    if (price != auction->indicative_price || matched_quantity != auction->matched_quantity ||
+        imbalance != auction->imbalance) {
+        auction->indicative_price = price;
+        auction->matched_quantity = matched_quantity;
+        auction->imbalance = imbalance;
+        auction->changed = true;
+    }
+}
+
+// Print a book's indicative uncross
+void print_auction_state(const OrderBook* book) {
+    const AuctionState* auction = &book->auction;
+    if (auction->indicative_price == 0) {
+        printf("Auction call: book does not cross\n");
+        return;
+    }
+    printf("Auction call: indicative price %.2f, matched %d, imbalance %d%s\n",
+           price_to_double(auction->indicative_price), auction->matched_quantity,
+           abs(auction->imbalance), (auction->imbalance > 0) ? " BUY" : (auction->imbalance < 0) ? " SELL" : "");
+}
@@ -0,0 +1,11 @@
+#ifndef AUCTION_H
+#define AUCTION_H
+
+#include "../include/utils.h"
+
+// Call auction functions
+void auction_equilibrium(const OrderBook* book, Price* price, int* matched_quantity, int* imbalance);
+void update_indicative(OrderBook* book);
+void print_auction_state(const OrderBook* book);
+
+#endif // AUCTION_H
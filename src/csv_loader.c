@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/csv_loader.h"
+#include "../src/stop_book.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Copy one field into a fixed buffer; fails if it does not fit
+static int copy_field(char* dest, size_t capacity, const char* start, const char* end) {
+    size_t length = (size_t)(end - start);
+    if (length == 0 || length >= capacity) {
+        return -1;
+    }
+    memcpy(dest, start, length);
+    dest[length] = '\0';
+    return 0;
+}
+
+// Parse a decimal price straight into ticks, rounding half up past the tick size
+int parse_price_ticks(const char* text, const char* end, Price* price) {
+    const char* p = text;
+    Price whole = 0;
+    int digits = 0;
+    
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (whole > (INT64_MAX / PRICE_SCALE) / 10) {
+            return -1;
+        }
+        whole = whole * 10 + (*p++ - '0');
+        digits++;
+    }
+    
+    Price fraction = 0;
+    int scale = 1;
+    bool round_up = false;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (scale < PRICE_SCALE) {
+                fraction = fraction * 10 + (*p - '0');
+                scale *= 10;
+            } else if (scale == PRICE_SCALE) {
+                // First digit beyond the tick decides rounding, the rest are dropped
+                round_up = (*p >= '5');
+                scale++;
+            }
+            p++;
+            digits++;
+        }
+    }
+    
+    if (digits == 0 || p != end) {
+        return -1;
+    }
+    while (scale < PRICE_SCALE) {
+        fraction *= 10;
+        scale *= 10;
+    }
+    *price = whole * PRICE_SCALE + fraction + (round_up ? 1 : 0);
+    return 0;
+}
+
+// Parse a positive integer quantity
+static int parse_quantity(const char* text, const char* end, int* quantity) {
+    if (text == end) {
+        return -1;
+    }
+    long value = 0;
+    for (const char* p = text; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+        value = value * 10 + (*p - '0');
+        if (value > INT_MAX) {
+            return -1;
+        }
+    }
+    if (value == 0) {
+        return -1;
+    }
+    *quantity = (int)value;
+    return 0;
+}
+
+// Parse one "ID,Symbol,Side,Price,Quantity[,Type[,StopPrice|Peak]]" row; end
+// excludes the line terminator. Type defaults to LIMIT, MARKET and STOP orders
+// may leave Price empty, and the seventh field is given exactly for the stop
+// types (their stop price) and ICEBERG (its displayed peak). Quantities and
+// peaks must be positive, and a peak no larger than the quantity.
+int parse_csv_order(const char* line, const char* end, Order* order) {
+    const char* fields[8];
+    int field_count = 0;
+    const char* p = line;
+    
+    // Locate the field boundaries in one pass
+    fields[field_count++] = p;
+    while (field_count < 8) {
+        const char* comma = memchr(p, ',', (size_t)(end - p));
+        if (comma == NULL) {
+            break;
+        }
+        p = comma + 1;
+        fields[field_count++] = p;
+    }
+    if (field_count < 5 || field_count > 7) {
+        return -1;
+    }
+    
+    // Trailing blanks after the last field are tolerated
+    const char* last_end = end;
+    while (last_end > fields[field_count - 1] && (last_end[-1] == ' ' || last_end[-1] == '\t')) {
+        last_end--;
+    }
+    const char* quantity_end = (field_count >= 6) ? fields[5] - 1 : last_end;
+    
+    const char* type_end = (field_count == 7) ? fields[6] - 1 : last_end;
+    
+    order->type = LIMIT;
+    if (field_count >= 6 && parse_order_type(fields[5], (size_t)(type_end - fields[5]), &order->type) != 0) {
+        return -1;
+    }
+    
+    order->stop_price = 0;
+    order->display_quantity = 0;
+    if ((field_count == 7) != (is_stop_type(order->type) || order->type == ICEBERG)) {
+        return -1;
+    }
+    if (field_count == 7 && (order->type == ICEBERG ?
+                             parse_quantity(fields[6], last_end, &order->display_quantity) :
+                             parse_price_ticks(fields[6], last_end, &order->stop_price)) != 0) {
+        return -1;
+    }
+    
+    if ((order->type == MARKET || order->type == STOP) && fields[4] - 1 == fields[3]) {
+        order->price = 0;
+    } else if (parse_price_ticks(fields[3], fields[4] - 1, &order->price) != 0) {
+        return -1;
+    }
+    
+    if (copy_field(order->id, MAX_ID_LENGTH, fields[0], fields[1] - 1) != 0 ||
+        copy_field(order->symbol, MAX_SYMBOL_LENGTH, fields[1], fields[2] - 1) != 0 ||
+        parse_quantity(fields[4], quantity_end, &order->quantity) != 0 ||
+        order->display_quantity > order->quantity) {
+        return -1;
+    }
+    
+    // Side, case-insensitive
+    size_t side_length = (size_t)(fields[3] - 1 - fields[2]);
+    char side[4] = {0};
+    for (size_t i = 0; i < side_length && i < sizeof(side); i++) {
+        side[i] = (char)(fields[2][i] & ~0x20);
+    }
+    if (side_length == 3 && memcmp(side, "BUY", 3) == 0) {
+        order->side = BUY;
+    } else if (side_length == 4 && memcmp(side, "SELL", 4) == 0) {
+        order->side = SELL;
+    } else {
+        return -1;
+    }
+    
+    order->owner = NO_OWNER;
+    order->stp = STP_CANCEL_NEWEST;
+    order->filled_quantity = 0;
+    order->status = OPEN;
+    return 0;
+}
+
+// Map an order CSV file and hand parsed orders to handler in batches
+int read_order_batches_from_csv(const char* filename, OrderBatchHandler handler, void* context) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file");
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Not a regular file: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Failed to map file");
+        return -1;
+    }
+    posix_madvise((void*)data, size, POSIX_MADV_SEQUENTIAL);
+    
+    Order* batch = malloc(CSV_BATCH_SIZE * sizeof(Order));
+    if (batch == NULL) {
+        perror("Failed to allocate memory for order batch");
+        munmap((void*)data, size);
+        return -1;
+    }
+    
+    const char* p = data;
+    const char* file_end = data + size;
+    int line_num = 0;
+    int count = 0;
+    
+    while (p < file_end) {
+        const char* newline = memchr(p, '\n', (size_t)(file_end - p));
+        const char* line_end = (newline != NULL) ? newline : file_end;
+        const char* next = (newline != NULL) ? newline + 1 : file_end;
+        line_num++;
+        
+        if (line_end > p && line_end[-1] == '\r') {
+            line_end--;
+        }
+        
+        // Skip the header line and blank lines
+        if (line_num == 1 || line_end == p) {
+            p = next;
+            continue;
+        }
+        
+        Order* order = &batch[count];
+        if (parse_csv_order(p, line_end, order) != 0) {
+            fprintf(stderr, "Invalid format at line %d: %.*s\n", line_num, (int)(line_end - p), p);
+            p = next;
+            continue;
+        }
+        if (++count == CSV_BATCH_SIZE) {
+            handler(context, batch, count);
+            count = 0;
+        }
+        p = next;
+    }
+    
+    if (count > 0) {
+        handler(context, batch, count);
+    }
+    
+    free(batch);
+    munmap((void*)data, size);
+    return 0;
+}
+
+//Adapter state for per-order handlers
+typedef struct {
+    OrderHandler handler;
+    void* context;
+} OrderHandlerAdapter;
+
+// Hand each order of a batch to a per-order handler
+static void dispatch_batch(void* context, Order* orders, int count) {
+    OrderHandlerAdapter* adapter = context;
+    for (int i = 0; i < count; i++) {
+        adapter->handler(adapter->context, &orders[i]);
+    }
+}
+
+// Parse each row of an order CSV file and pass it to handler
+int read_orders_from_csv(const char* filename, OrderHandler handler, void* context) {
+    OrderHandlerAdapter adapter = {handler, context};
+    return read_order_batches_from_csv(filename, dispatch_batch, &adapter);
+}
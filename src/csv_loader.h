@@ -0,0 +1,16 @@
+#ifndef CSV_LOADER_H
+#define CSV_LOADER_H
+
+#include "../include/utils.h"
+
+#define CSV_BATCH_SIZE 1024    // Orders parsed before each hand-off to the batch handler
+
+//Callback receiving consecutive parsed orders in file order
+typedef void (*OrderBatchHandler)(void* context, Order* orders, int count);
+
+// Bulk CSV loader functions
+int read_order_batches_from_csv(const char* filename, OrderBatchHandler handler, void* context);
+int parse_csv_order(const char* line, const char* end, Order* order);
+int parse_price_ticks(const char* text, const char* end, Price* price);
+
+#endif // CSV_LOADER_H
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include "../include/utils.h"
+#include "../src/engine.h"
+#include "../src/symbol_registry.h"
+#include "../src/event_clock.h"
+#include "../src/stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+// Create an engine with worker_count workers; pinning starts at first_cpu
+// (-1 disables pinning) and each worker gets its own execution report ring,
+// and its own stats when stats options are given (NULL leaves timing off)
+Engine* create_engine(uint32_t worker_count, int first_cpu, FILE* exec_sink, ExecFormat exec_format,
+                      const EngineStatsOptions* stats) {
+    Engine* engine = calloc(1, sizeof(Engine));
+    if (engine == NULL) {
+        perror("Failed to allocate memory for engine");
+        return NULL;
+    }
+    
+    engine->workers = calloc(worker_count, sizeof(EngineWorker));
+    if (engine->workers == NULL) {
+        perror("Failed to allocate memory for engine workers");
+        free(engine);
+        return NULL;
+    }
+    engine->worker_count = worker_count;
+    
+    for (uint32_t i = 0; i < worker_count; i++) {
+        EngineWorker* worker = &engine->workers[i];
+        worker->cpu = (first_cpu >= 0) ? first_cpu + (int)i : -1;
+        worker->queue.slots = malloc(ENGINE_QUEUE_CAPACITY * sizeof(EngineCommand));
+        worker->queue.mask = ENGINE_QUEUE_CAPACITY - 1;
+        worker->registry = create_symbol_registry(MAX_SYMBOLS, ORDERS_PER_BOOK, LADDER_SIZE_PER_BOOK);
+        worker->exec_ring = (exec_sink != NULL) ? create_exec_ring(EXEC_RING_CAPACITY, exec_sink, exec_format) : NULL;
+        
+        if (worker->queue.slots == NULL || worker->registry == NULL ||
+            (exec_sink != NULL && worker->exec_ring == NULL)) {
+            fprintf(stderr, "Failed to create engine worker %u\n", i);
+            free_engine(engine);
+            return NULL;
+        }
+        worker->registry->exec_ring = worker->exec_ring;
+        
+        // Each worker times and dumps only its own books, so nothing is shared
+        if (stats != NULL) {
+            if (stats->dump_path != NULL) {
+                char path[4096];
+                snprintf(path, sizeof(path), "%s.%u", stats->dump_path, i);
+                worker->stats_sink = fopen(path, "w");
+                if (worker->stats_sink == NULL) {
+                    perror("Failed to open stats dump file");
+                    free_engine(engine);
+                    return NULL;
+                }
+            }
+            worker->stats = create_engine_stats(worker->registry, worker->stats_sink, stats->interval_ns);
+            if (worker->stats == NULL) {
+                free_engine(engine);
+                return NULL;
+            }
+            registry_attach_stats(worker->registry, worker->stats);
+        }
+    }
+    return engine;
+}
+
+// Stop the workers and free everything they own
+void free_engine(Engine* engine) {
+    if (engine != NULL) {
+        engine_stop(engine);
+        for (uint32_t i = 0; i < engine->worker_count; i++) {
+            free_symbol_registry(engine->workers[i].registry);
+            free_exec_ring(engine->workers[i].exec_ring);
+            free_engine_stats(engine->workers[i].stats);
+            if (engine->workers[i].stats_sink != NULL) {
+                fclose(engine->workers[i].stats_sink);
+            }
+            free(engine->workers[i].queue.slots);
+        }
+        free(engine->workers);
+        free(engine);
+    }
+}
+
+// Apply one command to the worker's own books under its ingress stamp
+static void apply_command(EngineWorker* worker, EngineCommand* command) {
+    // Only a new order creates a book
+    OrderBook* book = (command->type == ENGINE_NEW_ORDER) ?
+        registry_get_book(worker->registry, command->order.symbol) :
+        registry_find_book(worker->registry, command->order.symbol);
+    if (book == NULL) {
+        return;
+    }
+    
+    stamp_next_event(book, command->sequence, command->timestamp_ns);
+    switch (command->type) {
+        case ENGINE_NEW_ORDER:
+            add_order(book, &command->order);
+            break;
+        case ENGINE_CANCEL_ORDER:
+            cancel_order(book, command->order.id);
+            break;
+        case ENGINE_MODIFY_ORDER:
+            modify_order(book, command->order.id, command->order.quantity, command->order.price);
+            break;
+    }
+}
+
+// Worker loop: drain the queue in batches, releasing each slot after it is applied
+static void* engine_worker_main(void* arg) {
+    EngineWorker* worker = arg;
+    CommandQueue* queue = &worker->queue;
+    
+#ifdef __linux__
+    if (worker->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(worker->cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            fprintf(stderr, "Failed to pin engine worker to CPU %d\n", worker->cpu);
+        }
+    }
+#endif
+    
+    while (1) {
+        uint64_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = queue->tail;
+        
+        if (tail == head) {
+            if (!__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE) &&
+                __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == tail) {
+                break;
+            }
+            // Idle: let the report ring catch up, then back off
+            if (worker->exec_ring == NULL || exec_ring_flush(worker->exec_ring) == 0) {
+                sched_yield();
+            }
+            continue;
+        }
+        
+        for (; tail != head; tail++) {
+            apply_command(worker, &queue->slots[tail & queue->mask]);
+        }
+        worker->processed += head - queue->tail;
+        __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+    }
+    
+    if (worker->exec_ring != NULL) {
+        exec_ring_flush(worker->exec_ring);
+    }
+    
+    // The last dump covers everything the worker applied
+    if (worker->stats_sink != NULL) {
+        write_stats_dump(worker->stats, event_clock_ns());
+    }
+    return NULL;
+}
+
+// Launch one thread per worker
+int engine_start(Engine* engine) {
+    if (engine->started) {
+        return 0;
+    }
+    
+    for (uint32_t i = 0; i < engine->worker_count; i++) {
+        EngineWorker* worker = &engine->workers[i];
+        worker->running = 1;
+        if (pthread_create(&worker->thread, NULL, engine_worker_main, worker) != 0) {
+            perror("Failed to start engine worker");
+            worker->running = 0;
+            for (uint32_t j = 0; j < i; j++) {
+                __atomic_store_n(&engine->workers[j].running, 0, __ATOMIC_RELEASE);
+                pthread_join(engine->workers[j].thread, NULL);
+            }
+            return -1;
+        }
+    }
+    engine->started = true;
+    return 0;
+}
+
+// Let the workers finish their queues and join them
+void engine_stop(Engine* engine) {
+    if (!engine->started) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < engine->worker_count; i++) {
+        __atomic_store_n(&engine->workers[i].running, 0, __ATOMIC_RELEASE);
+    }
+    for (uint32_t i = 0; i < engine->worker_count; i++) {
+        pthread_join(engine->workers[i].thread, NULL);
+    }
+    engine->started = false;
+}
+
+// Hash a symbol onto a worker
+uint32_t engine_worker_for_symbol(const Engine* engine, const char* symbol) {
+    uint64_t h = symbol_key(symbol) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)((h >> 32) % engine->worker_count);
+}
+
+// Sequence, timestamp and enqueue a command for the worker owning its symbol;
+// spins while that queue is full. The single ingress thread is the sequencer
+// and owns the event counter, so workers never draw from it.
+void engine_submit(Engine* engine, const EngineCommand* command) {
+    EngineWorker* worker = &engine->workers[engine_worker_for_symbol(engine, command->order.symbol)];
+    CommandQueue* queue = &worker->queue;
+    
+    while (queue->head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) > queue->mask) {
+        sched_yield();
+    }
+    EngineCommand* slot = &queue->slots[queue->head & queue->mask];
+    *slot = *command;
+    slot->sequence = next_event_sequence();
+    slot->timestamp_ns = event_clock_ns();
+    __atomic_store_n(&queue->head, queue->head + 1, __ATOMIC_RELEASE);
+}
+
+// Submit a new order
+void engine_submit_order(Engine* engine, const Order* order) {
+    EngineCommand command;
+    command.type = ENGINE_NEW_ORDER;
+    command.order = *order;
+    engine_submit(engine, &command);
+}
+
+// Submit a cancel for an order in a symbol's book
+void engine_submit_cancel(Engine* engine, const char* symbol, const char* order_id) {
+    EngineCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = ENGINE_CANCEL_ORDER;
+    strncpy(command.order.symbol, symbol, MAX_SYMBOL_LENGTH - 1);
+    strncpy(command.order.id, order_id, MAX_ID_LENGTH - 1);
+    engine_submit(engine, &command);
+}
+
+// Submit a quantity/price change for an order in a symbol's book
+void engine_submit_modify(Engine* engine, const char* symbol, const char* order_id,
+                          int new_quantity, Price new_price) {
+    EngineCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = ENGINE_MODIFY_ORDER;
+    strncpy(command.order.symbol, symbol, MAX_SYMBOL_LENGTH - 1);
+    strncpy(command.order.id, order_id, MAX_ID_LENGTH - 1);
+    command.order.quantity = new_quantity;
+    command.order.price = new_price;
+    engine_submit(engine, &command);
+}
+
+// Wait until every worker has applied everything submitted so far
+void engine_drain(Engine* engine) {
+    for (uint32_t i = 0; i < engine->worker_count; i++) {
+        CommandQueue* queue = &engine->workers[i].queue;
+        while (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) != queue->head) {
+            sched_yield();
+        }
+    }
+}
+
+// Find a symbol's book in its worker; only safe to read after engine_drain or engine_stop
+OrderBook* engine_find_book(const Engine* engine, const char* symbol) {
+    return registry_find_book(engine->workers[engine_worker_for_symbol(engine, symbol)].registry, symbol);
+}
+
+// Feed one parsed CSV order to the engine
+static void submit_csv_order(void* context, Order* order) {
+    engine_submit_order((Engine*)context, order);
+}
+
+// Feed an order CSV file through the engine's ingress
+int engine_load_orders_from_csv(Engine* engine, const char* filename) {
+    return read_orders_from_csv(filename, submit_csv_order, engine);
+}
@@ -0,0 +1,79 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+#include <pthread.h>
+
+#define ENGINE_QUEUE_CAPACITY 65536   // Commands buffered per worker
+
+//Inbound command types
+typedef enum {
+    ENGINE_NEW_ORDER,
+    ENGINE_CANCEL_ORDER,
+    ENGINE_MODIFY_ORDER
+} EngineCommandType;
+
+//Inbound command; modify carries the new quantity and price in order. The
+//ingress thread sequences and timestamps every command as it is queued.
+typedef struct {
+    EngineCommandType type;
+    Order order;
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+} EngineCommand;
+
+//Single-producer/single-consumer command queue from ingress to one worker
+typedef struct {
+    uint64_t head;                          // Next slot to write, ingress owned
+    char producer_pad[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    uint64_t tail;                          // Next slot to read, worker owned
+    char consumer_pad[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    EngineCommand* slots;
+    uint32_t mask;
+} CommandQueue;
+
+//Stage timing for the workers; each worker dumps to <dump_path>.<worker>
+typedef struct {
+    const char* dump_path;      // NULL for no periodic dumps
+    uint64_t interval_ns;       // Event time between dumps, 0 for the default
+} EngineStatsOptions;
+
+//Matching worker: exclusively owns the books of the symbols hashed onto it,
+//and the stats its commands are timed into when timing is on
+typedef struct {
+    CommandQueue queue;
+    SymbolRegistry* registry;
+    ExecRing* exec_ring;
+    EngineStats* stats;
+    FILE* stats_sink;
+    pthread_t thread;
+    int cpu;                                // CPU to pin to, -1 for none
+    int running;
+    uint64_t processed;
+} EngineWorker;
+
+//Sharded matching engine
+typedef struct {
+    EngineWorker* workers;
+    uint32_t worker_count;
+    bool started;
+} Engine;
+
+// Engine functions
+Engine* create_engine(uint32_t worker_count, int first_cpu, FILE* exec_sink, ExecFormat exec_format,
+                      const EngineStatsOptions* stats);
+void free_engine(Engine* engine);
+int engine_start(Engine* engine);
+void engine_stop(Engine* engine);
+uint32_t engine_worker_for_symbol(const Engine* engine, const char* symbol);
+void engine_submit(Engine* engine, const EngineCommand* command);
+void engine_submit_order(Engine* engine, const Order* order);
+void engine_submit_cancel(Engine* engine, const char* symbol, const char* order_id);
+void engine_submit_modify(Engine* engine, const char* symbol, const char* order_id,
+                          int new_quantity, Price new_price);
+void engine_drain(Engine* engine);
+OrderBook* engine_find_book(const Engine* engine, const char* symbol);
+int engine_load_orders_from_csv(Engine* engine, const char* filename);
+
+#endif // ENGINE_H
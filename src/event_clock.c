@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/event_clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+//Process-wide clock state. Until calibration succeeds the clock reads
+//clock_gettime; afterwards it is the wall time at calibration advanced by
+//the TSC, which costs a few nanoseconds instead of a vDSO call.
+static bool tsc_enabled = false;
+static uint64_t tsc_base;
+static uint64_t tsc_base_ns;
+static double tsc_ns_per_tick;
+
+//Next event sequence number; 0 is never assigned, so it can mean "none".
+//Only the thread that sequences commands draws numbers: the CLI and loader
+//thread, or the sharded engine's ingress thread, whose workers apply
+//commands already stamped. Keeping the counter in that thread's storage
+//makes drawing a plain increment, with no shared cache line or atomic.
+static __thread uint64_t event_sequence = 1;
+
+// Wall-clock time in nanoseconds from the OS
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Monotonic time in nanoseconds from the OS
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Check that the TSC ticks at a constant rate through frequency and sleep
+// state changes (CPUID 0x80000007, EDX bit 8)
+static bool invariant_tsc(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// Measure the TSC rate against CLOCK_MONOTONIC and switch the clock over to
+// it; returns false (and keeps clock_gettime) without an invariant TSC. Call
+// once at startup, before any thread reads the clock.
+bool calibrate_event_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (!invariant_tsc()) {
+        return false;
+    }
+    uint64_t start_ns = monotonic_ns();
+    uint64_t start_tsc = __rdtsc();
+    uint64_t end_ns;
+    do {
+        end_ns = monotonic_ns();
+    } while (end_ns - start_ns < EVENT_CLOCK_CALIBRATION_NS);
+    uint64_t end_tsc = __rdtsc();
+    if (end_tsc <= start_tsc) {
+        return false;
+    }
+    
+    tsc_ns_per_tick = (double)(end_ns - start_ns) / (double)(end_tsc - start_tsc);
+    tsc_base_ns = realtime_ns();
+    tsc_base = __rdtsc();
+    tsc_enabled = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Whether the clock reads the calibrated TSC
+bool event_clock_uses_tsc(void) {
+    return tsc_enabled;
+}
+
+// Nanoseconds per TSC tick measured by calibration, 0 when the TSC is not used
+double event_clock_ns_per_tick(void) {
+    return tsc_enabled ? tsc_ns_per_tick : 0.0;
+}
+
+// Current wall-clock time in nanoseconds from the cheapest calibrated source
+uint64_t event_clock_ns(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (tsc_enabled) {
+        return tsc_base_ns + (uint64_t)((double)(__rdtsc() - tsc_base) * tsc_ns_per_tick);
+    }
+#endif
+    return realtime_ns();
+}
+
+// Take the next number of the event sequence on the sequencing thread
+uint64_t next_event_sequence(void) {
+    return event_sequence++;
+}
+
+// Number the next event would get
+uint64_t peek_event_sequence(void) {
+    return event_sequence;
+}
+
+// Make sure numbering continues at next or later, after restoring history;
+// call it on the sequencing thread
+void advance_event_sequence(uint64_t next) {
+    if (event_sequence < next) {
+        event_sequence = next;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef EVENT_CLOCK_H
+#define EVENT_CLOCK_H
+
+#include "../include/utils.h"
+
+#define EVENT_CLOCK_CALIBRATION_NS 20000000ULL   // How long calibration samples the TSC
+
+// Event clock functions
+bool calibrate_event_clock(void);
+bool event_clock_uses_tsc(void);
+double event_clock_ns_per_tick(void);
+uint64_t event_clock_ns(void);
+uint64_t next_event_sequence(void);
+uint64_t peek_event_sequence(void);
+void advance_event_sequence(uint64_t next);
+
+#endif // EVENT_CLOCK_H
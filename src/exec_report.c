@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+// Create a ring with capacity rounded up to a power of two
+ExecRing* create_exec_ring(uint32_t capacity, FILE* sink, ExecFormat format) {
+    ExecRing* ring = calloc(1, sizeof(ExecRing));
+    if (ring == NULL) {
+        perror("Failed to allocate memory for execution ring");
+        return NULL;
+    }
+    
+    uint32_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    
+    ring->records = malloc(size * sizeof(ExecReport));
+    if (ring->records == NULL) {
+        perror("Failed to allocate memory for execution reports");
+        free(ring);
+        return NULL;
+    }
+    
+    ring->mask = size - 1;
+    ring->sink = sink;
+    ring->format = format;
+    ring->next_sequence = 1;
+    return ring;
+}
+
+// Stop the consumer, drain what is left and free the ring
+void free_exec_ring(ExecRing* ring) {
+    if (ring != NULL) {
+        exec_ring_stop_consumer(ring);
+        exec_ring_flush(ring);
+        free(ring->records);
+        free(ring);
+    }
+}
+
+// Reserve the next record for the producer to fill in place. When the ring
+// is full the producer waits for the consumer thread, or drains it inline
+// when no consumer thread is running.
+ExecReport* exec_ring_claim(ExecRing* ring) {
+    while (ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+        if (ring->threaded) {
+            sched_yield();
+        } else {
+            exec_ring_flush(ring);
+        }
+    }
+    
+    ExecReport* report = &ring->records[ring->head & ring->mask];
+    report->sequence = ring->next_sequence++;
+    return report;
+}
+
+// Publish the record returned by the last claim
+void exec_ring_commit(ExecRing* ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+// Format one report as a text line carrying the same fields as a binary record
+void print_exec_report(FILE* file, const ExecReport* report) {
+    fprintf(file, "TRADE #%llu: %s @ %.2f, Qty: %d, Aggressor: %s (%s), Resting: %s, Event: %llu, Time: %llu\n",
+            (unsigned long long)report->sequence, report->symbol, price_to_double(report->price), report->quantity,
+            report->aggressor_id, (report->aggressor_side == BUY) ? "BUY" : "SELL", report->resting_id,
+            (unsigned long long)report->event_sequence, (unsigned long long)report->timestamp_ns);
+}
+
+// Drain all published records to the sink; returns the number written
+size_t exec_ring_flush(ExecRing* ring) {
+    uint64_t tail = ring->tail;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t count = (size_t)(head - tail);
+    
+    if (ring->format == EXEC_FORMAT_BINARY) {
+        // Write contiguous runs, splitting once at the wrap point
+        while (tail != head) {
+            uint32_t start = (uint32_t)(tail & ring->mask);
+            uint64_t run = ring->mask + 1 - start;
+            if (run > head - tail) {
+                run = head - tail;
+            }
+            fwrite(&ring->records[start], sizeof(ExecReport), (size_t)run, ring->sink);
+            tail += run;
+        }
+    } else {
+        for (; tail != head; tail++) {
+            print_exec_report(ring->sink, &ring->records[tail & ring->mask]);
+        }
+    }
+    
+    if (count > 0) {
+        fflush(ring->sink);
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+// Consumer thread: drain in batches, backing off while the ring is empty
+static void* exec_ring_consumer(void* arg) {
+    ExecRing* ring = arg;
+    while (__atomic_load_n(&ring->running, __ATOMIC_ACQUIRE)) {
+        if (exec_ring_flush(ring) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Hand formatting over to a dedicated consumer thread
+int exec_ring_start_consumer(ExecRing* ring) {
+    if (ring->threaded) {
+        return 0;
+    }
+    
+    ring->running = 1;
+    ring->threaded = true;
+    if (pthread_create(&ring->consumer, NULL, exec_ring_consumer, ring) != 0) {
+        perror("Failed to start execution report consumer");
+        ring->running = 0;
+        ring->threaded = false;
+        return -1;
+    }
+    return 0;
+}
+
+// Stop the consumer thread; remaining records are left for exec_ring_flush
+void exec_ring_stop_consumer(ExecRing* ring) {
+    if (!ring->threaded) {
+        return;
+    }
+    
+    __atomic_store_n(&ring->running, 0, __ATOMIC_RELEASE);
+    pthread_join(ring->consumer, NULL);
+    ring->threaded = false;
+}
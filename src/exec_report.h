@@ -0,0 +1,56 @@
+#ifndef EXEC_REPORT_H
+#define EXEC_REPORT_H
+
+#include "../include/utils.h"
+#include <pthread.h>
+
+#define EXEC_RING_CAPACITY 4096   // Default number of buffered execution reports
+#define CACHE_LINE_SIZE 64
+
+//Execution report output format
+typedef enum {
+    EXEC_FORMAT_TEXT,
+    EXEC_FORMAT_BINARY
+} ExecFormat;
+
+//Fixed-size trade record written by the matching thread
+typedef struct {
+    uint64_t sequence;
+    uint64_t event_sequence;    // Global sequence of the inbound command that caused the trade
+    uint64_t timestamp_ns;      // Event clock time of the trade
+    Price price;
+    int32_t quantity;
+    OrderSide aggressor_side;
+    char aggressor_id[MAX_ID_LENGTH];
+    char resting_id[MAX_ID_LENGTH];
+    char symbol[MAX_SYMBOL_LENGTH];
+} ExecReport;
+
+//Single-producer/single-consumer ring of execution reports. The producer
+//(matching) and consumer (formatter) cursors sit on separate cache lines.
+struct ExecRing {
+    uint64_t head;                          // Next record to write, producer owned
+    uint64_t next_sequence;
+    char producer_pad[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    uint64_t tail;                          // Next record to read, consumer owned
+    char consumer_pad[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    ExecReport* records;
+    uint32_t mask;
+    FILE* sink;
+    ExecFormat format;
+    bool threaded;
+    int running;
+    pthread_t consumer;
+};
+
+// Execution report ring functions
+ExecRing* create_exec_ring(uint32_t capacity, FILE* sink, ExecFormat format);
+void free_exec_ring(ExecRing* ring);
+ExecReport* exec_ring_claim(ExecRing* ring);
+void exec_ring_commit(ExecRing* ring);
+size_t exec_ring_flush(ExecRing* ring);
+int exec_ring_start_consumer(ExecRing* ring);
+void exec_ring_stop_consumer(ExecRing* ring);
+void print_exec_report(FILE* file, const ExecReport* report);
+
+#endif // EXEC_REPORT_H
@@ -0,0 +1,85 @@
+#include "../include/utils.h"
+#include "../src/histogram.h"
+#include <string.h>
+
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+
+// Clear all samples
+void histogram_reset(Histogram* histogram) {
+    memset(histogram, 0, sizeof(Histogram));
+    histogram->min = UINT64_MAX;
+}
+
+// Bucket index: exact below 2^SUB_BITS, then SUB_BITS significant bits per power of two
+static uint32_t histogram_index(uint64_t value) {
+    if (value < (1u << HISTOGRAM_SUB_BITS)) {
+        return (uint32_t)value;
+    }
+    int shift = (63 - __builtin_clzll(value)) - (HISTOGRAM_SUB_BITS - 1);
+    return (uint32_t)(shift * HISTOGRAM_HALF + (value >> shift));
+}
+
+// Highest value that maps to a bucket
+static uint64_t histogram_value(uint32_t index) {
+    if (index < (1u << HISTOGRAM_SUB_BITS)) {
+        return index;
+    }
+    int shift = (int)(index / HISTOGRAM_HALF) - 1;
+    uint64_t sub = index % HISTOGRAM_HALF + HISTOGRAM_HALF;
+    return (sub << shift) + ((1ULL << shift) - 1);
+}
+
+// Record one sample
+void histogram_record(Histogram* histogram, uint64_t value) {
+    histogram->counts[histogram_index(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+// Add the samples of one histogram into another
+void histogram_merge(Histogram* into, const Histogram* from) {
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->min < into->min) {
+        into->min = from->min;
+    }
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+// Value at a percentile (0-100), reported as the upper edge of its bucket
+uint64_t histogram_percentile(const Histogram* histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= target) {
+            uint64_t value = histogram_value(i);
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+// Mean of all samples
+double histogram_mean(const Histogram* histogram) {
+    return (histogram->count > 0) ? (double)histogram->sum / (double)histogram->count : 0.0;
+}
@@ -0,0 +1,25 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "../include/utils.h"
+
+#define HISTOGRAM_SUB_BITS 7                                    // 128 linear sub-buckets per power of two (<1% error)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * (1 << (HISTOGRAM_SUB_BITS - 1)) + (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+//Log-linear (HDR-style) histogram of non-negative integer samples
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} Histogram;
+
+// Histogram functions
+void histogram_reset(Histogram* histogram);
+void histogram_record(Histogram* histogram, uint64_t value);
+void histogram_merge(Histogram* into, const Histogram* from);
+uint64_t histogram_percentile(const Histogram* histogram, double percentile);
+double histogram_mean(const Histogram* histogram);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/journal.h"
+#include "../src/event_clock.h"
+#include "../src/symbol_registry.h"
+#include "../src/stop_book.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Word-at-a-time hash of a record; records are a multiple of 8 bytes
+static uint64_t journal_checksum(const JournalRecordHeader* header, const uint8_t* payload, size_t length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint64_t word;
+    
+    memcpy(&word, header, sizeof(word));
+    h = (h ^ word) * 0x100000001b3ULL;
+    h = (h ^ header->sequence) * 0x100000001b3ULL;
+    for (size_t i = 0; i + sizeof(word) <= length; i += sizeof(word)) {
+        memcpy(&word, payload + i, sizeof(word));
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Open a journal for appending; next_sequence continues a recovered journal
+Journal* open_journal(const char* filename, size_t buffer_size, JournalSyncPolicy policy, uint64_t next_sequence) {
+    Journal* journal = calloc(1, sizeof(Journal));
+    if (journal == NULL) {
+        perror("Failed to allocate memory for journal");
+        return NULL;
+    }
+    
+    journal->buffer = malloc(buffer_size);
+    if (journal->buffer == NULL) {
+        perror("Failed to allocate memory for journal buffer");
+        free(journal);
+        return NULL;
+    }
+    
+    journal->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal->fd < 0) {
+        perror("Failed to open journal");
+        free(journal->buffer);
+        free(journal);
+        return NULL;
+    }
+    
+    journal->capacity = buffer_size;
+    journal->sync_policy = policy;
+    journal->next_sequence = next_sequence;
+    return journal;
+}
+
+// Commit anything buffered and close the journal
+int close_journal(Journal* journal) {
+    if (journal == NULL) {
+        return 0;
+    }
+    int result = journal_commit(journal);
+    if (close(journal->fd) != 0) {
+        perror("Failed to close journal");
+        result = -1;
+    }
+    free(journal->buffer);
+    free(journal);
+    return result;
+}
+
+// Group commit: write every buffered record in one call, then sync per policy
+int journal_commit(Journal* journal) {
+    size_t written = 0;
+    while (written < journal->used) {
+        ssize_t n = write(journal->fd, journal->buffer + written, journal->used - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write journal");
+            return -1;
+        }
+        written += (size_t)n;
+    }
+    
+    if (journal->used > 0) {
+        journal->used = 0;
+        journal->commits++;
+        if (journal->sync_policy != JOURNAL_SYNC_NONE && fdatasync(journal->fd) != 0) {
+            perror("Failed to sync journal");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Copy one record into the buffer, committing first if it would not fit
+static int journal_append(Journal* journal, JournalRecordType type, const void* payload, size_t length) {
+    size_t record_length = sizeof(JournalRecordHeader) + length;
+    if (journal->used + record_length > journal->capacity && journal_commit(journal) != 0) {
+        return -1;
+    }
+    
+    JournalRecordHeader header;
+    header.length = (uint32_t)record_length;
+    header.type = (uint32_t)type;
+    header.sequence = journal->next_sequence++;
+    header.checksum = journal_checksum(&header, payload, length);
+    
+    memcpy(journal->buffer + journal->used, &header, sizeof(header));
+    memcpy(journal->buffer + journal->used + sizeof(header), payload, length);
+    journal->used += record_length;
+    return 0;
+}
+
+// Start a command payload for an order ID on a book, with the book's current event stamp
+static void init_command(JournalCommand* command, const OrderBook* book, const char* order_id) {
+    memset(command, 0, sizeof(JournalCommand));
+    if (order_id != NULL) {
+        memcpy(command->id, order_id, strnlen(order_id, MAX_ID_LENGTH - 1));
+    }
+    memcpy(command->symbol, book->symbol, strnlen(book->symbol, MAX_SYMBOL_LENGTH - 1));
+    command->event_sequence = book->event_sequence;
+    command->timestamp_ns = book->event_time_ns;
+}
+
+// Append a command record, committing it straight away under JOURNAL_SYNC_ALWAYS
+static int journal_append_payload(Journal* journal, JournalRecordType type, const JournalCommand* command) {
+    if (journal_append(journal, type, command, sizeof(JournalCommand)) != 0) {
+        return -1;
+    }
+    return (journal->sync_policy == JOURNAL_SYNC_ALWAYS) ? journal_commit(journal) : 0;
+}
+
+// Fill a command payload with a new order
+static void init_order_command(JournalCommand* command, const OrderBook* book, const Order* order) {
+    init_command(command, book, order->id);
+    command->price = order->price;
+    command->stop_price = is_stop_type(order->type) ? order->stop_price : 0;
+    command->quantity = order->quantity;
+    command->display_quantity = (order->type == ICEBERG) ? order->display_quantity : 0;
+    command->side = (int32_t)order->side;
+    command->order_type = (int32_t)order->type;
+    command->owner = order->owner;
+    command->stp = (int32_t)order->stp;
+}
+
+// Journal a new order before the book applies it
+int journal_append_order(Journal* journal, const OrderBook* book, const Order* order) {
+    JournalCommand command;
+    init_order_command(&command, book, order);
+    return journal_append_payload(journal, JOURNAL_ADD, &command);
+}
+
+// Journal a cancel/replace as one record before the book applies it
+int journal_append_replace(Journal* journal, const OrderBook* book, const char* replaced_id, const Order* order) {
+    JournalReplace replace;
+    memset(&replace, 0, sizeof(JournalReplace));
+    init_order_command(&replace.order, book, order);
+    memcpy(replace.replaced_id, replaced_id, strnlen(replaced_id, MAX_ID_LENGTH - 1));
+    if (journal_append(journal, JOURNAL_REPLACE, &replace, sizeof(JournalReplace)) != 0) {
+        return -1;
+    }
+    return (journal->sync_policy == JOURNAL_SYNC_ALWAYS) ? journal_commit(journal) : 0;
+}
+
+// Journal a cancel, modify or uncross command before the book applies it
+int journal_append_command(Journal* journal, JournalRecordType type, const OrderBook* book, const char* order_id,
+                           Price price, int quantity) {
+    JournalCommand command;
+    init_command(&command, book, order_id);
+    command.price = price;
+    command.quantity = quantity;
+    return journal_append_payload(journal, type, &command);
+}
+
+// Journal a trade produced by the book
+int journal_append_execution(Journal* journal, const ExecReport* report) {
+    return journal_append(journal, JOURNAL_EXECUTION, report, sizeof(ExecReport));
+}
+
+// Rebuild the new order a command payload carries
+static void load_command_order(const JournalCommand* command, const OrderBook* book, Order* order) {
+    memcpy(order->id, command->id, MAX_ID_LENGTH);
+    memcpy(order->symbol, book->symbol, MAX_SYMBOL_LENGTH);
+    order->side = (OrderSide)command->side;
+    order->type = (OrderType)command->order_type;
+    order->price = command->price;
+    order->stop_price = command->stop_price;
+    order->quantity = command->quantity;
+    order->display_quantity = command->display_quantity;
+    order->owner = command->owner;
+    order->stp = (SelfTradeMode)command->stp;
+}
+
+// Payload size of a replayable record type, 0 for output-only records
+static size_t journal_payload_length(uint32_t type) {
+    if (type == JOURNAL_EXECUTION) {
+        return 0;
+    }
+    return (type == JOURNAL_REPLACE) ? sizeof(JournalReplace) : sizeof(JournalCommand);
+}
+
+// Apply one journaled command to the registry's books; a replace's payload
+// starts with its replacement order's command
+static void replay_command(SymbolRegistry* registry, JournalRecordType type, const uint8_t* payload) {
+    JournalReplace replace;
+    memcpy(&replace, payload, journal_payload_length(type));
+    const JournalCommand* command = &replace.order;
+    OrderBook* book = registry_get_book(registry, command->symbol);
+    if (book == NULL) {
+        return;
+    }
+    
+    // Replayed commands keep their place in the event order and their time
+    stamp_next_event(book, command->event_sequence, command->timestamp_ns);
+    advance_event_sequence(command->event_sequence + 1);
+    Order order;
+    switch (type) {
+        case JOURNAL_ADD:
+            load_command_order(command, book, &order);
+            add_order(book, &order);
+            break;
+        case JOURNAL_REPLACE:
+            load_command_order(command, book, &order);
+            cancel_replace_order(book, replace.replaced_id, &order);
+            break;
+        case JOURNAL_CANCEL:
+            cancel_order(book, command->id);
+            break;
+        case JOURNAL_MODIFY:
+            modify_order(book, command->id, command->quantity, command->price);
+            break;
+        case JOURNAL_MATCH:
+            match_orders(book);
+            break;
+        case JOURNAL_AUCTION:
+            start_auction(book);
+            break;
+        case JOURNAL_UNCROSS:
+            uncross_auction(book);
+            break;
+        default:
+            break;
+    }
+}
+
+// Rebuild books from a journal before any journal or exec ring is attached,
+// replaying records from start_sequence on (records before it are already in
+// a snapshot). A torn or corrupt tail is truncated away. Returns the commands
+// replayed; executions receives the trades journaled in the replayed range,
+// which replay does not report again.
+long long recover_from_journal(SymbolRegistry* registry, const char* filename, uint64_t start_sequence,
+                               uint64_t* next_sequence, uint64_t* executions) {
+    *next_sequence = start_sequence;
+    *executions = 0;
+    if (registry->journal != NULL || registry->exec_ring != NULL || registry->market_data != NULL) {
+        fprintf(stderr, "Recover before attaching a journal, exec ring or market data feed\n");
+        return -1;
+    }
+    
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        // No journal yet is an empty history
+        if (errno == ENOENT) {
+            return 0;
+        }
+        perror("Failed to open journal");
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Not a regular file: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    const uint8_t* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("Failed to map journal");
+        close(fd);
+        return -1;
+    }
+    posix_madvise((void*)data, size, POSIX_MADV_SEQUENTIAL);
+    
+    long long replayed = 0;
+    size_t offset = 0;
+    uint64_t expected = 0;
+    while (offset + sizeof(JournalRecordHeader) <= size) {
+        JournalRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        
+        // Stop at the first record that is not whole, intact and in sequence
+        if (header.length < sizeof(header) || header.length > size - offset || header.length % 8 != 0 ||
+            (offset > 0 && header.sequence != expected)) {
+            break;
+        }
+        const uint8_t* payload = data + offset + sizeof(header);
+        size_t length = header.length - sizeof(header);
+        if (journal_checksum(&header, payload, length) != header.checksum) {
+            break;
+        }
+        
+        // A journal that starts after the snapshot has lost history
+        if (offset == 0 && header.sequence > start_sequence) {
+            fprintf(stderr, "Journal %s starts at %llu, after sequence %llu\n", filename,
+                    (unsigned long long)header.sequence, (unsigned long long)start_sequence);
+            munmap((void*)data, size);
+            close(fd);
+            return -1;
+        }
+        
+        if (header.sequence >= start_sequence && length != 0 && length == journal_payload_length(header.type)) {
+            replay_command(registry, (JournalRecordType)header.type, payload);
+            replayed++;
+        } else if (header.sequence >= start_sequence && header.type == JOURNAL_EXECUTION) {
+            (*executions)++;
+        }
+        
+        expected = header.sequence + 1;
+        offset += header.length;
+    }
+    
+    munmap((void*)data, size);
+    if (expected > *next_sequence) {
+        *next_sequence = expected;
+    }
+    
+    if (offset < size) {
+        fprintf(stderr, "Truncating journal %s at byte %zu of %zu\n", filename, offset, size);
+        if (ftruncate(fd, (off_t)offset) != 0) {
+            perror("Failed to truncate journal");
+        }
+    }
+    close(fd);
+    return replayed;
+}
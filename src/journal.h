@@ -0,0 +1,81 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+
+#define JOURNAL_BUFFER_SIZE (1 << 20)   // Default group-commit buffer
+
+//When committed journal data is forced to stable storage
+typedef enum {
+    JOURNAL_SYNC_NONE,      // Leave it to the OS page cache
+    JOURNAL_SYNC_BATCH,     // fdatasync once per group commit
+    JOURNAL_SYNC_ALWAYS     // Commit and fdatasync every command record
+} JournalSyncPolicy;
+
+//Journal record types
+typedef enum {
+    JOURNAL_ADD = 1,
+    JOURNAL_CANCEL,
+    JOURNAL_MODIFY,
+    JOURNAL_MATCH,
+    JOURNAL_EXECUTION,      // Output only, skipped on replay
+    JOURNAL_AUCTION,        // Start of an auction call
+    JOURNAL_UNCROSS,        // Auction uncross
+    JOURNAL_REPLACE         // Cancel/replace, with a JournalReplace payload
+} JournalRecordType;
+
+//Record header; the checksum covers the rest of the header and the payload
+typedef struct {
+    uint32_t length;        // Whole record, header included
+    uint32_t type;
+    uint64_t sequence;
+    uint64_t checksum;
+} JournalRecordHeader;
+
+//Inbound command payload, in host byte order
+typedef struct {
+    char id[MAX_ID_LENGTH];
+    char symbol[MAX_SYMBOL_LENGTH];
+    Price price;
+    int32_t quantity;
+    int32_t side;
+    int32_t order_type;
+    int32_t display_quantity;
+    Price stop_price;
+    uint32_t owner;
+    int32_t stp;
+    uint64_t event_sequence;    // Global event sequence and event clock time,
+    uint64_t timestamp_ns;      // restored on replay
+} JournalCommand;
+
+//Cancel/replace payload: the replacement order, then the ID it replaces
+typedef struct {
+    JournalCommand order;
+    char replaced_id[MAX_ID_LENGTH];
+} JournalReplace;
+
+//Append-only journal with a preallocated group-commit buffer
+struct Journal {
+    int fd;
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    uint64_t next_sequence;
+    JournalSyncPolicy sync_policy;
+    uint64_t commits;
+};
+
+// Journal functions
+Journal* open_journal(const char* filename, size_t buffer_size, JournalSyncPolicy policy, uint64_t next_sequence);
+int close_journal(Journal* journal);
+int journal_commit(Journal* journal);
+int journal_append_order(Journal* journal, const OrderBook* book, const Order* order);
+int journal_append_command(Journal* journal, JournalRecordType type, const OrderBook* book, const char* order_id,
+                           Price price, int quantity);
+int journal_append_replace(Journal* journal, const OrderBook* book, const char* replaced_id, const Order* order);
+int journal_append_execution(Journal* journal, const ExecReport* report);
+long long recover_from_journal(SymbolRegistry* registry, const char* filename, uint64_t start_sequence,
+                               uint64_t* next_sequence, uint64_t* executions);
+
+#endif // JOURNAL_H
@@ -1,31 +1,340 @@
 #include "../include/utils.h"
 #include "../src/orderbook.h"
+#include "../src/exec_report.h"
+#include "../src/symbol_registry.h"
+#include "../src/engine.h"
+#include "../src/order_protocol.h"
+#include "../src/journal.h"
+#include "../src/snapshot.h"
+#include "../src/market_data.h"
+#include "../src/event_clock.h"
+#include "../src/risk_gate.h"
+#include "../src/stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+// Run an order file through the sharded engine and print the resulting books
+static int run_sharded(const char* orders_file, int workers, int first_cpu,
+                       FILE* exec_sink, ExecFormat exec_format, const EngineStatsOptions* stats) {
+    Engine* engine = create_engine((uint32_t)workers, first_cpu, exec_sink, exec_format, stats);
+    if (engine == NULL || engine_start(engine) != 0) {
+        fprintf(stderr, "Failed to start engine\n");
+        free_engine(engine);
+        return EXIT_FAILURE;
+    }
+    
+    int result = engine_load_orders_from_csv(engine, orders_file);
+    engine_drain(engine);
+    engine_stop(engine);
+    
+    if (result == 0) {
+        for (uint32_t w = 0; w < engine->worker_count; w++) {
+            EngineWorker* worker = &engine->workers[w];
+            printf("Worker %u: %llu commands, %u books\n", w,
+                   (unsigned long long)worker->processed, worker->registry->book_count);
+            for (uint32_t i = 0; i < worker->registry->book_count; i++) {
+                print_order_book(worker->registry->books[i]);
+                if (stats != NULL) {
+                    print_book_counters(worker->registry->books[i]);
+                }
+            }
+            if (stats != NULL) {
+                print_engine_stats(worker->stats);
+            }
+        }
+    }
+    free_engine(engine);
+    return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char* argv[]) {
+    const char* orders_file = NULL;
+    const char* binary_file = NULL;
+    const char* journal_file = NULL;
+    const char* snapshot_file = NULL;
+    JournalSyncPolicy sync_policy = JOURNAL_SYNC_BATCH;
+    const char* exec_file = NULL;
+    bool exec_thread = false;
+    int workers = 0;
+    int first_cpu = -1;
+    const char* market_data_file = NULL;
+    int market_data_depth = 0;
+    bool market_data_l3 = false;
+    uint32_t market_data_snapshots = 0;
+    RiskLimits risk_limits = {0};
+    const char* risk_file = NULL;
+    bool risk = false;
+    bool stats_enabled = false;
+    const char* stats_file = NULL;
+    uint64_t stats_interval_ns = STATS_DUMP_INTERVAL_NS;
+    
+    // Options: [orders.csv] [--orders-binary <file>] [--snapshot <file>] [--journal <file>]
+    //          [--fsync none|batch|always]
+    //          [--exec-binary <file>] [--exec-thread] [--workers <n>] [--pin <first cpu>]
+    //          [--market-data <file>] [--md-depth <n>] [--md-l3] [--md-snapshot-every <n>]
+    //          [--risk-max-qty <n>] [--risk-max-notional <amount>] [--risk-collar <amount>]
+    //          [--risk-max-open <n>] [--risk-rate <orders/s>] [--risk-burst <n>] [--risk-limits <file>]
+    //          [--stats] [--stats-dump <file>] [--stats-interval <ms>]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--orders-binary") == 0 && i + 1 < argc) {
+            binary_file = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_file = argv[++i];
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journal_file = argv[++i];
+        } else if (strcmp(argv[i], "--fsync") == 0 && i + 1 < argc) {
+            const char* policy = argv[++i];
+            if (strcmp(policy, "none") == 0) {
+                sync_policy = JOURNAL_SYNC_NONE;
+            } else if (strcmp(policy, "always") == 0) {
+                sync_policy = JOURNAL_SYNC_ALWAYS;
+            } else {
+                sync_policy = JOURNAL_SYNC_BATCH;
+            }
+        } else if (strcmp(argv[i], "--exec-binary") == 0 && i + 1 < argc) {
+            exec_file = argv[++i];
+        } else if (strcmp(argv[i], "--exec-thread") == 0) {
+            exec_thread = true;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pin") == 0 && i + 1 < argc) {
+            first_cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--market-data") == 0 && i + 1 < argc) {
+            market_data_file = argv[++i];
+        } else if (strcmp(argv[i], "--md-depth") == 0 && i + 1 < argc) {
+            market_data_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--md-l3") == 0) {
+            market_data_l3 = true;
+        } else if (strcmp(argv[i], "--md-snapshot-every") == 0 && i + 1 < argc) {
+            market_data_snapshots = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--risk-max-qty") == 0 && i + 1 < argc) {
+            risk_limits.max_quantity = atoi(argv[++i]);
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-max-notional") == 0 && i + 1 < argc) {
+            risk_limits.max_notional = price_from_double(atof(argv[++i]));
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-collar") == 0 && i + 1 < argc) {
+            risk_limits.collar = price_from_double(atof(argv[++i]));
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-max-open") == 0 && i + 1 < argc) {
+            risk_limits.max_open_orders = (uint32_t)strtoul(argv[++i], NULL, 10);
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-rate") == 0 && i + 1 < argc) {
+            risk_limits.rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-burst") == 0 && i + 1 < argc) {
+            risk_limits.burst = (uint32_t)strtoul(argv[++i], NULL, 10);
+            risk = true;
+        } else if (strcmp(argv[i], "--risk-limits") == 0 && i + 1 < argc) {
+            risk_file = argv[++i];
+            risk = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats_enabled = true;
+        } else if (strcmp(argv[i], "--stats-dump") == 0 && i + 1 < argc) {
+            stats_file = argv[++i];
+            stats_enabled = true;
+        } else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+            stats_interval_ns = strtoull(argv[++i], NULL, 10) * 1000000ULL;
+        } else {
+            orders_file = argv[i];
+        }
+    }
+    
     printf("=== Order Book Matching Engine ===\n");
-    //Create the orderbook
-    OrderBook* book = create_order_book("AAPL");
-    if (book == NULL) {
-        fprintf(stderr, "Failed to create order book\n");
+    //Events are timestamped from the TSC when it is invariant
+    calibrate_event_clock();
+    //Trade reports are buffered in a ring and formatted off the matching path
+    FILE* exec_sink = stdout;
+    ExecFormat exec_format = EXEC_FORMAT_TEXT;
+    if (exec_file != NULL) {
+        exec_sink = fopen(exec_file, "wb");
+        if (exec_sink == NULL) {
+            perror("Failed to open execution report file");
+            return EXIT_FAILURE;
+        }
+        exec_format = EXEC_FORMAT_BINARY;
+    }
+    //Sharded batch mode: one matching thread per symbol group
+    if (workers > 0) {
+        if (orders_file == NULL) {
+            fprintf(stderr, "--workers needs an orders file\n");
+            return EXIT_FAILURE;
+        }
+        if (market_data_file != NULL) {
+            fprintf(stderr, "--market-data is not supported with --workers\n");
+            return EXIT_FAILURE;
+        }
+        if (risk) {
+            fprintf(stderr, "Risk limits are not supported with --workers\n");
+            return EXIT_FAILURE;
+        }
+        EngineStatsOptions stats_options = {stats_file, stats_interval_ns};
+        int status = run_sharded(orders_file, workers, first_cpu, exec_sink, exec_format,
+                                 stats_enabled ? &stats_options : NULL);
+        if (exec_sink != stdout) {
+            fclose(exec_sink);
+        }
+        return status;
+    }
+    //Create the symbol registry; books are created per symbol on first use
+    SymbolRegistry* registry = create_symbol_registry(MAX_SYMBOLS, ORDERS_PER_BOOK, LADDER_SIZE_PER_BOOK);
+    if (registry == NULL) {
+        fprintf(stderr, "Failed to create symbol registry\n");
+        return EXIT_FAILURE;
+    }
+    //Start from the snapshot, then replay the journal from where it ends
+    uint64_t journal_sequence = 0;
+    uint64_t exec_sequence = 0;
+    if (snapshot_file != NULL) {
+        if (load_snapshot(registry, snapshot_file, &journal_sequence, &exec_sequence) != 0) {
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+        printf("Loaded %u books from snapshot %s\n", registry->book_count, snapshot_file);
+    }
+    Journal* journal = NULL;
+    uint64_t replayed_executions = 0;
+    if (journal_file != NULL) {
+        uint64_t next_sequence;
+        long long replayed = recover_from_journal(registry, journal_file, journal_sequence, &next_sequence,
+                                                  &replayed_executions);
+        if (replayed < 0) {
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+        printf("Recovered %lld commands from %s\n", replayed, journal_file);
+        journal = open_journal(journal_file, JOURNAL_BUFFER_SIZE, sync_policy, next_sequence);
+        if (journal == NULL) {
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+    }
+    ExecRing* exec_ring = create_exec_ring(EXEC_RING_CAPACITY, exec_sink, exec_format);
+    if (exec_ring == NULL) {
+        close_journal(journal);
+        free_symbol_registry(registry);
         return EXIT_FAILURE;
     }
+    //Report sequences carry on after the snapshot's and the replayed trades'
+    if (snapshot_file != NULL && exec_sequence > 0) {
+        exec_ring->next_sequence = exec_sequence;
+    }
+    exec_ring->next_sequence += replayed_executions;
+    //Binary L2/L3 updates for every book change, starting with a snapshot of restored books
+    FILE* market_data_sink = NULL;
+    MarketDataFeed* market_data = NULL;
+    if (market_data_file != NULL) {
+        market_data_sink = fopen(market_data_file, "wb");
+        market_data = (market_data_sink != NULL) ?
+            create_market_data_feed(market_data_sink, market_data_depth, market_data_l3, market_data_snapshots) : NULL;
+        if (market_data == NULL) {
+            perror("Failed to open market data file");
+            if (market_data_sink != NULL) {
+                fclose(market_data_sink);
+            }
+            free_exec_ring(exec_ring);
+            close_journal(journal);
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+    }
+    //Pre-trade limits per account; recovered orders count against them, but
+    //journaled commands were checked when they first arrived
+    RiskGate* risk_gate = NULL;
+    if (risk) {
+        risk_gate = create_risk_gate(RISK_MAX_ACCOUNTS, &risk_limits);
+        if (risk_gate == NULL || (risk_file != NULL && load_risk_limits(risk_gate, risk_file) != 0)) {
+            fprintf(stderr, "Failed to set up risk limits\n");
+            free_risk_gate(risk_gate);
+            free_market_data_feed(market_data);
+            if (market_data_sink != NULL) {
+                fclose(market_data_sink);
+            }
+            free_exec_ring(exec_ring);
+            close_journal(journal);
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+        registry_attach_risk_gate(registry, risk_gate);
+    }
+    //Stage timings of this thread, and with a dump file a JSON line of every
+    //book's counters each interval of event time
+    FILE* stats_sink = NULL;
+    EngineStats* stats = NULL;
+    if (stats_enabled) {
+        stats_sink = (stats_file != NULL) ? fopen(stats_file, "w") : NULL;
+        stats = (stats_file == NULL || stats_sink != NULL) ?
+            create_engine_stats(registry, stats_sink, stats_interval_ns) : NULL;
+        if (stats == NULL) {
+            perror("Failed to open stats dump file");
+            if (stats_sink != NULL) {
+                fclose(stats_sink);
+            }
+            free_risk_gate(risk_gate);
+            free_market_data_feed(market_data);
+            if (market_data_sink != NULL) {
+                fclose(market_data_sink);
+            }
+            free_exec_ring(exec_ring);
+            close_journal(journal);
+            free_symbol_registry(registry);
+            return EXIT_FAILURE;
+        }
+        registry_attach_stats(registry, stats);
+    }
+    if (exec_thread) {
+        exec_ring_start_consumer(exec_ring);
+    }
+    registry_attach_outputs(registry, exec_ring, journal, market_data);
     // Loading the samples if the user provided any
-    if (argc > 1) {
-        if (load_orders_from_csv(book, argv[1]) != 0) {
+    if (orders_file != NULL) {
+        if (load_orders_from_csv(registry, orders_file) != 0) {
             fprintf(stderr, "Failed to load orders from the file\n");
         } else {
-            printf("Loaded orders from %s\n", argv[1]);
-            match_orders(book);
-            print_order_book(book);
+            printf("Loaded orders from %s\n", orders_file);
+            if (!exec_thread) {
+                exec_ring_flush(exec_ring);
+            }
+            for (uint32_t i = 0; i < registry->book_count; i++) {
+                print_order_book(registry->books[i]);
+            }
+        }
+    }
+    // Replay binary order-entry messages if the user provided any
+    if (binary_file != NULL) {
+        if (load_orders_from_binary(registry, binary_file) != 0) {
+            fprintf(stderr, "Failed to load all messages from the file\n");
+        } else {
+            printf("Loaded messages from %s\n", binary_file);
+        }
+        if (!exec_thread) {
+            exec_ring_flush(exec_ring);
+        }
+        for (uint32_t i = 0; i < registry->book_count; i++) {
+            print_order_book(registry->books[i]);
         }
     }
     //Process the user input
-    process_user_input(book);
+    process_user_input(registry, (registry->book_count > 0) ? registry->books[0]->symbol : "AAPL");
+    //The last dump covers everything up to exit
+    if (stats_sink != NULL) {
+        write_stats_dump(stats, event_clock_ns());
+        fclose(stats_sink);
+    }
     //If you allocate it, you gotta free it :D
-    free_order_book(book);
+    close_journal(journal);
+    free_exec_ring(exec_ring);
+    if (exec_sink != stdout) {
+        fclose(exec_sink);
+    }
+    free_market_data_feed(market_data);
+    if (market_data_sink != NULL) {
+        fclose(market_data_sink);
+    }
+    free_symbol_registry(registry);
+    free_risk_gate(risk_gate);
+    free_engine_stats(stats);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
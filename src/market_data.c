@@ -0,0 +1,386 @@
+#include "../include/utils.h"
+#include "../src/market_data.h"
+#include "../src/orderbook.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Create a feed publishing depth levels per side (0 for all), optionally with L3 updates
+MarketDataFeed* create_market_data_feed(FILE* sink, int depth, bool l3, uint32_t snapshot_interval) {
+    MarketDataFeed* feed = calloc(1, sizeof(MarketDataFeed));
+    if (feed == NULL) {
+        perror("Failed to allocate memory for market data feed");
+        return NULL;
+    }
+    
+    feed->updates = malloc(MARKET_DATA_INITIAL_CAPACITY * sizeof(MarketDataUpdate));
+    feed->dirty = malloc(MARKET_DATA_INITIAL_CAPACITY * sizeof(MarketDataDirtyLevel));
+    feed->dirty_epochs = calloc(2 * MARKET_DATA_INITIAL_CAPACITY, sizeof(uint32_t));
+    feed->dirty_slots = malloc(2 * MARKET_DATA_INITIAL_CAPACITY * sizeof(uint32_t));
+    if (feed->updates == NULL || feed->dirty == NULL || feed->dirty_epochs == NULL || feed->dirty_slots == NULL) {
+        perror("Failed to allocate memory for market data updates");
+        free_market_data_feed(feed);
+        return NULL;
+    }
+    
+    feed->sink = sink;
+    feed->depth = (depth > 0) ? depth : 0;
+    feed->l3 = l3;
+    feed->snapshot_interval = snapshot_interval;
+    feed->next_sequence = 1;
+    feed->update_capacity = MARKET_DATA_INITIAL_CAPACITY;
+    feed->dirty_capacity = MARKET_DATA_INITIAL_CAPACITY;
+    feed->dirty_mask = 2 * MARKET_DATA_INITIAL_CAPACITY - 1;
+    feed->epoch = 1;
+    return feed;
+}
+
+// Free the feed; the sink belongs to the caller
+void free_market_data_feed(MarketDataFeed* feed) {
+    if (feed != NULL) {
+        free(feed->updates);
+        free(feed->dirty);
+        free(feed->dirty_epochs);
+        free(feed->dirty_slots);
+        free(feed);
+    }
+}
+
+// Bound of a view that holds every level of a side
+static Price unbounded_view(OrderSide side) {
+    return (side == BUY) ? INT64_MIN : INT64_MAX;
+}
+
+// Forget the published view, as for a book nobody has been sent yet
+void market_data_reset_view(OrderBook* book) {
+    book->published_bound[BUY] = unbounded_view(BUY);
+    book->published_bound[SELL] = unbounded_view(SELL);
+}
+
+// Check whether a price is at or better than a view's worst price
+static bool in_view(OrderSide side, Price price, Price bound) {
+    return (side == BUY) ? price >= bound : price <= bound;
+}
+
+// Start collecting a new event once the previous one has been published
+static void begin_event(MarketDataFeed* feed) {
+    if (feed->published) {
+        feed->update_count = 0;
+        feed->published = false;
+    }
+}
+
+// Append a blank update for a book; returns NULL if the buffer cannot grow
+static MarketDataUpdate* append_update(MarketDataFeed* feed, const OrderBook* book, MarketDataUpdateType type,
+                                       OrderSide side, Price price) {
+    if (feed->update_count == feed->update_capacity) {
+        uint32_t capacity = feed->update_capacity * 2;
+        MarketDataUpdate* updates = realloc(feed->updates, capacity * sizeof(MarketDataUpdate));
+        if (updates == NULL) {
+            perror("Failed to allocate memory for market data updates");
+            return NULL;
+        }
+        feed->updates = updates;
+        feed->update_capacity = capacity;
+    }
+    
+    MarketDataUpdate* update = &feed->updates[feed->update_count++];
+    memset(update, 0, sizeof(MarketDataUpdate));
+    update->sequence = feed->next_sequence++;
+    update->price = price;
+    memcpy(update->symbol, book->symbol, MAX_SYMBOL_LENGTH);
+    update->type = (uint8_t)type;
+    update->side = (uint8_t)side;
+    return update;
+}
+
+// Append an L2 update for the level at price, or a delete when level is NULL
+static void append_level(MarketDataFeed* feed, const OrderBook* book, MarketDataUpdateType type,
+                         OrderSide side, Price price, const PriceLevel* level) {
+    MarketDataUpdate* update = append_update(feed, book, type, side, price);
+    if (update != NULL && level != NULL && type != MD_LEVEL_DELETE) {
+        update->quantity = level->displayed_quantity;
+        update->order_count = level->order_count;
+    }
+}
+
+// Append an L3 update for an order on the level at price
+static void append_order(MarketDataFeed* feed, const OrderBook* book, MarketDataUpdateType type,
+                         const RestingOrder* order, Price price) {
+    MarketDataUpdate* update = append_update(feed, book, type, (OrderSide)order->side, price);
+    if (update != NULL) {
+        update->quantity = (type == MD_ORDER_DELETE) ? 0 : order->displayed;
+        memcpy(update->order_id, book->pool.info[order - book->pool.orders].id, MAX_ID_LENGTH);
+    }
+}
+
+// Hash slot of a (side, price) pair in the dirty table
+static uint32_t dirty_hash(const MarketDataFeed* feed, OrderSide side, Price price) {
+    uint64_t h = ((uint64_t)price << 1 | (uint64_t)side) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32) & feed->dirty_mask;
+}
+
+// Find the dirty list index of a level touched in this event, or NO_ORDER
+static uint32_t find_dirty(const MarketDataFeed* feed, OrderSide side, Price price) {
+    for (uint32_t i = dirty_hash(feed, side, price); feed->dirty_epochs[i] == feed->epoch; i = (i + 1) & feed->dirty_mask) {
+        const MarketDataDirtyLevel* dirty = &feed->dirty[feed->dirty_slots[i]];
+        if (dirty->price == price && dirty->side == side) {
+            return feed->dirty_slots[i];
+        }
+    }
+    return NO_ORDER;
+}
+
+// Enter a dirty list index into the hash
+static void hash_dirty(MarketDataFeed* feed, uint32_t index) {
+    const MarketDataDirtyLevel* dirty = &feed->dirty[index];
+    uint32_t i = dirty_hash(feed, dirty->side, dirty->price);
+    while (feed->dirty_epochs[i] == feed->epoch) {
+        i = (i + 1) & feed->dirty_mask;
+    }
+    feed->dirty_epochs[i] = feed->epoch;
+    feed->dirty_slots[i] = index;
+}
+
+// Double the dirty list and its hash, keeping the hash at most half full
+static int grow_dirty(MarketDataFeed* feed) {
+    uint32_t capacity = feed->dirty_capacity * 2;
+    MarketDataDirtyLevel* dirty = realloc(feed->dirty, capacity * sizeof(MarketDataDirtyLevel));
+    if (dirty == NULL) {
+        perror("Failed to allocate memory for market data levels");
+        return -1;
+    }
+    feed->dirty = dirty;
+    
+    uint32_t* epochs = calloc(2 * (size_t)capacity, sizeof(uint32_t));
+    uint32_t* slots = malloc(2 * (size_t)capacity * sizeof(uint32_t));
+    if (epochs == NULL || slots == NULL) {
+        perror("Failed to allocate memory for market data levels");
+        free(epochs);
+        free(slots);
+        return -1;
+    }
+    free(feed->dirty_epochs);
+    free(feed->dirty_slots);
+    feed->dirty_epochs = epochs;
+    feed->dirty_slots = slots;
+    feed->dirty_capacity = capacity;
+    feed->dirty_mask = 2 * capacity - 1;
+    for (uint32_t i = 0; i < feed->dirty_count; i++) {
+        hash_dirty(feed, i);
+    }
+    return 0;
+}
+
+// Record that an order and its level changed; called after the change. The
+// first touch of a level in an event remembers whether it existed before:
+// only an order add that leaves one order in the level created it.
+void market_data_order_changed(MarketDataFeed* feed, OrderBook* book, MarketDataUpdateType type,
+                               const RestingOrder* order, const PriceLevel* level) {
+    begin_event(feed);
+    if (feed->l3) {
+        append_order(feed, book, type, order, level->price);
+    }
+    
+    OrderSide side = (OrderSide)order->side;
+    if (find_dirty(feed, side, level->price) != NO_ORDER) {
+        return;
+    }
+    if (feed->dirty_count == feed->dirty_capacity && grow_dirty(feed) != 0) {
+        return;
+    }
+    MarketDataDirtyLevel* dirty = &feed->dirty[feed->dirty_count];
+    dirty->price = level->price;
+    dirty->side = side;
+    dirty->was_present = !(type == MD_ORDER_ADD && level->order_count == 1);
+    hash_dirty(feed, feed->dirty_count++);
+    
+    if (in_view(side, level->price, book->published_bound[side])) {
+        feed->view_touched[side] = true;
+    }
+}
+
+// Worst price among a side's best depth levels, or the unbounded view when
+// the side has fewer levels than that
+static Price view_bound(const PriceLadder* ladder, int depth) {
+    if (depth == 0 || ladder->level_count <= depth) {
+        return unbounded_view(ladder->side);
+    }
+    
+    int step = (ladder->side == BUY) ? -1 : 1;
+    int index = (ladder->side == BUY) ? ladder->high : ladder->low;
+    for (int seen = 0; ; index += step) {
+        if (ladder->levels[index].order_count > 0 && ++seen == depth) {
+            return ladder->levels[index].price;
+        }
+    }
+}
+
+// Publish the untouched resting levels with prices in [low, high] as adds
+// or deletes; these are the levels that crossed the view boundary
+static void append_shifted_levels(MarketDataFeed* feed, const OrderBook* book, const PriceLadder* ladder,
+                                  MarketDataUpdateType type, Price low, Price high) {
+    if (ladder->level_count == 0) {
+        return;
+    }
+    Price first = ladder->base_price + ladder->low;
+    Price last = ladder->base_price + ladder->high;
+    if (low < first) {
+        low = first;
+    }
+    if (high > last) {
+        high = last;
+    }
+    
+    // Walk from the best price outward so the updates come in view order
+    int step = (ladder->side == BUY) ? -1 : 1;
+    int start = (int)(((ladder->side == BUY) ? high : low) - ladder->base_price);
+    int end = (int)(((ladder->side == BUY) ? low : high) - ladder->base_price) + step;
+    for (int i = start; low <= high && i != end; i += step) {
+        const PriceLevel* level = &ladder->levels[i];
+        if (level->order_count > 0 && find_dirty(feed, ladder->side, level->price) == NO_ORDER) {
+            append_level(feed, book, type, ladder->side, level->price, level);
+        }
+    }
+}
+
+// Publish a side's view boundary move: levels pushed out of a shrinking view
+// are deleted (when deletes is set), levels pulled into a growing one added
+static void append_boundary_shift(MarketDataFeed* feed, const OrderBook* book, const PriceLadder* ladder,
+                                  Price old_bound, Price new_bound, bool deletes) {
+    if (old_bound == new_bound) {
+        return;
+    }
+    // For bids a better bound is a higher price; for asks a lower one
+    bool shrank = in_view(ladder->side, new_bound, old_bound);
+    if (shrank != deletes) {
+        return;
+    }
+    
+    Price inner = shrank ? new_bound : old_bound;
+    Price outer = shrank ? old_bound : new_bound;
+    if (ladder->side == BUY) {
+        append_shifted_levels(feed, book, ladder, deletes ? MD_LEVEL_DELETE : MD_LEVEL_ADD, outer, inner - 1);
+    } else {
+        append_shifted_levels(feed, book, ladder, deletes ? MD_LEVEL_DELETE : MD_LEVEL_ADD, inner + 1, outer);
+    }
+}
+
+// Append the full view of a book bracketed by snapshot markers
+static void append_snapshot(MarketDataFeed* feed, OrderBook* book) {
+    append_update(feed, book, MD_SNAPSHOT_BEGIN, BUY, 0);
+    for (int side = BUY; side <= SELL; side++) {
+        const PriceLadder* ladder = (side == BUY) ? &book->bids : &book->asks;
+        Price bound = view_bound(ladder, feed->depth);
+        book->published_bound[side] = bound;
+        if (ladder->level_count == 0) {
+            continue;
+        }
+        
+        int step = (side == BUY) ? -1 : 1;
+        int end = ((side == BUY) ? ladder->low : ladder->high) + step;
+        for (int i = (side == BUY) ? ladder->high : ladder->low; i != end; i += step) {
+            const PriceLevel* level = &ladder->levels[i];
+            if (!in_view((OrderSide)side, level->price, bound)) {
+                break;
+            }
+            if (level->order_count == 0) {
+                continue;
+            }
+            append_level(feed, book, MD_LEVEL_ADD, (OrderSide)side, level->price, level);
+            for (uint32_t slot = level->head; feed->l3 && slot != NO_ORDER; slot = book->pool.orders[slot].next) {
+                append_order(feed, book, MD_ORDER_ADD, &book->pool.orders[slot], level->price);
+            }
+        }
+    }
+    append_update(feed, book, MD_SNAPSHOT_END, BUY, 0);
+}
+
+// Mark the collected updates published and write them to the sink
+static uint32_t finish_event(MarketDataFeed* feed) {
+    if (feed->sink != NULL && feed->update_count > 0) {
+        fwrite(feed->updates, sizeof(MarketDataUpdate), feed->update_count, feed->sink);
+    }
+    feed->published = true;
+    return feed->update_count;
+}
+
+// Publish one event on a book: the L3 updates recorded as it happened, then
+// one L2 update per touched level inside the view and one per untouched level
+// that crossed the top-N boundary. Deletes come first so a consumer's view
+// never holds more than depth levels. Returns the number of updates.
+uint32_t market_data_publish(MarketDataFeed* feed, OrderBook* book) {
+    begin_event(feed);
+    
+    Price old_bound[2] = {book->published_bound[BUY], book->published_bound[SELL]};
+    Price new_bound[2] = {old_bound[BUY], old_bound[SELL]};
+    for (int side = BUY; side <= SELL; side++) {
+        // Changes strictly outside a full view cannot move its boundary
+        if (feed->depth > 0 && feed->view_touched[side]) {
+            new_bound[side] = view_bound((side == BUY) ? &book->bids : &book->asks, feed->depth);
+        }
+    }
+    
+    if (feed->dirty_count > 0 || old_bound[BUY] != new_bound[BUY] || old_bound[SELL] != new_bound[SELL]) {
+        append_boundary_shift(feed, book, &book->bids, old_bound[BUY], new_bound[BUY], true);
+        append_boundary_shift(feed, book, &book->asks, old_bound[SELL], new_bound[SELL], true);
+        
+        // Touched levels: deletes on the first pass, adds and updates on the second
+        for (int pass = 0; pass < 2; pass++) {
+            for (uint32_t i = 0; i < feed->dirty_count; i++) {
+                const MarketDataDirtyLevel* dirty = &feed->dirty[i];
+                const PriceLadder* ladder = (dirty->side == BUY) ? &book->bids : &book->asks;
+                const PriceLevel* level = ladder_find_level(ladder, dirty->price);
+                bool was_in = dirty->was_present && in_view(dirty->side, dirty->price, old_bound[dirty->side]);
+                bool is_in = level != NULL && in_view(dirty->side, dirty->price, new_bound[dirty->side]);
+                
+                if (pass == 0 && was_in && !is_in) {
+                    append_level(feed, book, MD_LEVEL_DELETE, dirty->side, dirty->price, NULL);
+                } else if (pass == 1 && is_in) {
+                    append_level(feed, book, was_in ? MD_LEVEL_UPDATE : MD_LEVEL_ADD, dirty->side, dirty->price, level);
+                }
+            }
+        }
+        
+        append_boundary_shift(feed, book, &book->bids, old_bound[BUY], new_bound[BUY], false);
+        append_boundary_shift(feed, book, &book->asks, old_bound[SELL], new_bound[SELL], false);
+    }
+    book->published_bound[BUY] = new_bound[BUY];
+    book->published_bound[SELL] = new_bound[SELL];
+    
+    // Clearing the dirty hash is just a new epoch, unless the counter wraps
+    feed->dirty_count = 0;
+    if (++feed->epoch == 0) {
+        memset(feed->dirty_epochs, 0, ((size_t)feed->dirty_mask + 1) * sizeof(uint32_t));
+        feed->epoch = 1;
+    }
+    feed->view_touched[BUY] = false;
+    feed->view_touched[SELL] = false;
+    
+    // Auction state follows the level updates it results from
+    AuctionState* auction = &book->auction;
+    if (auction->changed) {
+        MarketDataUpdate* update = append_update(feed, book,
+                                                 auction->call_phase ? MD_AUCTION_INDICATIVE : MD_AUCTION_UNCROSS,
+                                                 (auction->imbalance < 0) ? SELL : BUY, auction->indicative_price);
+        if (update != NULL) {
+            update->quantity = auction->matched_quantity;
+            update->order_count = abs(auction->imbalance);
+        }
+        auction->changed = false;
+    }
+    
+    feed->publications++;
+    if (feed->snapshot_interval > 0 && feed->publications % feed->snapshot_interval == 0) {
+        append_snapshot(feed, book);
+    }
+    return finish_event(feed);
+}
+
+// Publish the book's whole view; call between events, e.g. when a consumer
+// joins or a feed is attached to a book that already has orders
+uint32_t market_data_snapshot(MarketDataFeed* feed, OrderBook* book) {
+    begin_event(feed);
+    append_snapshot(feed, book);
+    return finish_event(feed);
+}
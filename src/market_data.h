@@ -0,0 +1,78 @@
+#ifndef MARKET_DATA_H
+#define MARKET_DATA_H
+
+#include "../include/utils.h"
+
+#define MARKET_DATA_INITIAL_CAPACITY 256   // Updates and dirty levels before the first growth
+
+//Market data update types
+typedef enum {
+    MD_LEVEL_ADD = 1,       // L2: a level entered the published view
+    MD_LEVEL_UPDATE,        // L2: displayed quantity or order count changed
+    MD_LEVEL_DELETE,        // L2: a level left the view
+    MD_ORDER_ADD,           // L3: an order joined the back of its level
+    MD_ORDER_MODIFY,        // L3: an order's displayed quantity changed in place
+    MD_ORDER_DELETE,        // L3: an order left its level
+    MD_SNAPSHOT_BEGIN,      // The book's view is republished in full until SNAPSHOT_END
+    MD_SNAPSHOT_END,
+    MD_AUCTION_INDICATIVE,  // Auction call: indicative price (0 while the book does not cross),
+                            // matched quantity, and imbalance in order_count on the surplus side
+    MD_AUCTION_UNCROSS      // The call ended: uncross price and traded quantity, imbalance as above
+} MarketDataUpdateType;
+
+//Fixed-size update record; quantities are displayed quantities, so hidden
+//iceberg reserves are never published
+typedef struct {
+    uint64_t sequence;
+    Price price;
+    int32_t quantity;
+    int32_t order_count;    // L2 only
+    char symbol[MAX_SYMBOL_LENGTH];
+    char order_id[MAX_ID_LENGTH];   // L3 only
+    uint8_t type;
+    uint8_t side;
+    uint8_t reserved[6];
+} MarketDataUpdate;
+
+//A level touched during the current event and whether it existed before it
+typedef struct {
+    Price price;
+    OrderSide side;
+    bool was_present;
+} MarketDataDirtyLevel;
+
+//Publisher of incremental L2/L3 updates. Levels touched by an event are
+//collected once each in a dirty list (deduplicated through an epoch-stamped
+//hash), and publishing walks only that list plus any levels that moved
+//across the top-N boundary.
+struct MarketDataFeed {
+    FILE* sink;                 // Binary records are written here when set, not owned
+    int depth;                  // Levels per side in the L2 view, 0 for every level
+    bool l3;                    // Publish order-level updates too
+    uint32_t snapshot_interval; // Publications between full snapshots, 0 for none
+    uint64_t next_sequence;
+    uint64_t publications;
+    MarketDataUpdate* updates;  // The current or last published event's updates
+    uint32_t update_count;
+    uint32_t update_capacity;
+    bool published;             // updates hold a finished event
+    MarketDataDirtyLevel* dirty;
+    uint32_t dirty_count;
+    uint32_t dirty_capacity;
+    uint32_t* dirty_epochs;     // Hash of dirty levels; a slot is live when its epoch is current
+    uint32_t* dirty_slots;
+    uint32_t dirty_mask;
+    uint32_t epoch;
+    bool view_touched[2];       // A touched level was inside the published view, per side
+};
+
+// Market data functions
+MarketDataFeed* create_market_data_feed(FILE* sink, int depth, bool l3, uint32_t snapshot_interval);
+void free_market_data_feed(MarketDataFeed* feed);
+void market_data_reset_view(OrderBook* book);
+void market_data_order_changed(MarketDataFeed* feed, OrderBook* book, MarketDataUpdateType type,
+                               const RestingOrder* order, const PriceLevel* level);
+uint32_t market_data_publish(MarketDataFeed* feed, OrderBook* book);
+uint32_t market_data_snapshot(MarketDataFeed* feed, OrderBook* book);
+
+#endif // MARKET_DATA_H
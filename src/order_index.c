@@ -0,0 +1,111 @@
+#include "../include/utils.h"
+#include "../src/order_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Initialize an index sized for max_orders live orders at <= 50% load
+int initialize_order_index(OrderIndex* index, uint32_t max_orders) {
+    uint32_t capacity = 16;
+    while (capacity < max_orders * 2) {
+        capacity <<= 1;
+    }
+    
+    index->entries = malloc(capacity * sizeof(OrderIndexEntry));
+    if (index->entries == NULL) {
+        perror("Failed to allocate memory for order index");
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < capacity; i++) {
+        index->entries[i].slot = NO_ORDER;
+    }
+    index->mask = capacity - 1;
+    index->count = 0;
+    return 0;
+}
+
+// Free the index table
+void free_order_index(OrderIndex* index) {
+    free(index->entries);
+    index->entries = NULL;
+}
+
+// Pack an order ID into two zero-padded 64-bit words
+void order_key_from_id(const char* order_id, uint64_t key[2]) {
+    char buffer[MAX_ID_LENGTH] = {0};
+    const char* end = memchr(order_id, '\0', MAX_ID_LENGTH);
+    size_t length = (end != NULL) ? (size_t)(end - order_id) : MAX_ID_LENGTH;
+    memcpy(buffer, order_id, length);
+    memcpy(key, buffer, MAX_ID_LENGTH);
+}
+
+// Mix both key words into a table position
+static uint32_t hash_order_key(const uint64_t key[2], uint32_t mask) {
+    uint64_t h = key[0] ^ (key[1] * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (uint32_t)h & mask;
+}
+
+// Find the table position holding a key, or the empty position where it would go
+static uint32_t probe_order_key(const OrderIndex* index, const uint64_t key[2]) {
+    uint32_t pos = hash_order_key(key, index->mask);
+    while (index->entries[pos].slot != NO_ORDER &&
+           (index->entries[pos].key[0] != key[0] || index->entries[pos].key[1] != key[1])) {
+        pos = (pos + 1) & index->mask;
+    }
+    return pos;
+}
+
+// Look up the live order slot for an ID, or NO_ORDER
+uint32_t order_index_find(const OrderIndex* index, const char* order_id) {
+    uint64_t key[2];
+    order_key_from_id(order_id, key);
+    return index->entries[probe_order_key(index, key)].slot;
+}
+
+// Map an ID to a slot; fails if the ID is already live or the index is full
+int order_index_insert(OrderIndex* index, const char* order_id, uint32_t slot) {
+    if (index->count >= (index->mask + 1) / 2) {
+        return -1;
+    }
+    
+    uint64_t key[2];
+    order_key_from_id(order_id, key);
+    uint32_t pos = probe_order_key(index, key);
+    if (index->entries[pos].slot != NO_ORDER) {
+        return -1;
+    }
+    
+    index->entries[pos].key[0] = key[0];
+    index->entries[pos].key[1] = key[1];
+    index->entries[pos].slot = slot;
+    index->count++;
+    return 0;
+}
+
+// Remove an ID, shifting later entries of the probe run back (no tombstones)
+void order_index_remove(OrderIndex* index, const char* order_id) {
+    uint64_t key[2];
+    order_key_from_id(order_id, key);
+    uint32_t pos = probe_order_key(index, key);
+    if (index->entries[pos].slot == NO_ORDER) {
+        return;
+    }
+    
+    uint32_t hole = pos;
+    uint32_t next = (pos + 1) & index->mask;
+    while (index->entries[next].slot != NO_ORDER) {
+        uint32_t home = hash_order_key(index->entries[next].key, index->mask);
+        // Move the entry into the hole unless its home lies cyclically in (hole, next]
+        if (((next - home) & index->mask) >= ((next - hole) & index->mask)) {
+            index->entries[hole] = index->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & index->mask;
+    }
+    index->entries[hole].slot = NO_ORDER;
+    index->count--;
+}
@@ -0,0 +1,14 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include "../include/utils.h"
+
+// Order ID index functions
+int initialize_order_index(OrderIndex* index, uint32_t max_orders);
+void free_order_index(OrderIndex* index);
+void order_key_from_id(const char* order_id, uint64_t key[2]);
+uint32_t order_index_find(const OrderIndex* index, const char* order_id);
+int order_index_insert(OrderIndex* index, const char* order_id, uint32_t slot);
+void order_index_remove(OrderIndex* index, const char* order_id);
+
+#endif // ORDER_INDEX_H
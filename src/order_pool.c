@@ -0,0 +1,71 @@
+#include "../include/utils.h"
+#include "../src/order_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Preallocate capacity order slots and chain them all onto the free list
+int initialize_order_pool(OrderPool* pool, uint32_t capacity) {
+    pool->orders = malloc(capacity * sizeof(RestingOrder));
+    pool->info = malloc(capacity * sizeof(OrderInfo));
+    if (pool->orders == NULL || pool->info == NULL) {
+        perror("Failed to allocate memory for orders");
+        free_order_pool(pool);
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < capacity; i++) {
+        pool->info[i].generation = 0;
+        pool->orders[i].prev = NO_ORDER;
+        pool->orders[i].next = (i + 1 < capacity) ? i + 1 : NO_ORDER;
+    }
+    pool->capacity = capacity;
+    pool->free_head = (capacity > 0) ? 0 : NO_ORDER;
+    pool->live_count = 0;
+    return 0;
+}
+
+// Free the pool storage
+void free_order_pool(OrderPool* pool) {
+    free(pool->orders);
+    free(pool->info);
+    pool->orders = NULL;
+    pool->info = NULL;
+}
+
+// Take a slot from the free list, or NO_ORDER when the pool is exhausted. The
+// bound check also stops a corrupt free link in a mapped snapshot, which is
+// not validated up front.
+uint32_t order_pool_alloc(OrderPool* pool) {
+    uint32_t slot = pool->free_head;
+    if (slot >= pool->capacity) {
+        return NO_ORDER;
+    }
+    pool->free_head = pool->orders[slot].next;
+    pool->live_count++;
+    return slot;
+}
+
+// Return a slot to the free list; bumping the generation invalidates old handles
+void order_pool_release(OrderPool* pool, uint32_t slot) {
+    RestingOrder* order = &pool->orders[slot];
+    pool->info[slot].generation++;
+    order->prev = NO_ORDER;
+    order->next = pool->free_head;
+    pool->free_head = slot;
+    pool->live_count--;
+}
+
+// Build a generation-tagged handle for a live slot
+OrderHandle order_pool_handle(const OrderPool* pool, uint32_t slot) {
+    return ((OrderHandle)pool->info[slot].generation << 32) | slot;
+}
+
+// Resolve a handle to its order, or NULL if the slot has since been reused
+RestingOrder* order_pool_resolve(const OrderPool* pool, OrderHandle handle) {
+    uint32_t slot = (uint32_t)handle;
+    if (slot >= pool->capacity || pool->info[slot].generation != (uint32_t)(handle >> 32)) {
+        return NULL;
+    }
+    return &pool->orders[slot];
+}
@@ -0,0 +1,14 @@
+#ifndef ORDER_POOL_H
+#define ORDER_POOL_H
+
+#include "../include/utils.h"
+
+// Order pool functions
+int initialize_order_pool(OrderPool* pool, uint32_t capacity);
+void free_order_pool(OrderPool* pool);
+uint32_t order_pool_alloc(OrderPool* pool);
+void order_pool_release(OrderPool* pool, uint32_t slot);
+OrderHandle order_pool_handle(const OrderPool* pool, uint32_t slot);
+RestingOrder* order_pool_resolve(const OrderPool* pool, OrderHandle handle);
+
+#endif // ORDER_POOL_H
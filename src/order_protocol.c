@@ -0,0 +1,311 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/order_protocol.h"
+#include "../src/symbol_registry.h"
+#include "../src/journal.h"
+#include "../src/stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Little-endian loads and stores; compilers fold these into single moves
+static inline uint16_t load_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t load_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t load_le64(const uint8_t* p) {
+    return (uint64_t)load_le32(p) | ((uint64_t)load_le32(p + 4) << 32);
+}
+
+static inline void store_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void store_le32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline void store_le64(uint8_t* p, uint64_t v) {
+    store_le32(p, (uint32_t)v);
+    store_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Frame size for a message type, or 0 if the type is unknown
+static size_t message_size(uint8_t type) {
+    switch (type) {
+        case MSG_SYMBOL: return MSG_SYMBOL_SIZE;
+        case MSG_ACCOUNT: return MSG_ACCOUNT_SIZE;
+        case MSG_CANCEL: return MSG_CANCEL_SIZE;
+        case MSG_NEW_ORDER:
+        case MSG_MODIFY: return MSG_ORDER_SIZE;
+        case MSG_REPLACE: return MSG_REPLACE_SIZE;
+        case MSG_NEW_STOP: return MSG_STOP_SIZE;
+        case MSG_NEW_ICEBERG: return MSG_ICEBERG_SIZE;
+        default: return 0;
+    }
+}
+
+// Decode one frame in place; returns its size, 0 if incomplete, or -1 if malformed
+int decode_order_message(const uint8_t* data, size_t length, OrderMessage* message) {
+    if (length < 4) {
+        return 0;
+    }
+    size_t frame_length = load_le16(data);
+    if (frame_length > length) {
+        return 0;
+    }
+    if (frame_length != message_size(data[2])) {
+        return -1;
+    }
+    
+    message->type = (OrderMessageType)data[2];
+    message->symbol_index = load_le32(data + 4);
+    
+    if (message->type == MSG_ACCOUNT) {
+        message->owner = message->symbol_index;
+        return (int)frame_length;
+    }
+    if (message->type == MSG_SYMBOL) {
+        memcpy(message->symbol, data + 8, MAX_SYMBOL_LENGTH);
+        message->symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
+        return (int)frame_length;
+    }
+    
+    message->order_id = load_le64(data + 8);
+    if (message->type == MSG_CANCEL) {
+        return (int)frame_length;
+    }
+    
+    // Stop and iceberg types travel only in their own frames
+    bool stop_frame = message->type == MSG_NEW_STOP;
+    bool iceberg_frame = message->type == MSG_NEW_ICEBERG;
+    bool type_ok = stop_frame ? data[28] == STOP || data[28] == STOP_LIMIT :
+                   iceberg_frame ? data[28] == ICEBERG : data[28] <= FOK;
+    if (data[3] > SELL || !type_ok || data[29] > STP_DECREMENT) {
+        return -1;
+    }
+    uint32_t quantity = load_le32(data + 24);
+    uint32_t peak = iceberg_frame ? load_le32(data + 32) : 0;
+    if (quantity > INT32_MAX || peak > INT32_MAX) {
+        return -1;
+    }
+    message->side = (OrderSide)data[3];
+    message->order_type = (OrderType)data[28];
+    message->stp = (SelfTradeMode)data[29];
+    message->price = (Price)load_le64(data + 16);
+    message->quantity = (int)quantity;
+    message->stop_price = stop_frame ? (Price)load_le64(data + 32) : 0;
+    message->display_quantity = (int)peak;
+    if (message->type == MSG_REPLACE) {
+        message->new_order_id = load_le64(data + 32);
+    }
+    return (int)frame_length;
+}
+
+// Encode one message into buffer (at least MSG_MAX_SIZE bytes); returns the frame size
+size_t encode_order_message(const OrderMessage* message, uint8_t* buffer) {
+    size_t size = message_size((uint8_t)message->type);
+    if (size == 0) {
+        return 0;
+    }
+    memset(buffer, 0, size);
+    store_le16(buffer, (uint16_t)size);
+    buffer[2] = (uint8_t)message->type;
+    store_le32(buffer + 4, (message->type == MSG_ACCOUNT) ? message->owner : message->symbol_index);
+    
+    if (message->type == MSG_ACCOUNT) {
+        return size;
+    }
+    
+    if (message->type == MSG_SYMBOL) {
+        memcpy(buffer + 8, message->symbol, strnlen(message->symbol, MAX_SYMBOL_LENGTH - 1));
+        return size;
+    }
+    
+    store_le64(buffer + 8, message->order_id);
+    if (message->type != MSG_CANCEL) {
+        buffer[3] = (uint8_t)message->side;
+        buffer[28] = (uint8_t)message->order_type;
+        buffer[29] = (uint8_t)message->stp;
+        store_le64(buffer + 16, (uint64_t)message->price);
+        store_le32(buffer + 24, (uint32_t)message->quantity);
+    }
+    if (message->type == MSG_REPLACE) {
+        store_le64(buffer + 32, message->new_order_id);
+    } else if (message->type == MSG_NEW_STOP) {
+        store_le64(buffer + 32, (uint64_t)message->stop_price);
+    } else if (message->type == MSG_NEW_ICEBERG) {
+        store_le32(buffer + 32, (uint32_t)message->display_quantity);
+    }
+    return size;
+}
+
+// Write a numeric order ID as the decimal string the book is keyed by
+void format_order_id(uint64_t order_id, char* buffer) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + order_id % 10);
+        order_id /= 10;
+    } while (order_id != 0);
+    
+    for (int i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    buffer[count] = '\0';
+}
+
+// Apply one decoded message to its book; returns -1 if it is rejected
+int registry_apply_message(SymbolRegistry* registry, const OrderMessage* message) {
+    if (message->type == MSG_SYMBOL) {
+        // Indices are assigned in order, so a binding must name the next free index
+        int index = registry_intern_symbol(registry, message->symbol);
+        return (index >= 0 && (uint32_t)index == message->symbol_index) ? 0 : -1;
+    }
+    if (message->type == MSG_ACCOUNT) {
+        // Like symbol bindings, the owner holds for the rest of the stream
+        registry->entry_owner = message->owner;
+        return 0;
+    }
+    
+    if (message->symbol_index >= registry->book_count || message->order_id > MAX_NUMERIC_ORDER_ID) {
+        return -1;
+    }
+    OrderBook* book = registry->books[message->symbol_index];
+    
+    char order_id[MAX_ID_LENGTH];
+    format_order_id(message->order_id, order_id);
+    
+    switch (message->type) {
+        case MSG_CANCEL:
+            return cancel_order(book, order_id);
+        case MSG_MODIFY:
+            return modify_order(book, order_id, message->quantity, message->price);
+        case MSG_REPLACE:
+            if (message->new_order_id > MAX_NUMERIC_ORDER_ID) {
+                return -1;
+            }
+            break;
+        case MSG_NEW_ORDER:
+        case MSG_NEW_STOP:
+        case MSG_NEW_ICEBERG:
+            break;
+        default:
+            return -1;
+    }
+    
+    Order order;
+    if (message->type == MSG_REPLACE) {
+        format_order_id(message->new_order_id, order.id);
+    } else {
+        memcpy(order.id, order_id, MAX_ID_LENGTH);
+    }
+    memcpy(order.symbol, book->symbol, MAX_SYMBOL_LENGTH);
+    order.side = message->side;
+    order.type = message->order_type;
+    order.price = message->price;
+    order.stop_price = message->stop_price;
+    order.display_quantity = message->display_quantity;
+    order.quantity = message->quantity;
+    order.owner = registry->entry_owner;
+    order.stp = message->stp;
+    order.filled_quantity = 0;
+    order.status = OPEN;
+    
+    // Only a rejection fails the message: an order that is REJECTED or that
+    // the book counts as a reject. An IOC or market order whose remainder was
+    // cancelled was applied, whether it traded or not. A rejected replacement
+    // leaves the order it would have replaced alone.
+    uint64_t rejects = book->counters.rejects;
+    if (message->type == MSG_REPLACE) {
+        cancel_replace_order(book, order_id, &order);
+    } else {
+        add_order(book, &order);
+    }
+    return (order.status == REJECTED || book->counters.rejects != rejects) ? -1 : 0;
+}
+
+// Decode and apply every complete frame in a buffer; returns the bytes consumed
+size_t process_order_messages(SymbolRegistry* registry, const uint8_t* data, size_t length) {
+    size_t offset = 0;
+    
+    while (offset < length) {
+        OrderMessage message;
+        uint64_t start = stats_stage_begin(registry->stats);
+        int size = decode_order_message(data + offset, length - offset, &message);
+        stats_stage_end(registry->stats, STAGE_DECODE, start);
+        if (size == 0) {
+            break;
+        }
+        if (size < 0) {
+            // A well-formed length lets us skip the frame, otherwise the stream is lost
+            size_t frame_length = load_le16(data + offset);
+            fprintf(stderr, "Malformed message at offset %zu\n", offset);
+            if (frame_length < 4 || frame_length > MSG_MAX_SIZE || frame_length > length - offset) {
+                break;
+            }
+            offset += frame_length;
+            continue;
+        }
+        
+        if (registry_apply_message(registry, &message) != 0) {
+            fprintf(stderr, "Rejected message type '%c' for order %llu\n",
+                    (char)message.type, (unsigned long long)message.order_id);
+        }
+        offset += (size_t)size;
+    }
+    
+    // One group commit per buffer
+    if (registry->journal != NULL) {
+        journal_commit(registry->journal);
+    }
+    return offset;
+}
+
+// Map a binary message file and apply every frame in it
+int load_orders_from_binary(SymbolRegistry* registry, const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file");
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Not a regular file: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    const uint8_t* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Failed to map file");
+        return -1;
+    }
+    
+    size_t consumed = process_order_messages(registry, data, size);
+    munmap((void*)data, size);
+    
+    if (consumed != size) {
+        fprintf(stderr, "Stopped at byte %zu of %zu in %s\n", consumed, size, filename);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef ORDER_PROTOCOL_H
+#define ORDER_PROTOCOL_H
+
+#include "../include/utils.h"
+
+//Binary order-entry frames. All fields are little-endian at fixed offsets:
+//  [0..1]   uint16 frame length in bytes
+//  [2]      uint8  message type
+//  [3]      uint8  side (0 = BUY, 1 = SELL), new/stop/iceberg/replace only
+//  [4..7]   uint32 symbol index (account ID, for ACCOUNT)
+//  [8..15]  uint64 order ID (symbol name, NUL padded, for SYMBOL)
+//  [16..23] int64  price in ticks             (all but symbol/cancel)
+//  [24..27] uint32 quantity                   (all but symbol/cancel)
+//  [28]     uint8  order type (0 = LIMIT, 1 = MARKET, 2 = IOC, 3 = FOK), new/replace only;
+//                  (4 = STOP, 5 = STOP_LIMIT), stop only; (6 = ICEBERG), iceberg only
+//  [29]     uint8  self-trade prevention mode (0 = CANCEL_NEWEST, 1 = CANCEL_OLDEST,
+//                  2 = CANCEL_BOTH, 3 = DECREMENT), new/stop/iceberg/replace only
+//  [30..31] reserved, zero                    (all but symbol/cancel)
+//  [32..39] uint64 replacement order ID       (replace)
+//           int64  stop price in ticks        (stop)
+//  [32..35] uint32 displayed peak             (iceberg)
+//  [36..39] reserved, zero                    (iceberg)
+#define MSG_SYMBOL_SIZE 16
+#define MSG_ACCOUNT_SIZE 16       // [8..15] reserved, zero
+#define MSG_CANCEL_SIZE 16
+#define MSG_ORDER_SIZE 32         // New and modify
+#define MSG_REPLACE_SIZE 40
+#define MSG_STOP_SIZE 40
+#define MSG_ICEBERG_SIZE 40
+#define MSG_MAX_SIZE MSG_REPLACE_SIZE
+#define MAX_NUMERIC_ORDER_ID 999999999999999ULL    // Fits the 15-character order ID
+
+//Message types, chosen to be readable in a hex dump
+typedef enum {
+    MSG_SYMBOL = 'S',     // Bind a symbol name to the next symbol index
+    MSG_ACCOUNT = 'A',    // Set the owner of the new orders that follow (0 for none)
+    MSG_NEW_ORDER = 'N',
+    MSG_NEW_STOP = 'T',   // New STOP or STOP_LIMIT order
+    MSG_NEW_ICEBERG = 'I',
+    MSG_CANCEL = 'X',
+    MSG_MODIFY = 'M',
+    MSG_REPLACE = 'R'     // Cancel order_id and enter new_order_id in its place
+} OrderMessageType;
+
+//Decoded view of one frame
+typedef struct {
+    OrderMessageType type;
+    OrderSide side;
+    OrderType order_type;
+    uint32_t symbol_index;
+    uint64_t order_id;
+    uint64_t new_order_id;
+    Price price;
+    Price stop_price;
+    int quantity;
+    int display_quantity;
+    uint32_t owner;         // ACCOUNT only; new orders take the registry's current owner
+    SelfTradeMode stp;
+    char symbol[MAX_SYMBOL_LENGTH];
+} OrderMessage;
+
+// Order protocol functions
+int decode_order_message(const uint8_t* data, size_t length, OrderMessage* message);
+size_t encode_order_message(const OrderMessage* message, uint8_t* buffer);
+void format_order_id(uint64_t order_id, char* buffer);
+int registry_apply_message(SymbolRegistry* registry, const OrderMessage* message);
+size_t process_order_messages(SymbolRegistry* registry, const uint8_t* data, size_t length);
+int load_orders_from_binary(SymbolRegistry* registry, const char* filename);
+
+#endif // ORDER_PROTOCOL_H
@@ -1,92 +1,283 @@
 #include "../include/utils.h"
 #include "../src/orderbook.h"
+#include "../src/order_index.h"
+#include "../src/order_pool.h"
+#include "../src/exec_report.h"
+#include "../src/journal.h"
+#include "../src/stop_book.h"
+#include "../src/market_data.h"
+#include "../src/event_clock.h"
+#include "../src/risk_gate.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Initialize price levels
-void initialize_price_levels(PriceLevel* levels, int max_levels) {
-    for (int i = 0; i < max_levels; i++) {
-        levels[i].price = 0.0;
-        levels[i].total_quantity = 0;
-        levels[i].orders = NULL;
-        levels[i].order_count = 0;
+// Initialize a price ladder with every level empty
+int initialize_price_ladder(PriceLadder* ladder, OrderSide side, int size) {
+    ladder->levels = calloc(size, sizeof(PriceLevel));
+    if (ladder->levels == NULL) {
+        perror("Failed to allocate memory for price levels");
+        return -1;
     }
+    
+    ladder->size = size;
+    ladder->base_price = 0;
+    ladder->level_count = 0;
+    ladder->low = -1;
+    ladder->high = -1;
+    ladder->side = side;
+    
+    for (int i = 0; i < size; i++) {
+        ladder->levels[i].price = i;
+        ladder->levels[i].head = NO_ORDER;
+        ladder->levels[i].tail = NO_ORDER;
+    }
+    return 0;
 }
 
-// Add an order to a price level
-void add_to_price_level(PriceLevel* level, Order* order) {
-    level->order_count++;
-    level->orders = realloc(level->orders, level->order_count * sizeof(Order));
-    if (level->orders == NULL) {
-        perror("Failed to allocate memory for orders");
-        exit(EXIT_FAILURE);
+// Free a price ladder
+void free_price_ladder(PriceLadder* ladder) {
+    free(ladder->levels);
+    ladder->levels = NULL;
+}
+
+// Slide the ladder window so that both the resting levels and the new price fit
+static int recenter_price_ladder(PriceLadder* ladder, Price price) {
+    Price low_price = price;
+    Price high_price = price;
+    
+    if (ladder->level_count > 0) {
+        if (ladder->base_price + ladder->low < low_price) {
+            low_price = ladder->base_price + ladder->low;
+        }
+        if (ladder->base_price + ladder->high > high_price) {
+            high_price = ladder->base_price + ladder->high;
+        }
     }
     
-    // Add order to the end (FIFO)
-    memcpy(&level->orders[level->order_count - 1], order, sizeof(Order));
-    level->total_quantity += order->quantity - order->filled_quantity;
+    Price span = high_price - low_price + 1;
+    if (span > ladder->size) {
+        return -1;
+    }
+    
+    // Center the occupied span in the window to leave room on both sides
+    Price new_base = low_price - (ladder->size - span) / 2;
+    
+    if (ladder->level_count > 0) {
+        int shift = (int)(ladder->base_price - new_base);
+        int count = ladder->high - ladder->low + 1;
+        memmove(&ladder->levels[ladder->low + shift], &ladder->levels[ladder->low],
+                count * sizeof(PriceLevel));
+        ladder->low += shift;
+        ladder->high += shift;
+    }
+    
+    ladder->base_price = new_base;
+    for (int i = 0; i < ladder->size; i++) {
+        if (i < ladder->low || i > ladder->high) {
+            ladder->levels[i].total_quantity = 0;
+            ladder->levels[i].displayed_quantity = 0;
+            ladder->levels[i].head = NO_ORDER;
+            ladder->levels[i].tail = NO_ORDER;
+            ladder->levels[i].order_count = 0;
+        }
+        ladder->levels[i].price = new_base + i;
+    }
+    return 0;
 }
 
-// Remove an order from a price level
-void remove_from_price_level(PriceLevel* level, const char* order_id) {
-    for (int i = 0; i < level->order_count; i++) {
-        if (strcmp(level->orders[i].id, order_id) == 0) {
-            // Update total quantity
-            level->total_quantity -= (level->orders[i].quantity - level->orders[i].filled_quantity);
-            
-            // Shift remaining orders
-            for (int j = i; j < level->order_count - 1; j++) {
-                memcpy(&level->orders[j], &level->orders[j + 1], sizeof(Order));
-            }
-            
-            level->order_count--;
-            level->orders = realloc(level->orders, level->order_count * sizeof(Order));
-            return;
-        }
+// Find the non-empty level at a price, or NULL
+PriceLevel* ladder_find_level(const PriceLadder* ladder, Price price) {
+    Price offset = price - ladder->base_price;
+    if (offset < 0 || offset >= ladder->size) {
+        return NULL;
     }
+    
+    PriceLevel* level = &ladder->levels[offset];
+    return (level->order_count > 0) ? level : NULL;
 }
 
-// Sort price levels (descending for buy, ascending for sell)
-void sort_price_levels(PriceLevel* levels, int count, OrderSide side) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if ((side == BUY && levels[j].price < levels[j + 1].price) ||
-                (side == SELL && levels[j].price > levels[j + 1].price)) {
-                // Swap price levels
-                PriceLevel temp = levels[j];
-                levels[j] = levels[j + 1];
-                levels[j + 1] = temp;
-            }
+// Get the level slot for a price, recentering the window if needed
+PriceLevel* ladder_get_level(PriceLadder* ladder, Price price) {
+    Price offset = price - ladder->base_price;
+    if (offset < 0 || offset >= ladder->size) {
+        if (recenter_price_ladder(ladder, price) != 0) {
+            return NULL;
         }
+        offset = price - ladder->base_price;
     }
+    return &ladder->levels[offset];
+}
+
+// Get the best level (highest bid, lowest ask), or NULL when the side is empty
+PriceLevel* ladder_best_level(const PriceLadder* ladder) {
+    int index = (ladder->side == BUY) ? ladder->high : ladder->low;
+    return (index >= 0) ? &ladder->levels[index] : NULL;
 }
 
-// Find the index of a price level with a specific price
-int find_price_level_index(PriceLevel* levels, int count, double price) {
-    for (int i = 0; i < count; i++) {
-        if (levels[i].price == price) {
-            return i;
+// Mark a level as occupied and update the cached bounds
+static void ladder_level_occupied(PriceLadder* ladder, PriceLevel* level) {
+    int index = (int)(level - ladder->levels);
+    
+    ladder->level_count++;
+    if (ladder->low < 0 || index < ladder->low) {
+        ladder->low = index;
+    }
+    if (ladder->high < 0 || index > ladder->high) {
+        ladder->high = index;
+    }
+}
+
+// Mark a level as empty and move the cached bounds to the next occupied level
+void ladder_level_emptied(PriceLadder* ladder, PriceLevel* level) {
+    int index = (int)(level - ladder->levels);
+    
+    ladder->level_count--;
+    if (ladder->level_count == 0) {
+        ladder->low = -1;
+        ladder->high = -1;
+        return;
+    }
+    
+    if (index == ladder->low) {
+        while (ladder->levels[ladder->low].order_count == 0) {
+            ladder->low++;
+        }
+    }
+    if (index == ladder->high) {
+        while (ladder->levels[ladder->high].order_count == 0) {
+            ladder->high--;
         }
     }
-    return -1;
 }
 
-// Execute a trade between a buy and a sell order
-void execute_trade(OrderBook* book, Order* buy_order, Order* sell_order, int quantity) {
-    printf("TRADE: %s @ %.2f, Qty: %d\n", book->symbol, sell_order->price, quantity);
+// Quantity an order shows when it joins a level: its remainder, or one peak of an iceberg
+int displayable_quantity(const OrderPool* pool, uint32_t slot) {
+    const RestingOrder* order = &pool->orders[slot];
+    int remaining = order->quantity - order->filled_quantity;
+    if (order->type == ICEBERG && pool->info[slot].display_quantity < remaining) {
+        return pool->info[slot].display_quantity;
+    }
+    return remaining;
+}
+
+// Link an order slot at the back of a level's queue
+static void link_level_tail(RestingOrder* orders, PriceLevel* level, uint32_t slot) {
+    RestingOrder* order = &orders[slot];
+    
+    order->prev = level->tail;
+    order->next = NO_ORDER;
+    if (level->tail != NO_ORDER) {
+        orders[level->tail].next = slot;
+    } else {
+        level->head = slot;
+    }
+    level->tail = slot;
+}
+
+// Unlink an order slot from anywhere in a level's queue
+static void unlink_level_order(RestingOrder* orders, PriceLevel* level, uint32_t slot) {
+    RestingOrder* order = &orders[slot];
+    
+    if (order->prev != NO_ORDER) {
+        orders[order->prev].next = order->next;
+    } else {
+        level->head = order->next;
+    }
+    if (order->next != NO_ORDER) {
+        orders[order->next].prev = order->prev;
+    } else {
+        level->tail = order->prev;
+    }
+    order->prev = NO_ORDER;
+    order->next = NO_ORDER;
+}
+
+// Append an order slot to the back of a price level (FIFO), showing displayed of it
+void add_to_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level, uint32_t slot, int displayed) {
+    RestingOrder* order = &orders[slot];
+    link_level_tail(orders, level, slot);
+    
+    order->displayed = displayed;
+    level->order_count++;
+    level->total_quantity += order->quantity - order->filled_quantity;
+    level->displayed_quantity += order->displayed;
+    
+    if (level->order_count == 1) {
+        ladder_level_occupied(ladder, level);
+    }
+}
+
+// Unlink an order slot from anywhere in a price level
+void remove_from_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level, uint32_t slot) {
+    RestingOrder* order = &orders[slot];
+    unlink_level_order(orders, level, slot);
+    
+    // Update total and displayed quantity
+    level->total_quantity -= order->quantity - order->filled_quantity;
+    level->displayed_quantity -= order->displayed;
+    level->order_count--;
+    
+    if (level->order_count == 0) {
+        ladder_level_emptied(ladder, level);
+    }
+}
+
+// Unlink and return the oldest order slot in a price level
+uint32_t pop_front_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level) {
+    uint32_t slot = level->head;
+    if (slot != NO_ORDER) {
+        remove_from_price_level(orders, ladder, level, slot);
+    }
+    return slot;
+}
+
+// Execute a trade between an incoming (aggressor) and a resting order
+void execute_trade(OrderBook* book, RestingOrder* aggressor, RestingOrder* resting, Price price, int quantity) {
+    // Record the execution; formatting happens on the ring's consumer side.
+    // Only reporting reads the orders' cold fields.
+    if (book->exec_ring != NULL || book->journal != NULL) {
+        const OrderInfo* info = book->pool.info;
+        ExecReport local = {0};
+        ExecReport* report = (book->exec_ring != NULL) ? exec_ring_claim(book->exec_ring) : &local;
+        report->event_sequence = book->event_sequence;
+        report->timestamp_ns = event_clock_ns();
+        report->price = price;
+        report->quantity = quantity;
+        report->aggressor_side = aggressor->side;
+        memcpy(report->aggressor_id, info[aggressor - book->pool.orders].id, MAX_ID_LENGTH);
+        memcpy(report->resting_id, info[resting - book->pool.orders].id, MAX_ID_LENGTH);
+        memcpy(report->symbol, book->symbol, MAX_SYMBOL_LENGTH);
+        if (book->journal != NULL) {
+            journal_append_execution(book->journal, report);
+        }
+        if (book->exec_ring != NULL) {
+            exec_ring_commit(book->exec_ring);
+        }
+    }
+    
+    // Widen the command's trade range for the stop triggers
+    if (price > book->trade_high) {
+        book->trade_high = price;
+    }
+    if (price < book->trade_low) {
+        book->trade_low = price;
+    }
+    book->last_trade_price = price;
+    book->counters.trades++;
+    book->counters.traded_quantity += (uint64_t)quantity;
     
     // Update filled quantities
-    buy_order->filled_quantity += quantity;
-    sell_order->filled_quantity += quantity;
+    aggressor->filled_quantity += quantity;
+    resting->filled_quantity += quantity;
     
     // Update order statuses
-    update_order_status(buy_order);
-    update_order_status(sell_order);
+    update_order_status(aggressor);
+    update_order_status(resting);
 }
 
 // Update the status of an order based on filled quantity
-void update_order_status(Order* order) {
+void update_order_status(RestingOrder* order) {
     if (order->filled_quantity == 0) {
         order->status = OPEN;
     } else if (order->filled_quantity == order->quantity) {
@@ -96,43 +287,316 @@ void update_order_status(Order* order) {
     }
 }
 
-// Clean up filled orders from the order book
-void cleanup_filled_orders(OrderBook* book) {
-    // Clean up buy side
-    for (int i = 0; i < book->buy_level_count; i++) {
-        for (int j = 0; j < book->buy_levels[i].order_count; j++) {
-            if (book->buy_levels[i].orders[j].status == FILLED) {
-                remove_from_price_level(&book->buy_levels[i], book->buy_levels[i].orders[j].id);
-                j--; // Check the same index again after removal
-            }
+// Return a pool slot whose order is done, closing it for the risk gate
+void release_order_slot(OrderBook* book, uint32_t slot) {
+    if (book->risk_gate != NULL) {
+        risk_order_closed(book->risk_gate, book->pool.orders[slot].owner);
+    }
+    order_pool_release(&book->pool, slot);
+}
+
+// Pop the filled order at the front of a level and return its slot to the pool
+void retire_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level) {
+    uint32_t slot = pop_front_price_level(book->pool.orders, ladder, level);
+    order_index_remove(&book->order_index, book->pool.info[slot].id);
+    release_order_slot(book, slot);
+}
+
+// Book a trade of quantity against the order at the front of a level. A
+// filled order is retired; an iceberg whose peak is gone shows its next peak
+// from the back of the queue, which only relinks the slot.
+void settle_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level, int quantity) {
+    uint32_t slot = level->head;
+    RestingOrder* order = &book->pool.orders[slot];
+    
+    level->total_quantity -= quantity;
+    level->displayed_quantity -= quantity;
+    order->displayed -= quantity;
+    
+    MarketDataFeed* feed = book->market_data;
+    if (order->status == FILLED) {
+        if (feed != NULL) {
+            market_data_order_changed(feed, book, MD_ORDER_DELETE, order, level);
+        }
+        retire_front_order(book, ladder, level);
+    } else if (order->displayed == 0) {
+        // A new peak loses priority, so it is published as a new order
+        unlink_level_order(book->pool.orders, level, slot);
+        link_level_tail(book->pool.orders, level, slot);
+        order->displayed = displayable_quantity(&book->pool, slot);
+        level->displayed_quantity += order->displayed;
+        if (feed != NULL) {
+            market_data_order_changed(feed, book, MD_ORDER_DELETE, order, level);
+            market_data_order_changed(feed, book, MD_ORDER_ADD, order, level);
+        }
+    } else if (feed != NULL) {
+        market_data_order_changed(feed, book, MD_ORDER_MODIFY, order, level);
+    }
+}
+
+// Take quantity off the open part of the order at the front of a level
+// without a trade. An order left with nothing open is cancelled; otherwise it
+// keeps its place and its shown peak shrinks to what is left.
+void reduce_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level, int quantity) {
+    uint32_t slot = level->head;
+    RestingOrder* order = &book->pool.orders[slot];
+    MarketDataFeed* feed = book->market_data;
+    int remaining = order->quantity - order->filled_quantity;
+    
+    if (quantity >= remaining) {
+        order->status = CANCELLED;
+        remove_from_price_level(book->pool.orders, ladder, level, slot);
+        if (feed != NULL) {
+            market_data_order_changed(feed, book, MD_ORDER_DELETE, order, level);
+        }
+        order_index_remove(&book->order_index, book->pool.info[slot].id);
+        release_order_slot(book, slot);
+        return;
+    }
+    
+    order->quantity -= quantity;
+    level->total_quantity -= quantity;
+    remaining -= quantity;
+    if (order->displayed > remaining) {
+        level->displayed_quantity -= order->displayed - remaining;
+        order->displayed = remaining;
+    }
+    if (feed != NULL) {
+        market_data_order_changed(feed, book, MD_ORDER_MODIFY, order, level);
+    }
+}
+
+// Quantities a self-trade prevention mode takes off the newer and the older
+// of two same-owner orders with the given open quantities
+void self_trade_cuts(SelfTradeMode mode, int newer_open, int older_open, int* newer_cut, int* older_cut) {
+    int smaller = (newer_open < older_open) ? newer_open : older_open;
+    switch (mode) {
+        case STP_CANCEL_OLDEST:
+            *newer_cut = 0;
+            *older_cut = older_open;
+            break;
+        case STP_CANCEL_BOTH:
+            *newer_cut = newer_open;
+            *older_cut = older_open;
+            break;
+        case STP_DECREMENT:
+            *newer_cut = smaller;
+            *older_cut = smaller;
+            break;
+        default:
+            *newer_cut = newer_open;
+            *older_cut = 0;
+            break;
+    }
+}
+
+// Apply the incoming order's self-trade prevention mode against the order of
+// the same owner at the front of a level, instead of trading with it.
+// Returns false once nothing of the incoming order is left, which cancels it.
+static bool prevent_self_trade(OrderBook* book, RestingOrder* order, PriceLadder* ladder, PriceLevel* level) {
+    const RestingOrder* resting = &book->pool.orders[level->head];
+    int cut;
+    int resting_cut;
+    self_trade_cuts((SelfTradeMode)order->stp, order->quantity - order->filled_quantity,
+                    resting->quantity - resting->filled_quantity, &cut, &resting_cut);
+    
+    if (resting_cut > 0) {
+        reduce_front_order(book, ladder, level, resting_cut);
+    }
+    order->quantity -= cut;
+    if (order->quantity == order->filled_quantity) {
+        order->status = CANCELLED;
+        return false;
+    }
+    return true;
+}
+
+// Check whether a level's price is acceptable to an incoming order
+static bool level_crosses(OrderSide side, OrderType type, Price limit, const PriceLevel* level) {
+    if (type == MARKET) {
+        return true;
+    }
+    return (side == BUY) ? level->price <= limit : level->price >= limit;
+}
+
+// Sum what a fill-or-kill order with an owner can take from a level. Orders of
+// the same owner are skipped when its mode cancels them; under any other mode
+// meeting one would cut the order short, so the level gives nothing (-1).
+static int level_fillable_quantity(const OrderBook* book, const Order* order, const PriceLevel* level) {
+    int quantity = 0;
+    for (uint32_t slot = level->head; slot != NO_ORDER; slot = book->pool.orders[slot].next) {
+        const RestingOrder* resting = &book->pool.orders[slot];
+        if (resting->owner != order->owner) {
+            quantity += resting->quantity - resting->filled_quantity;
+        } else if (order->stp != STP_CANCEL_OLDEST) {
+            return -1;
+        }
+    }
+    return quantity;
+}
+
+// Fill-or-kill depth check: sum the crossing levels' quantities from the best
+// price outward. Only an order with an owner looks inside the levels, to
+// leave out its own orders.
+bool can_fill_completely(const OrderBook* book, const Order* order) {
+    const PriceLadder* opposite = (order->side == BUY) ? &book->asks : &book->bids;
+    int needed = order->quantity - order->filled_quantity;
+    if (opposite->level_count == 0) {
+        return needed <= 0;
+    }
+    
+    // Asks improve upward from low, bids downward from high
+    int step = (order->side == BUY) ? 1 : -1;
+    int end = (order->side == BUY) ? opposite->high + 1 : opposite->low - 1;
+    for (int i = (order->side == BUY) ? opposite->low : opposite->high; i != end && needed > 0; i += step) {
+        const PriceLevel* level = &opposite->levels[i];
+        if (level->order_count == 0) {
+            continue;
+        }
+        if (!level_crosses(order->side, order->type, order->price, level)) {
+            break;
+        }
+        if (order->owner == NO_OWNER) {
+            needed -= level->total_quantity;
+            continue;
+        }
+        int fillable = level_fillable_quantity(book, order, level);
+        if (fillable < 0) {
+            return false;
+        }
+        needed -= fillable;
+    }
+    return needed <= 0;
+}
+
+// Match an incoming order against the best levels of the opposite side.
+// Only the levels it crosses are touched; filled resting orders are popped
+// as they complete and emptied levels drop out of the ladder immediately.
+// An incoming iceberg trades its whole quantity; only resting ones hide.
+// Self-trade prevention is one owner compare per resting order met.
+void match_incoming_order(OrderBook* book, RestingOrder* order) {
+    PriceLadder* opposite = (order->side == BUY) ? &book->asks : &book->bids;
+    Price limit = book->pool.info[order - book->pool.orders].price;
+    uint32_t owner = order->owner;
+    
+    while (order->filled_quantity < order->quantity) {
+        PriceLevel* level = ladder_best_level(opposite);
+        if (level == NULL || !level_crosses((OrderSide)order->side, (OrderType)order->type, limit, level)) {
+            break;
         }
         
-        // Remove empty price levels
-        if (book->buy_levels[i].order_count == 0) {
-            for (int k = i; k < book->buy_level_count - 1; k++) {
-                book->buy_levels[k] = book->buy_levels[k + 1];
+        // Consume the level in FIFO order at the resting price
+        while (level->head != NO_ORDER && order->filled_quantity < order->quantity) {
+            // Only the shown part of the front order trades before it requeues
+            RestingOrder* resting = &book->pool.orders[level->head];
+            if (resting->filled_quantity >= resting->quantity) {
+                // Nothing open is left to trade; retire it instead of trading zero
+                reduce_front_order(book, opposite, level, 0);
+                continue;
             }
-            book->buy_level_count--;
-            i--; // Check the same index again
+            if (resting->owner == owner && owner != NO_OWNER) {
+                if (!prevent_self_trade(book, order, opposite, level)) {
+                    return;
+                }
+                continue;
+            }
+            int incoming_qty = order->quantity - order->filled_quantity;
+            int resting_qty = resting->displayed;
+            int trade_qty = (incoming_qty < resting_qty) ? incoming_qty : resting_qty;
+            
+            execute_trade(book, order, resting, level->price, trade_qty);
+            settle_front_order(book, opposite, level, trade_qty);
         }
     }
+}
+
+// Match an order that already holds a pool slot, then rest the remainder of a
+// limit order and retire anything else. indexed tells whether the slot is in
+// the ID index already (armed stops are). Returns the resting order or NULL.
+// During an auction call nothing matches, so only limit orders get in.
+RestingOrder* activate_order(OrderBook* book, uint32_t slot, bool indexed) {
+    RestingOrder* order = &book->pool.orders[slot];
+    if (!book->auction.call_phase) {
+        match_incoming_order(book, order);
+    }
     
-    // Clean up sell side
-    for (int i = 0; i < book->sell_level_count; i++) {
-        for (int j = 0; j < book->sell_levels[i].order_count; j++) {
-            if (book->sell_levels[i].orders[j].status == FILLED) {
-                remove_from_price_level(&book->sell_levels[i], book->sell_levels[i].orders[j].id);
-                j--; // Check the same index again after removal
+    if (order->status != FILLED) {
+        // Only limit and iceberg orders rest, unless self-trade prevention
+        // cancelled them; the unfilled part of anything else is cancelled
+        if ((order->type == LIMIT || order->type == ICEBERG) && order->status != CANCELLED) {
+            PriceLadder* ladder = (order->side == BUY) ? &book->bids : &book->asks;
+            Price price = book->pool.info[slot].price;
+            PriceLevel* level = ladder_get_level(ladder, price);
+            if (level != NULL) {
+                add_to_price_level(book->pool.orders, ladder, level, slot, displayable_quantity(&book->pool, slot));
+                
+                // Count a new level and raise the depth high-water marks
+                BookCounters* counters = &book->counters;
+                if (level->order_count == 1) {
+                    counters->levels_created++;
+                }
+                if ((uint32_t)level->order_count > counters->max_queue_depth) {
+                    counters->max_queue_depth = (uint32_t)level->order_count;
+                }
+                if ((uint32_t)ladder->level_count > counters->max_levels) {
+                    counters->max_levels = (uint32_t)ladder->level_count;
+                }
+                if (book->market_data != NULL) {
+                    market_data_order_changed(book->market_data, book, MD_ORDER_ADD, order, level);
+                }
+                if (!indexed) {
+                    order_index_insert(&book->order_index, book->pool.info[slot].id, slot);
+                }
+                return order;
             }
+            fprintf(stderr, "Price outside ladder range: %.2f\n", price_to_double(price));
         }
-        
-        // Remove empty price levels
-        if (book->sell_levels[i].order_count == 0) {
-            for (int k = i; k < book->sell_level_count - 1; k++) {
-                book->sell_levels[k] = book->sell_levels[k + 1];
-            }
-            book->sell_level_count--;
-            i--; // Check the same index again
+        order->status = CANCELLED;
+    }
+    
+    if (indexed) {
+        order_index_remove(&book->order_index, book->pool.info[slot].id);
+    }
+    release_order_slot(book, slot);
+    return NULL;
+}
+
+// Park a stop order in its side's trigger heap and index it by ID
+int arm_stop_order(OrderBook* book, uint32_t slot) {
+    const OrderInfo* info = &book->pool.info[slot];
+    StopHeap* heap = (book->pool.orders[slot].side == BUY) ? &book->buy_stops : &book->sell_stops;
+    if (stop_heap_push(heap, book->pool.orders, slot, info->stop_price, book->stop_sequence,
+                       book->pool.capacity) != 0) {
+        return -1;
+    }
+    book->stop_sequence++;
+    order_index_insert(&book->order_index, info->id, slot);
+    return 0;
+}
+
+// Fire every stop reached by the current command's trades. Each triggered
+// stop is matched as a new MARKET (STOP) or LIMIT (STOP_LIMIT) order and its
+// own trades widen the range, so cascades run in this loop, not by recursion.
+// When both sides have a triggered stop, the earlier arrival goes first.
+void run_stop_triggers(OrderBook* book) {
+    while (book->trade_high >= book->trade_low) {
+        bool buy = stop_heap_triggered(&book->buy_stops, book->trade_low, book->trade_high);
+        bool sell = stop_heap_triggered(&book->sell_stops, book->trade_low, book->trade_high);
+        if (buy && sell) {
+            buy = book->buy_stops.entries[0].sequence < book->sell_stops.entries[0].sequence;
+        } else if (!buy && !sell) {
+            break;
         }
+        
+        StopHeap* heap = buy ? &book->buy_stops : &book->sell_stops;
+        uint32_t slot = heap->entries[0].slot;
+        stop_heap_remove(heap, book->pool.orders, 0);
+        
+        RestingOrder* order = &book->pool.orders[slot];
+        order->type = (order->type == STOP) ? MARKET : LIMIT;
+        activate_order(book, slot, true);
     }
-}
\ No newline at end of file
+    
+    book->trade_high = INT64_MIN;
+    book->trade_low = INT64_MAX;
+}
@@ -4,13 +4,27 @@
 #include "../include/utils.h"
 
 // Core order book functions
-void initialize_price_levels(PriceLevel* levels, int max_levels);
-void add_to_price_level(PriceLevel* level, Order* order);
-void remove_from_price_level(PriceLevel* level, const char* order_id);
-void sort_price_levels(PriceLevel* levels, int count, OrderSide side);
-int find_price_level_index(PriceLevel* levels, int count, double price);
-void execute_trade(OrderBook* book, Order* buy_order, Order* sell_order, int quantity);
-void update_order_status(Order* order);
-void cleanup_filled_orders(OrderBook* book);
+int initialize_price_ladder(PriceLadder* ladder, OrderSide side, int size);
+void free_price_ladder(PriceLadder* ladder);
+PriceLevel* ladder_find_level(const PriceLadder* ladder, Price price);
+PriceLevel* ladder_get_level(PriceLadder* ladder, Price price);
+PriceLevel* ladder_best_level(const PriceLadder* ladder);
+void ladder_level_emptied(PriceLadder* ladder, PriceLevel* level);
+int displayable_quantity(const OrderPool* pool, uint32_t slot);
+void add_to_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level, uint32_t slot, int displayed);
+void remove_from_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level, uint32_t slot);
+uint32_t pop_front_price_level(RestingOrder* orders, PriceLadder* ladder, PriceLevel* level);
+void execute_trade(OrderBook* book, RestingOrder* aggressor, RestingOrder* resting, Price price, int quantity);
+void update_order_status(RestingOrder* order);
+void release_order_slot(OrderBook* book, uint32_t slot);
+void retire_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level);
+void settle_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level, int quantity);
+void reduce_front_order(OrderBook* book, PriceLadder* ladder, PriceLevel* level, int quantity);
+void self_trade_cuts(SelfTradeMode mode, int newer_open, int older_open, int* newer_cut, int* older_cut);
+bool can_fill_completely(const OrderBook* book, const Order* order);
+void match_incoming_order(OrderBook* book, RestingOrder* order);
+RestingOrder* activate_order(OrderBook* book, uint32_t slot, bool indexed);
+int arm_stop_order(OrderBook* book, uint32_t slot);
+void run_stop_triggers(OrderBook* book);
 
-#endif // ORDERBOOK_H
\ No newline at end of file
+#endif // ORDERBOOK_H
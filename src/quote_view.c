@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/quote_view.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+// Create a cache-line aligned view of the top depth levels per side
+QuoteView* create_quote_view(int depth) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(QuoteView)) != 0) {
+        perror("Failed to allocate memory for quote view");
+        return NULL;
+    }
+    
+    QuoteView* view = memory;
+    memset(view, 0, sizeof(QuoteView));
+    if (depth < 1) {
+        depth = 1;
+    }
+    view->depth = (depth > QUOTE_MAX_DEPTH) ? QUOTE_MAX_DEPTH : depth;
+    return view;
+}
+
+// Free a view; detach it from its book first
+void free_quote_view(QuoteView* view) {
+    free(view);
+}
+
+// Attach a view to a book and publish the book's current top levels to it
+void attach_quote_view(OrderBook* book, QuoteView* view) {
+    book->quote_view = view;
+    if (view != NULL) {
+        publish_quote_view(view, book);
+    }
+}
+
+// Copy a side's best levels, best first; returns how many there were
+static int32_t copy_top_levels(const PriceLadder* ladder, QuoteLevel* levels, int depth) {
+    if (ladder->level_count == 0) {
+        return 0;
+    }
+    
+    int32_t count = 0;
+    int step = (ladder->side == BUY) ? -1 : 1;
+    int end = ((ladder->side == BUY) ? ladder->low : ladder->high) + step;
+    for (int i = (ladder->side == BUY) ? ladder->high : ladder->low; i != end && count < depth; i += step) {
+        const PriceLevel* level = &ladder->levels[i];
+        if (level->order_count > 0) {
+            levels[count].price = level->price;
+            levels[count].quantity = level->displayed_quantity;
+            levels[count].order_count = level->order_count;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Publish the book's top levels at the end of an event. Nothing is written
+// when they are unchanged, so readers keep their cached copy of the view.
+void publish_quote_view(QuoteView* view, const OrderBook* book) {
+    BookQuote next;
+    memset(&next, 0, sizeof(next));
+    next.version = view->quote.version;
+    next.bid_count = copy_top_levels(&book->bids, next.bids, view->depth);
+    next.ask_count = copy_top_levels(&book->asks, next.asks, view->depth);
+    if (memcmp(&next, &view->quote, sizeof(next)) == 0) {
+        return;
+    }
+    next.version++;
+    
+    // Readers that overlap the odd sequence, or see it change, retry
+    uint64_t sequence = view->sequence;
+    __atomic_store_n(&view->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&view->quote, &next, sizeof(next));
+    __atomic_store_n(&view->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Copy a consistent quote from any thread without locking; returns its version
+uint64_t read_quote_view(const QuoteView* view, BookQuote* quote) {
+    for (;;) {
+        uint64_t before = __atomic_load_n(&view->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(quote, &view->quote, sizeof(BookQuote));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&view->sequence, __ATOMIC_RELAXED) == before) {
+            return quote->version;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef QUOTE_VIEW_H
+#define QUOTE_VIEW_H
+
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+
+#define QUOTE_MAX_DEPTH 8   // Most levels per side a quote view can hold
+
+//One shown price level
+typedef struct {
+    Price price;
+    int32_t quantity;       // Displayed quantity, so hidden iceberg reserves are left out
+    int32_t order_count;
+} QuoteLevel;
+
+//Best bid/offer and the next levels behind them, best first
+typedef struct {
+    uint64_t version;       // Bumped each time the published levels change
+    int32_t bid_count;
+    int32_t ask_count;
+    QuoteLevel bids[QUOTE_MAX_DEPTH];
+    QuoteLevel asks[QUOTE_MAX_DEPTH];
+} BookQuote;
+
+//Top-of-book view written by the matching thread and read by any thread
+//under a sequence lock. The view sits apart from the book, so readers never
+//touch the book's cache lines, and the lines are only written when the top
+//levels actually change.
+struct QuoteView {
+    uint64_t sequence;      // Odd while the matching thread is writing
+    int depth;              // Levels per side, at most QUOTE_MAX_DEPTH
+    char pad[CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(int)];
+    BookQuote quote;
+};
+
+// Quote view functions
+QuoteView* create_quote_view(int depth);
+void free_quote_view(QuoteView* view);
+void attach_quote_view(OrderBook* book, QuoteView* view);
+void publish_quote_view(QuoteView* view, const OrderBook* book);
+uint64_t read_quote_view(const QuoteView* view, BookQuote* quote);
+
+#endif // QUOTE_VIEW_H
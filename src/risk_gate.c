@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/risk_gate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Create a gate with a preallocated account table, every account starting
+// with the default limits (no limits when defaults is NULL)
+RiskGate* create_risk_gate(uint32_t account_count, const RiskLimits* defaults) {
+    RiskGate* gate = calloc(1, sizeof(RiskGate));
+    void* memory = NULL;
+    if (gate == NULL || account_count == 0 ||
+        posix_memalign(&memory, CACHE_LINE_SIZE, (size_t)account_count * sizeof(RiskAccount)) != 0) {
+        perror("Failed to allocate memory for risk gate");
+        free(gate);
+        return NULL;
+    }
+    
+    gate->accounts = memory;
+    gate->account_count = account_count;
+    memset(gate->accounts, 0, (size_t)account_count * sizeof(RiskAccount));
+    if (defaults != NULL) {
+        for (uint32_t owner = 0; owner < account_count; owner++) {
+            risk_set_limits(gate, owner, defaults);
+        }
+    }
+    return gate;
+}
+
+// Free a gate; detach it from its books first
+void free_risk_gate(RiskGate* gate) {
+    if (gate != NULL) {
+        free(gate->accounts);
+        free(gate);
+    }
+}
+
+// Set one account's limits, keeping its open orders and token bucket
+int risk_set_limits(RiskGate* gate, uint32_t owner, const RiskLimits* limits) {
+    if (owner >= gate->account_count) {
+        return -1;
+    }
+    RiskAccount* account = &gate->accounts[owner];
+    account->max_quantity = limits->max_quantity;
+    account->max_notional = limits->max_notional;
+    account->collar = limits->collar;
+    account->max_open_orders = limits->max_open_orders;
+    account->interval_ns = (limits->rate > 0) ? 1000000000ULL / limits->rate : 0;
+    account->burst_ns = (limits->burst > 1) ? (limits->burst - 1) * account->interval_ns : 0;
+    return 0;
+}
+
+// Load per-account limits from a CSV file of
+// "Owner,MaxQuantity,MaxNotional,Collar,MaxOpenOrders,Rate,Burst" rows after a
+// header line, with the notional and collar in currency units
+int load_risk_limits(RiskGate* gate, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Failed to open risk limits file");
+        return -1;
+    }
+    
+    char line[256];
+    int line_num = 0;
+    int result = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_num++;
+        if (line_num == 1 || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        
+        unsigned int owner;
+        double notional;
+        double collar;
+        RiskLimits limits;
+        if (sscanf(line, "%u,%d,%lf,%lf,%u,%u,%u", &owner, &limits.max_quantity, &notional, &collar,
+                   &limits.max_open_orders, &limits.rate, &limits.burst) != 7) {
+            fprintf(stderr, "Invalid risk limits at line %d\n", line_num);
+            result = -1;
+            continue;
+        }
+        limits.max_notional = price_from_double(notional);
+        limits.collar = price_from_double(collar);
+        if (risk_set_limits(gate, owner, &limits) != 0) {
+            fprintf(stderr, "Account %u is outside the risk table at line %d\n", owner, line_num);
+            result = -1;
+        }
+    }
+    
+    fclose(file);
+    return result;
+}
+
+// Price collars are measured from the last trade, or before the first trade
+// from the BBO mid, or the one side there is; 0 when there is none
+static Price reference_price(const OrderBook* book) {
+    if (book->last_trade_price != 0) {
+        return book->last_trade_price;
+    }
+    const PriceLevel* bid = best_price_level(book, BUY);
+    const PriceLevel* ask = best_price_level(book, SELL);
+    if (bid != NULL && ask != NULL) {
+        return (bid->price + ask->price) / 2;
+    }
+    return (bid != NULL) ? bid->price : (ask != NULL) ? ask->price : 0;
+}
+
+// Size and price rules of an order, against its account's table entry
+static RiskRule check_size_and_price(const RiskAccount* account, const OrderBook* book, const Order* order) {
+    if (order->quantity <= 0 || (order->type == ICEBERG && order->display_quantity <= 0)) {
+        return RISK_BAD_QUANTITY;
+    }
+    
+    // The price an order is valued at: a stop's trigger, a market order's
+    // reference price, or the limit
+    Price price = (order->type == STOP) ? order->stop_price : order->price;
+    if (order->type == MARKET) {
+        price = (account->max_notional != 0) ? reference_price(book) : 0;
+    } else if (price <= 0 || (order->type == STOP_LIMIT && order->stop_price <= 0)) {
+        return RISK_BAD_PRICE;
+    }
+    
+    if (account->max_quantity != 0 && order->quantity > account->max_quantity) {
+        return RISK_MAX_QUANTITY;
+    }
+    if (account->max_notional != 0 && price > account->max_notional / order->quantity) {
+        return RISK_MAX_NOTIONAL;
+    }
+    if (account->collar != 0 && order->type != MARKET) {
+        Price reference = reference_price(book);
+        if (reference != 0 && (price > reference + account->collar || price < reference - account->collar)) {
+            return RISK_PRICE_COLLAR;
+        }
+    }
+    return RISK_ACCEPTED;
+}
+
+// Run the rules in order against the account's table entry. Each is a
+// compare or two; only the rate rule changes state, so a rejected order
+// costs its account nothing.
+static RiskRule check_order(RiskGate* gate, const OrderBook* book, const Order* order) {
+    if (order->owner >= gate->account_count) {
+        return RISK_UNKNOWN_ACCOUNT;
+    }
+    RiskAccount* account = &gate->accounts[order->owner];
+    RiskRule rule = check_size_and_price(account, book, order);
+    if (rule != RISK_ACCEPTED) {
+        return rule;
+    }
+    if (account->max_open_orders != 0 && account->open_orders >= account->max_open_orders) {
+        return RISK_MAX_OPEN_ORDERS;
+    }
+    
+    // Token bucket: each order pushes the time the bucket is full again one
+    // interval further; it may run at most burst_ns ahead of the event time
+    if (account->interval_ns != 0) {
+        uint64_t now = book->event_time_ns;
+        uint64_t full = (account->full_ns > now) ? account->full_ns : now;
+        if (full - now > account->burst_ns) {
+            return RISK_MESSAGE_RATE;
+        }
+        account->full_ns = full + account->interval_ns;
+    }
+    return RISK_ACCEPTED;
+}
+
+// Keep and count the outcome of a check
+static RiskRule record_outcome(RiskGate* gate, const Order* order, RiskRule rule) {
+    gate->last_rule = rule;
+    gate->counts[rule]++;
+    if (rule != RISK_ACCEPTED && rule != RISK_UNKNOWN_ACCOUNT) {
+        gate->accounts[order->owner].rejected++;
+    }
+    return rule;
+}
+
+// Check a new order against its account's limits before it reaches the book,
+// counting the outcome
+RiskRule risk_check_order(RiskGate* gate, const OrderBook* book, const Order* order) {
+    return record_outcome(gate, order, check_order(gate, book, order));
+}
+
+// Check an order as a modify would leave it (its new total quantity and
+// price) against its account's size, notional, price and collar rules. The
+// order is open already, so the open order and rate rules do not apply.
+RiskRule risk_check_replace(RiskGate* gate, const OrderBook* book, const Order* order) {
+    RiskRule rule = (order->owner < gate->account_count) ?
+        check_size_and_price(&gate->accounts[order->owner], book, order) : RISK_UNKNOWN_ACCOUNT;
+    return record_outcome(gate, order, rule);
+}
+
+// An order of the account took a pool slot
+void risk_order_opened(RiskGate* gate, uint32_t owner) {
+    if (owner < gate->account_count) {
+        gate->accounts[owner].open_orders++;
+    }
+}
+
+// An order of the account gave its pool slot back
+void risk_order_closed(RiskGate* gate, uint32_t owner) {
+    if (owner < gate->account_count && gate->accounts[owner].open_orders > 0) {
+        gate->accounts[owner].open_orders--;
+    }
+}
+
+// Count the live orders of a book that was filled before the gate was attached
+void risk_count_open_orders(RiskGate* gate, const OrderBook* book) {
+    const OrderIndex* index = &book->order_index;
+    for (uint32_t i = 0; i <= index->mask; i++) {
+        if (index->entries[i].slot != NO_ORDER) {
+            risk_order_opened(gate, book->pool.orders[index->entries[i].slot].owner);
+        }
+    }
+}
+
+// Rule name for display
+const char* risk_rule_to_string(RiskRule rule) {
+    switch (rule) {
+        case RISK_ACCEPTED: return "accepted";
+        case RISK_UNKNOWN_ACCOUNT: return "unknown account";
+        case RISK_BAD_QUANTITY: return "bad quantity";
+        case RISK_BAD_PRICE: return "bad price";
+        case RISK_MAX_QUANTITY: return "max quantity";
+        case RISK_MAX_NOTIONAL: return "max notional";
+        case RISK_PRICE_COLLAR: return "price collar";
+        case RISK_MAX_OPEN_ORDERS: return "max open orders";
+        case RISK_MESSAGE_RATE: return "message rate";
+        default: return "unknown";
+    }
+}
+
+// Print how many orders each rule let through or rejected
+void print_risk_counts(const RiskGate* gate) {
+    printf("\n=== RISK GATE ===\n");
+    for (int rule = RISK_ACCEPTED; rule < RISK_RULE_COUNT; rule++) {
+        printf("%-18s %llu\n", risk_rule_to_string((RiskRule)rule), (unsigned long long)gate->counts[rule]);
+    }
+    printf("=================\n");
+}
@@ -0,0 +1,70 @@
+#ifndef RISK_GATE_H
+#define RISK_GATE_H
+
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+
+#define RISK_MAX_ACCOUNTS 1024   // Default account table size; owner IDs index it directly
+
+//Outcome of a pre-trade check: accepted, or the first rule the order broke,
+//in the order the rules are checked
+typedef enum {
+    RISK_ACCEPTED,
+    RISK_UNKNOWN_ACCOUNT,   // Owner outside the account table
+    RISK_BAD_QUANTITY,      // Zero or negative quantity, or iceberg peak
+    RISK_BAD_PRICE,         // Zero or negative price where the order type needs one
+    RISK_MAX_QUANTITY,
+    RISK_MAX_NOTIONAL,
+    RISK_PRICE_COLLAR,      // Too far from the last trade, or from the BBO before any trade
+    RISK_MAX_OPEN_ORDERS,
+    RISK_MESSAGE_RATE,      // The account's token bucket is empty
+    RISK_RULE_COUNT
+} RiskRule;
+
+//Limits of one account; 0 leaves a limit off
+typedef struct {
+    int max_quantity;
+    int64_t max_notional;       // Price in ticks times quantity
+    Price collar;               // Ticks either side of the reference price
+    uint32_t max_open_orders;   // Resting orders and armed stops across the gate's books
+    uint32_t rate;              // New orders per second, sustained
+    uint32_t burst;             // Orders the bucket holds, at least 1
+} RiskLimits;
+
+//Limits and live state of one account, one cache line each. The token bucket
+//is kept as the time it is next full, so a check is a compare and an add.
+typedef struct {
+    int max_quantity;
+    uint32_t max_open_orders;
+    int64_t max_notional;
+    Price collar;
+    uint64_t interval_ns;       // Time to earn one token, 0 for no rate limit
+    uint64_t burst_ns;          // How far ahead of time the bucket may be drawn
+    uint64_t full_ns;           // When the bucket is full again
+    uint32_t open_orders;
+    uint32_t reserved;
+    uint64_t rejected;          // Orders of this account the gate turned away
+} RiskAccount;
+
+//Pre-trade risk gate shared by the books of one matching thread
+struct RiskGate {
+    RiskAccount* accounts;      // Indexed by owner; NO_OWNER is account 0
+    uint32_t account_count;
+    RiskRule last_rule;         // Outcome of the latest check
+    uint64_t counts[RISK_RULE_COUNT];   // Orders per outcome, counts[RISK_ACCEPTED] let through
+};
+
+// Risk gate functions
+RiskGate* create_risk_gate(uint32_t account_count, const RiskLimits* defaults);
+void free_risk_gate(RiskGate* gate);
+int risk_set_limits(RiskGate* gate, uint32_t owner, const RiskLimits* limits);
+int load_risk_limits(RiskGate* gate, const char* filename);
+RiskRule risk_check_order(RiskGate* gate, const OrderBook* book, const Order* order);
+RiskRule risk_check_replace(RiskGate* gate, const OrderBook* book, const Order* order);
+void risk_order_opened(RiskGate* gate, uint32_t owner);
+void risk_order_closed(RiskGate* gate, uint32_t owner);
+void risk_count_open_orders(RiskGate* gate, const OrderBook* book);
+const char* risk_rule_to_string(RiskRule rule);
+void print_risk_counts(const RiskGate* gate);
+
+#endif // RISK_GATE_H
@@ -0,0 +1,369 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/snapshot.h"
+#include "../src/symbol_registry.h"
+#include "../src/stop_book.h"
+#include "../src/market_data.h"
+#include "../src/event_clock.h"
+#include "../src/auction.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Round a file offset up to the next section boundary
+static uint64_t snapshot_align(uint64_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(uint64_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+// Write one section followed by zero padding up to the next boundary
+static int write_section(FILE* file, const void* data, size_t size, uint64_t* offset) {
+    static const char padding[SNAPSHOT_ALIGNMENT];
+    if (size > 0 && fwrite(data, 1, size, file) != size) {
+        return 0;
+    }
+    uint64_t end = *offset + size;
+    *offset = snapshot_align(end);
+    size_t pad = (size_t)(*offset - end);
+    return pad == 0 || fwrite(padding, 1, pad, file) == pad;
+}
+
+// Write every book to a temporary file, sync it, and rename it into place
+int save_snapshot(const SymbolRegistry* registry, const char* filename,
+                  uint64_t journal_sequence, uint64_t exec_sequence) {
+    size_t name_length = strlen(filename);
+    char* tmp_name = malloc(name_length + 5);
+    if (tmp_name == NULL) {
+        perror("Failed to allocate memory for snapshot name");
+        return -1;
+    }
+    memcpy(tmp_name, filename, name_length);
+    memcpy(tmp_name + name_length, ".tmp", 5);
+    
+    FILE* file = fopen(tmp_name, "wb");
+    if (file == NULL) {
+        perror("Failed to open snapshot");
+        free(tmp_name);
+        return -1;
+    }
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.book_count = registry->book_count;
+    header.journal_sequence = journal_sequence;
+    header.exec_sequence = exec_sequence;
+    header.event_sequence = peek_event_sequence();
+    header.file_size = snapshot_align(sizeof(header));
+    header.orders_per_book = registry->orders_per_book;
+    header.ladder_size = registry->ladder_size;
+    header.order_size = sizeof(RestingOrder);
+    header.order_info_size = sizeof(OrderInfo);
+    header.level_size = sizeof(PriceLevel);
+    header.index_entry_size = sizeof(OrderIndexEntry);
+    header.stop_entry_size = sizeof(StopEntry);
+    for (uint32_t i = 0; i < registry->book_count; i++) {
+        const OrderBook* book = registry->books[i];
+        header.file_size += snapshot_align(sizeof(SnapshotBook)) +
+                            snapshot_align((uint64_t)book->pool.capacity * sizeof(RestingOrder)) +
+                            snapshot_align((uint64_t)book->pool.capacity * sizeof(OrderInfo)) +
+                            2 * snapshot_align((uint64_t)book->bids.size * sizeof(PriceLevel)) +
+                            snapshot_align(((uint64_t)book->order_index.mask + 1) * sizeof(OrderIndexEntry)) +
+                            snapshot_align((uint64_t)book->buy_stops.count * sizeof(StopEntry)) +
+                            snapshot_align((uint64_t)book->sell_stops.count * sizeof(StopEntry));
+    }
+    
+    uint64_t offset = 0;
+    int ok = write_section(file, &header, sizeof(header), &offset);
+    
+    // Everything is slot- and tick-indexed, so the arrays are written as they are
+    for (uint32_t i = 0; ok && i < registry->book_count; i++) {
+        const OrderBook* book = registry->books[i];
+        SnapshotBook entry;
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.symbol, book->symbol, MAX_SYMBOL_LENGTH);
+        entry.bid_base = book->bids.base_price;
+        entry.ask_base = book->asks.base_price;
+        entry.ladder_size = book->bids.size;
+        entry.bid_level_count = book->bids.level_count;
+        entry.bid_low = book->bids.low;
+        entry.bid_high = book->bids.high;
+        entry.ask_level_count = book->asks.level_count;
+        entry.ask_low = book->asks.low;
+        entry.ask_high = book->asks.high;
+        entry.pool_capacity = book->pool.capacity;
+        entry.free_head = book->pool.free_head;
+        entry.live_count = book->pool.live_count;
+        entry.index_mask = book->order_index.mask;
+        entry.index_count = book->order_index.count;
+        entry.stop_sequence = book->stop_sequence;
+        entry.last_trade_price = book->last_trade_price;
+        entry.buy_stop_count = book->buy_stops.count;
+        entry.sell_stop_count = book->sell_stops.count;
+        entry.call_phase = book->auction.call_phase;
+        
+        ok = write_section(file, &entry, sizeof(entry), &offset) &&
+             write_section(file, book->pool.orders, book->pool.capacity * sizeof(RestingOrder), &offset) &&
+             write_section(file, book->pool.info, book->pool.capacity * sizeof(OrderInfo), &offset) &&
+             write_section(file, book->bids.levels, (size_t)book->bids.size * sizeof(PriceLevel), &offset) &&
+             write_section(file, book->asks.levels, (size_t)book->asks.size * sizeof(PriceLevel), &offset) &&
+             write_section(file, book->order_index.entries,
+                           ((size_t)book->order_index.mask + 1) * sizeof(OrderIndexEntry), &offset) &&
+             write_section(file, book->buy_stops.entries, book->buy_stops.count * sizeof(StopEntry), &offset) &&
+             write_section(file, book->sell_stops.entries, book->sell_stops.count * sizeof(StopEntry), &offset);
+    }
+    
+    // The rename only happens once the data is on disk
+    ok = ok && offset == header.file_size && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_name, filename) != 0) {
+        perror("Failed to write snapshot");
+        remove(tmp_name);
+        free(tmp_name);
+        return -1;
+    }
+    
+    free(tmp_name);
+    return 0;
+}
+
+// Copy a stop heap section out of the mapping; returns -1 if an entry names no pool slot
+static int copy_stop_heap(StopHeap* heap, const uint8_t* data, uint32_t count, uint32_t pool_capacity) {
+    if (count == 0) {
+        return 0;
+    }
+    heap->entries = malloc(count * sizeof(StopEntry));
+    if (heap->entries == NULL) {
+        perror("Failed to allocate memory for stop orders");
+        return -1;
+    }
+    memcpy(heap->entries, data, count * sizeof(StopEntry));
+    heap->count = count;
+    heap->capacity = count;
+    for (uint32_t i = 0; i < count; i++) {
+        if (heap->entries[i].slot >= pool_capacity) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Whether a mapped ladder's bounds lie inside it and each queue in its
+// occupied range is a chain of pool slots from head to tail as long as its
+// order count. Only the queued orders are read, not the whole pool; free
+// slots are bounds-checked as the pool hands them out.
+static bool snapshot_ladder_valid(const PriceLadder* ladder, const OrderPool* pool) {
+    if (ladder->level_count == 0) {
+        return ladder->low == -1 && ladder->high == -1;
+    }
+    if (ladder->level_count < 0 || ladder->low < 0 || ladder->low > ladder->high || ladder->high >= ladder->size ||
+        ladder->level_count > ladder->high - ladder->low + 1) {
+        return false;
+    }
+    for (int i = ladder->low; i <= ladder->high; i++) {
+        const PriceLevel* level = &ladder->levels[i];
+        if (level->order_count < 0 || (uint32_t)level->order_count > pool->live_count) {
+            return false;
+        }
+        uint32_t prev = NO_ORDER;
+        int count = 0;
+        for (uint32_t slot = level->head; slot != NO_ORDER; slot = pool->orders[slot].next) {
+            if (slot >= pool->capacity || count == level->order_count || pool->orders[slot].prev != prev) {
+                return false;
+            }
+            prev = slot;
+            count++;
+        }
+        if (count != level->order_count || level->tail != prev) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Point a book at its arrays inside the mapping; returns the offset past it,
+// or 0 if it does not fit or its ladders or queue links point outside it
+static uint64_t map_snapshot_book(uint8_t* data, uint64_t size, uint64_t offset, OrderBook* book) {
+    initialize_stop_heap(&book->buy_stops, BUY);
+    initialize_stop_heap(&book->sell_stops, SELL);
+    
+    SnapshotBook entry;
+    if (offset + sizeof(entry) > size) {
+        return 0;
+    }
+    memcpy(&entry, data + offset, sizeof(entry));
+    offset += snapshot_align(sizeof(entry));
+    
+    uint64_t index_capacity = (uint64_t)entry.index_mask + 1;
+    uint64_t pool_bytes = snapshot_align((uint64_t)entry.pool_capacity * sizeof(RestingOrder));
+    uint64_t info_bytes = snapshot_align((uint64_t)entry.pool_capacity * sizeof(OrderInfo));
+    uint64_t ladder_bytes = snapshot_align((uint64_t)entry.ladder_size * sizeof(PriceLevel));
+    uint64_t index_bytes = snapshot_align(index_capacity * sizeof(OrderIndexEntry));
+    uint64_t buy_stop_bytes = snapshot_align((uint64_t)entry.buy_stop_count * sizeof(StopEntry));
+    uint64_t sell_stop_bytes = snapshot_align((uint64_t)entry.sell_stop_count * sizeof(StopEntry));
+    if (entry.ladder_size <= 0 || (index_capacity & entry.index_mask) != 0 ||
+        (entry.free_head >= entry.pool_capacity && entry.free_head != NO_ORDER) ||
+        offset + pool_bytes + info_bytes + 2 * ladder_bytes + index_bytes + buy_stop_bytes + sell_stop_bytes > size) {
+        return 0;
+    }
+    
+    memcpy(book->symbol, entry.symbol, MAX_SYMBOL_LENGTH);
+    book->symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
+    
+    book->pool.orders = (RestingOrder*)(data + offset);
+    book->pool.info = (OrderInfo*)(data + offset + pool_bytes);
+    book->pool.capacity = entry.pool_capacity;
+    book->pool.free_head = entry.free_head;
+    book->pool.live_count = entry.live_count;
+    offset += pool_bytes + info_bytes;
+    
+    book->bids.levels = (PriceLevel*)(data + offset);
+    book->bids.size = entry.ladder_size;
+    book->bids.base_price = entry.bid_base;
+    book->bids.level_count = entry.bid_level_count;
+    book->bids.low = entry.bid_low;
+    book->bids.high = entry.bid_high;
+    book->bids.side = BUY;
+    offset += ladder_bytes;
+    
+    book->asks.levels = (PriceLevel*)(data + offset);
+    book->asks.size = entry.ladder_size;
+    book->asks.base_price = entry.ask_base;
+    book->asks.level_count = entry.ask_level_count;
+    book->asks.low = entry.ask_low;
+    book->asks.high = entry.ask_high;
+    book->asks.side = SELL;
+    offset += ladder_bytes;
+    
+    book->order_index.entries = (OrderIndexEntry*)(data + offset);
+    book->order_index.mask = entry.index_mask;
+    book->order_index.count = entry.index_count;
+    offset += index_bytes;
+    
+    // Nothing may follow a queue link out of the mapping once the book is in use
+    if (book->pool.live_count > book->pool.capacity || !snapshot_ladder_valid(&book->bids, &book->pool) ||
+        !snapshot_ladder_valid(&book->asks, &book->pool)) {
+        return 0;
+    }
+    
+    book->stop_sequence = entry.stop_sequence;
+    book->trade_high = INT64_MIN;
+    book->trade_low = INT64_MAX;
+    book->last_trade_price = entry.last_trade_price;
+    book->event_sequence = 0;
+    book->event_time_ns = 0;
+    book->event_stamped = false;
+    
+    // The indicative uncross is not stored, only whether the call phase is on
+    memset(&book->auction, 0, sizeof(AuctionState));
+    book->auction.call_phase = entry.call_phase != 0;
+    if (book->auction.call_phase) {
+        update_indicative(book);
+    }
+    
+    // Counters start over, with the restored levels and orders as their base
+    memset(&book->counters, 0, sizeof(BookCounters));
+    book->counters.levels_created = (uint64_t)(book->bids.level_count + book->asks.level_count);
+    book->counters.max_levels = (uint32_t)((book->bids.level_count > book->asks.level_count) ?
+                                           book->bids.level_count : book->asks.level_count);
+    book->counters.max_live_orders = book->pool.live_count;
+    if (copy_stop_heap(&book->buy_stops, data + offset, entry.buy_stop_count, entry.pool_capacity) != 0 ||
+        copy_stop_heap(&book->sell_stops, data + offset + buy_stop_bytes, entry.sell_stop_count,
+                       entry.pool_capacity) != 0) {
+        return 0;
+    }
+    offset += buy_stop_bytes + sell_stop_bytes;
+    
+    book->exec_ring = NULL;
+    book->journal = NULL;
+    book->market_data = NULL;
+    market_data_reset_view(book);
+    book->quote_view = NULL;
+    book->risk_gate = NULL;
+    book->stats = NULL;
+    book->mapped = true;
+    return offset;
+}
+
+// Map a snapshot privately and adopt its books into an empty registry. The
+// books use the mapped arrays in place (pages are copied on first write).
+// Validation reads only the headers, the occupied ladder ranges and the
+// queued orders, so startup cost grows with the resting orders, not with
+// the pool capacity. On failure the registry may hold
+// some of the books and should be discarded.
+int load_snapshot(SymbolRegistry* registry, const char* filename,
+                  uint64_t* journal_sequence, uint64_t* exec_sequence) {
+    if (registry->book_count != 0 || registry->snapshot_data != NULL) {
+        fprintf(stderr, "Snapshots load into an empty registry\n");
+        return -1;
+    }
+    
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open snapshot");
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Not a snapshot: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    uint8_t* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Failed to map snapshot");
+        return -1;
+    }
+    
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.file_size != size ||
+        header.order_size != sizeof(RestingOrder) || header.order_info_size != sizeof(OrderInfo) ||
+        header.level_size != sizeof(PriceLevel) ||
+        header.index_entry_size != sizeof(OrderIndexEntry) || header.stop_entry_size != sizeof(StopEntry) ||
+        header.book_count > registry->max_books) {
+        fprintf(stderr, "Incompatible snapshot: %s\n", filename);
+        munmap(data, size);
+        return -1;
+    }
+    
+    // The registry owns the mapping from here on
+    registry->snapshot_data = data;
+    registry->snapshot_size = size;
+    registry->orders_per_book = header.orders_per_book;
+    registry->ladder_size = header.ladder_size;
+    
+    uint64_t offset = snapshot_align(sizeof(header));
+    for (uint32_t i = 0; i < header.book_count; i++) {
+        OrderBook* book = malloc(sizeof(OrderBook));
+        if (book == NULL) {
+            perror("Failed to allocate memory for order book");
+            return -1;
+        }
+        
+        offset = map_snapshot_book(data, size, offset, book);
+        if (offset == 0 || registry_add_book(registry, book) < 0) {
+            fprintf(stderr, "Corrupt snapshot: %s\n", filename);
+            free_stop_heap(&book->buy_stops);
+            free_stop_heap(&book->sell_stops);
+            free(book);
+            return -1;
+        }
+    }
+    
+    *journal_sequence = header.journal_sequence;
+    *exec_sequence = header.exec_sequence;
+    advance_event_sequence(header.event_sequence);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "../include/utils.h"
+
+#define SNAPSHOT_MAGIC 0x50414E53424F4C43ULL    // "CLOBSNAP"
+#define SNAPSHOT_VERSION 9
+#define SNAPSHOT_ALIGNMENT 64                  // Every section starts on a cache line
+
+//File header. The layout sizes guard against loading a snapshot written by a
+//build with different record layouts.
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t book_count;
+    uint64_t journal_sequence;   // First journal record not covered by the snapshot
+    uint64_t exec_sequence;      // Next execution report sequence
+    uint64_t event_sequence;     // Next global event sequence
+    uint64_t file_size;
+    uint32_t orders_per_book;
+    int32_t ladder_size;
+    uint32_t order_size;
+    uint32_t level_size;
+    uint32_t index_entry_size;
+    uint32_t stop_entry_size;
+    uint32_t order_info_size;
+} SnapshotHeader;
+
+//Per-book header; the raw pool (resting records, then their cold fields), bid
+//levels, ask levels and index entries follow, each aligned to SNAPSHOT_ALIGNMENT
+//so a mapping of the file can be used in place, then the buy and sell stop
+//heaps, which are copied out on load so they can grow
+typedef struct {
+    char symbol[MAX_SYMBOL_LENGTH];
+    Price bid_base;
+    Price ask_base;
+    int32_t ladder_size;
+    int32_t bid_level_count;
+    int32_t bid_low;
+    int32_t bid_high;
+    int32_t ask_level_count;
+    int32_t ask_low;
+    int32_t ask_high;
+    uint32_t pool_capacity;
+    uint32_t free_head;
+    uint32_t live_count;
+    uint32_t index_mask;
+    uint32_t index_count;
+    uint64_t stop_sequence;
+    Price last_trade_price;
+    uint32_t buy_stop_count;
+    uint32_t sell_stop_count;
+    uint32_t call_phase;         // The book is collecting orders for an auction
+} SnapshotBook;
+
+// Snapshot functions
+int save_snapshot(const SymbolRegistry* registry, const char* filename,
+                  uint64_t journal_sequence, uint64_t exec_sequence);
+int load_snapshot(SymbolRegistry* registry, const char* filename,
+                  uint64_t* journal_sequence, uint64_t* exec_sequence);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/utils.h"
+#include "../src/stats.h"
+#include "../src/symbol_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Create stats for one matching thread; dumps of the registry's books go to
+// sink every interval_ns of event time when a sink is given
+EngineStats* create_engine_stats(SymbolRegistry* registry, FILE* sink, uint64_t interval_ns) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(EngineStats)) != 0) {
+        perror("Failed to allocate memory for engine stats");
+        return NULL;
+    }
+    
+    EngineStats* stats = memory;
+    memset(stats, 0, sizeof(EngineStats));
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        histogram_reset(&stats->stages[stage]);
+    }
+    stats->registry = registry;
+    stats->sink = sink;
+    stats->interval_ns = (interval_ns > 0) ? interval_ns : STATS_DUMP_INTERVAL_NS;
+    return stats;
+}
+
+// Free stats; detach them from their books first
+void free_engine_stats(EngineStats* stats) {
+    free(stats);
+}
+
+// Nanoseconds per stats cycle, 0 when the TSC rate was never calibrated
+double stats_ns_per_cycle(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return event_clock_ns_per_tick();
+#else
+    return 1.0;
+#endif
+}
+
+// Stage name for display and dumps
+const char* stats_stage_to_string(StatsStage stage) {
+    switch (stage) {
+        case STAGE_DECODE: return "decode";
+        case STAGE_RISK: return "risk";
+        case STAGE_MATCH: return "match";
+        case STAGE_PUBLISH: return "publish";
+        default: return "unknown";
+    }
+}
+
+// Levels that emptied out again: everything created that is not still occupied
+static uint64_t levels_destroyed(const OrderBook* book) {
+    return book->counters.levels_created - (uint64_t)(book->bids.level_count + book->asks.level_count);
+}
+
+// Print a book's activity counters
+void print_book_counters(const OrderBook* book) {
+    const BookCounters* counters = &book->counters;
+    printf("\n=== STATS: %s ===\n", book->symbol);
+    printf("%-18s %llu\n", "adds", (unsigned long long)counters->adds);
+    printf("%-18s %llu\n", "cancels", (unsigned long long)counters->cancels);
+    printf("%-18s %llu\n", "modifies", (unsigned long long)counters->modifies);
+    printf("%-18s %llu (%llu shares)\n", "trades", (unsigned long long)counters->trades,
+           (unsigned long long)counters->traded_quantity);
+    printf("%-18s %llu\n", "rejects", (unsigned long long)counters->rejects);
+    printf("%-18s %llu\n", "levels created", (unsigned long long)counters->levels_created);
+    printf("%-18s %llu\n", "levels destroyed", (unsigned long long)levels_destroyed(book));
+    printf("%-18s %u\n", "max queue depth", counters->max_queue_depth);
+    printf("%-18s %u\n", "max levels", counters->max_levels);
+    printf("%-18s %u\n", "max live orders", counters->max_live_orders);
+    printf("==================\n");
+}
+
+// Print the stage timings in cycles, with the nanosecond rate when known
+void print_engine_stats(const EngineStats* stats) {
+    printf("\n=== STAGE CYCLES ===\n");
+    printf("%-8s %10s %8s %8s %8s %8s %10s\n", "stage", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Histogram* histogram = &stats->stages[stage];
+        printf("%-8s %10llu %8.0f %8llu %8llu %8llu %10llu\n", stats_stage_to_string((StatsStage)stage),
+               (unsigned long long)histogram->count, histogram_mean(histogram),
+               (unsigned long long)histogram_percentile(histogram, 50.0),
+               (unsigned long long)histogram_percentile(histogram, 99.0),
+               (unsigned long long)histogram_percentile(histogram, 99.9),
+               (unsigned long long)histogram->max);
+    }
+    double ns_per_cycle = stats_ns_per_cycle();
+    if (ns_per_cycle > 0) {
+        printf("%.3f ns per cycle\n", ns_per_cycle);
+    }
+    printf("====================\n");
+}
+
+// Write one JSON line with the stage timings and every book's counters, all
+// totals since start, and schedule the next dump
+void write_stats_dump(EngineStats* stats, uint64_t now_ns) {
+    FILE* sink = stats->sink;
+    fprintf(sink, "{\"time_ns\":%llu,\"dump\":%llu,\"ns_per_cycle\":%.4f,\"stages\":{",
+            (unsigned long long)now_ns, (unsigned long long)stats->dumps, stats_ns_per_cycle());
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Histogram* histogram = &stats->stages[stage];
+        fprintf(sink, "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                (stage == 0) ? "" : ",", stats_stage_to_string((StatsStage)stage),
+                (unsigned long long)histogram->count, histogram_mean(histogram),
+                (unsigned long long)histogram_percentile(histogram, 50.0),
+                (unsigned long long)histogram_percentile(histogram, 99.0),
+                (unsigned long long)histogram_percentile(histogram, 99.9),
+                (unsigned long long)histogram->max);
+    }
+    fprintf(sink, "},\"books\":[");
+    uint32_t book_count = (stats->registry != NULL) ? stats->registry->book_count : 0;
+    for (uint32_t i = 0; i < book_count; i++) {
+        const OrderBook* book = stats->registry->books[i];
+        const BookCounters* counters = &book->counters;
+        fprintf(sink, "%s{\"symbol\":\"%s\",\"adds\":%llu,\"cancels\":%llu,\"modifies\":%llu,"
+                "\"trades\":%llu,\"traded_quantity\":%llu,\"rejects\":%llu,\"levels_created\":%llu,"
+                "\"levels_destroyed\":%llu,\"max_queue_depth\":%u,\"max_levels\":%u,\"max_live_orders\":%u}",
+                (i == 0) ? "" : ",", book->symbol, (unsigned long long)counters->adds,
+                (unsigned long long)counters->cancels, (unsigned long long)counters->modifies,
+                (unsigned long long)counters->trades, (unsigned long long)counters->traded_quantity,
+                (unsigned long long)counters->rejects, (unsigned long long)counters->levels_created,
+                (unsigned long long)levels_destroyed(book), counters->max_queue_depth,
+                counters->max_levels, counters->max_live_orders);
+    }
+    fprintf(sink, "]}\n");
+    fflush(sink);
+    
+    stats->dumps++;
+    stats->next_dump_ns = now_ns + stats->interval_ns;
+}
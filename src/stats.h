@@ -0,0 +1,71 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "../include/utils.h"
+#include "../src/exec_report.h"
+#include "../src/histogram.h"
+#include "../src/event_clock.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define STATS_DUMP_INTERVAL_NS 1000000000ULL   // Default time between periodic dumps
+
+//Stages of a command timed into the stage histograms
+typedef enum {
+    STAGE_DECODE,       // Binary order-entry frame to message
+    STAGE_RISK,         // Pre-trade risk check
+    STAGE_MATCH,        // Journaling, matching and book updates
+    STAGE_PUBLISH,      // Market data and quote view
+    STAGE_COUNT
+} StatsStage;
+
+//Stage timings of one matching thread, in cycles, and its periodic dump.
+//Only the owning thread writes it, so nothing is atomic. It is allocated on
+//a cache line boundary with the header padded to a full line, so no two
+//threads' stats share a line.
+struct EngineStats {
+    SymbolRegistry* registry;   // Books whose counters are dumped, not owned
+    FILE* sink;                 // One JSON line per dump when set, not owned
+    uint64_t interval_ns;
+    uint64_t next_dump_ns;      // Event time the next dump is due
+    uint64_t dumps;
+    char pad[CACHE_LINE_SIZE - 2 * sizeof(void*) - 3 * sizeof(uint64_t)];
+    Histogram stages[STAGE_COUNT];
+};
+
+// Cycle counter for stage timing: the TSC where there is one, else the event clock
+static inline uint64_t stats_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return event_clock_ns();
+#endif
+}
+
+// Start timing a stage; 0 when no stats are attached
+static inline uint64_t stats_stage_begin(const EngineStats* stats) {
+    return (stats != NULL) ? stats_cycles() : 0;
+}
+
+// Record the cycles since start against a stage; returns the end time, which
+// starts the next stage
+static inline uint64_t stats_stage_end(EngineStats* stats, StatsStage stage, uint64_t start) {
+    if (stats == NULL) {
+        return 0;
+    }
+    uint64_t now = stats_cycles();
+    histogram_record(&stats->stages[stage], now - start);
+    return now;
+}
+
+// Stats functions
+EngineStats* create_engine_stats(SymbolRegistry* registry, FILE* sink, uint64_t interval_ns);
+void free_engine_stats(EngineStats* stats);
+double stats_ns_per_cycle(void);
+const char* stats_stage_to_string(StatsStage stage);
+void print_book_counters(const OrderBook* book);
+void print_engine_stats(const EngineStats* stats);
+void write_stats_dump(EngineStats* stats, uint64_t now_ns);
+
+#endif // STATS_H
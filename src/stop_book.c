@@ -0,0 +1,119 @@
+#include "../include/utils.h"
+#include "../src/stop_book.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STOP_HEAP_INITIAL_CAPACITY 64
+
+// Initialize an empty stop heap; storage is allocated on the first push
+void initialize_stop_heap(StopHeap* heap, OrderSide side) {
+    heap->entries = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->side = side;
+}
+
+// Free the heap storage
+void free_stop_heap(StopHeap* heap) {
+    free(heap->entries);
+    heap->entries = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+}
+
+// Check whether an order type waits in the stop book until triggered
+bool is_stop_type(OrderType type) {
+    return type == STOP || type == STOP_LIMIT;
+}
+
+// Check whether entry a triggers before entry b: buy stops fire lowest
+// stop price first, sell stops highest first, and ties go by arrival
+static bool stop_entry_before(const StopHeap* heap, const StopEntry* a, const StopEntry* b) {
+    if (a->stop_price != b->stop_price) {
+        return (heap->side == BUY) ? a->stop_price < b->stop_price : a->stop_price > b->stop_price;
+    }
+    return a->sequence < b->sequence;
+}
+
+// Store an entry at a heap position and record the position in its order
+static void stop_heap_place(StopHeap* heap, RestingOrder* orders, uint32_t position, const StopEntry* entry) {
+    heap->entries[position] = *entry;
+    orders[entry->slot].prev = position;
+}
+
+// Move the entry at position up or down until the heap order holds again
+static void stop_heap_restore(StopHeap* heap, RestingOrder* orders, uint32_t position) {
+    StopEntry entry = heap->entries[position];
+    
+    while (position > 0) {
+        uint32_t parent = (position - 1) / 2;
+        if (!stop_entry_before(heap, &entry, &heap->entries[parent])) {
+            break;
+        }
+        stop_heap_place(heap, orders, position, &heap->entries[parent]);
+        position = parent;
+    }
+    
+    while (1) {
+        uint32_t child = 2 * position + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && stop_entry_before(heap, &heap->entries[child + 1], &heap->entries[child])) {
+            child++;
+        }
+        if (!stop_entry_before(heap, &heap->entries[child], &entry)) {
+            break;
+        }
+        stop_heap_place(heap, orders, position, &heap->entries[child]);
+        position = child;
+    }
+    stop_heap_place(heap, orders, position, &entry);
+}
+
+// Arm the stop order in slot at stop_price; returns -1 if the heap cannot grow
+int stop_heap_push(StopHeap* heap, RestingOrder* orders, uint32_t slot, Price stop_price, uint64_t sequence,
+                   uint32_t max_count) {
+    if (heap->count == heap->capacity) {
+        uint32_t capacity = (heap->capacity == 0) ? STOP_HEAP_INITIAL_CAPACITY : heap->capacity * 2;
+        if (capacity > max_count) {
+            capacity = max_count;
+        }
+        if (capacity <= heap->count) {
+            return -1;
+        }
+        StopEntry* entries = realloc(heap->entries, capacity * sizeof(StopEntry));
+        if (entries == NULL) {
+            perror("Failed to allocate memory for stop orders");
+            return -1;
+        }
+        heap->entries = entries;
+        heap->capacity = capacity;
+    }
+    
+    StopEntry entry = {stop_price, sequence, slot};
+    stop_heap_place(heap, orders, heap->count++, &entry);
+    stop_heap_restore(heap, orders, heap->count - 1);
+    return 0;
+}
+
+// Disarm the stop at a heap position (the order's prev field)
+void stop_heap_remove(StopHeap* heap, RestingOrder* orders, uint32_t position) {
+    orders[heap->entries[position].slot].prev = NO_ORDER;
+    heap->count--;
+    if (position < heap->count) {
+        stop_heap_place(heap, orders, position, &heap->entries[heap->count]);
+        stop_heap_restore(heap, orders, position);
+    }
+}
+
+// Check whether trades spanning [trade_low, trade_high] reached the top stop:
+// buy stops trigger at or above their stop price, sell stops at or below
+bool stop_heap_triggered(const StopHeap* heap, Price trade_low, Price trade_high) {
+    if (heap->count == 0) {
+        return false;
+    }
+    Price stop_price = heap->entries[0].stop_price;
+    return (heap->side == BUY) ? trade_high >= stop_price : trade_low <= stop_price;
+}
@@ -0,0 +1,15 @@
+#ifndef STOP_BOOK_H
+#define STOP_BOOK_H
+
+#include "../include/utils.h"
+
+// Stop heap functions
+void initialize_stop_heap(StopHeap* heap, OrderSide side);
+void free_stop_heap(StopHeap* heap);
+int stop_heap_push(StopHeap* heap, RestingOrder* orders, uint32_t slot, Price stop_price, uint64_t sequence,
+                   uint32_t max_count);
+void stop_heap_remove(StopHeap* heap, RestingOrder* orders, uint32_t position);
+bool stop_heap_triggered(const StopHeap* heap, Price trade_low, Price trade_high);
+bool is_stop_type(OrderType type);
+
+#endif // STOP_BOOK_H
@@ -0,0 +1,235 @@
+#include "../include/utils.h"
+#include "../src/symbol_registry.h"
+#include "../src/journal.h"
+#include "../src/market_data.h"
+#include "../src/risk_gate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Create an empty registry; books are created on first use
+SymbolRegistry* create_symbol_registry(uint32_t max_books, uint32_t orders_per_book, int ladder_size) {
+    SymbolRegistry* registry = calloc(1, sizeof(SymbolRegistry));
+    if (registry == NULL) {
+        perror("Failed to allocate memory for symbol registry");
+        return NULL;
+    }
+    
+    uint32_t capacity = 16;
+    while (capacity < max_books * 2) {
+        capacity <<= 1;
+    }
+    
+    registry->entries = calloc(capacity, sizeof(SymbolEntry));
+    registry->books = calloc(max_books, sizeof(OrderBook*));
+    if (registry->entries == NULL || registry->books == NULL) {
+        perror("Failed to allocate memory for symbol table");
+        free(registry->entries);
+        free(registry->books);
+        free(registry);
+        return NULL;
+    }
+    
+    registry->mask = capacity - 1;
+    registry->max_books = max_books;
+    registry->orders_per_book = orders_per_book;
+    registry->ladder_size = ladder_size;
+    return registry;
+}
+
+// Free every book and the registry itself
+void free_symbol_registry(SymbolRegistry* registry) {
+    if (registry != NULL) {
+        for (uint32_t i = 0; i < registry->book_count; i++) {
+            free_order_book(registry->books[i]);
+        }
+        free(registry->books);
+        free(registry->entries);
+        
+        // Snapshot-loaded books point into this mapping, so it goes last
+        if (registry->snapshot_data != NULL) {
+            munmap(registry->snapshot_data, registry->snapshot_size);
+        }
+        free(registry);
+    }
+}
+
+// Attach an exec ring, journal and market data feed to the registry and every
+// book it already hosts; a feed starts with a snapshot of each of those books
+void registry_attach_outputs(SymbolRegistry* registry, ExecRing* exec_ring, Journal* journal,
+                             MarketDataFeed* market_data) {
+    registry->exec_ring = exec_ring;
+    registry->journal = journal;
+    registry->market_data = market_data;
+    for (uint32_t i = 0; i < registry->book_count; i++) {
+        registry->books[i]->exec_ring = exec_ring;
+        registry->books[i]->journal = journal;
+        registry->books[i]->market_data = market_data;
+        if (market_data != NULL) {
+            market_data_snapshot(market_data, registry->books[i]);
+        }
+    }
+}
+
+// Attach a risk gate to the registry and every book it already hosts,
+// counting the orders those books hold against their accounts
+void registry_attach_risk_gate(SymbolRegistry* registry, RiskGate* gate) {
+    registry->risk_gate = gate;
+    for (uint32_t i = 0; i < registry->book_count; i++) {
+        registry->books[i]->risk_gate = gate;
+        if (gate != NULL) {
+            risk_count_open_orders(gate, registry->books[i]);
+        }
+    }
+}
+
+// Attach the matching thread's stats to the registry and every book it
+// already hosts
+void registry_attach_stats(SymbolRegistry* registry, EngineStats* stats) {
+    registry->stats = stats;
+    for (uint32_t i = 0; i < registry->book_count; i++) {
+        registry->books[i]->stats = stats;
+    }
+}
+
+// Pack a symbol into a zero-padded 64-bit word
+uint64_t symbol_key(const char* symbol) {
+    char buffer[MAX_SYMBOL_LENGTH] = {0};
+    const char* end = memchr(symbol, '\0', MAX_SYMBOL_LENGTH - 1);
+    size_t length = (end != NULL) ? (size_t)(end - symbol) : MAX_SYMBOL_LENGTH - 1;
+    memcpy(buffer, symbol, length);
+    
+    uint64_t key;
+    memcpy(&key, buffer, sizeof(key));
+    return key;
+}
+
+// Find the table position holding a key, or the empty position where it would go
+static uint32_t probe_symbol_key(const SymbolRegistry* registry, uint64_t key) {
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    uint32_t pos = (uint32_t)(h >> 32) & registry->mask;
+    while (registry->entries[pos].key != 0 && registry->entries[pos].key != key) {
+        pos = (pos + 1) & registry->mask;
+    }
+    return pos;
+}
+
+// Look up the interned index of a symbol, or -1 if it has no book
+int registry_symbol_index(const SymbolRegistry* registry, const char* symbol) {
+    uint64_t key = symbol_key(symbol);
+    if (key == 0) {
+        return -1;
+    }
+    
+    const SymbolEntry* entry = &registry->entries[probe_symbol_key(registry, key)];
+    return (entry->key != 0) ? (int)entry->book_index : -1;
+}
+
+// Return the index of a symbol's book, creating the book on first use
+int registry_intern_symbol(SymbolRegistry* registry, const char* symbol) {
+    int index = registry_symbol_index(registry, symbol);
+    if (index >= 0 || symbol_key(symbol) == 0) {
+        return index;
+    }
+    
+    if (registry->book_count >= registry->max_books) {
+        fprintf(stderr, "Symbol registry is full\n");
+        return -1;
+    }
+    
+    OrderBook* book = create_order_book_with_capacity(symbol, registry->orders_per_book,
+                                                      registry->ladder_size);
+    if (book == NULL) {
+        return -1;
+    }
+    
+    index = registry_add_book(registry, book);
+    if (index < 0) {
+        free_order_book(book);
+    }
+    return index;
+}
+
+// Take ownership of a built book under its symbol; returns its index, or -1
+// if the symbol already has a book or the registry is full
+int registry_add_book(SymbolRegistry* registry, OrderBook* book) {
+    uint64_t key = symbol_key(book->symbol);
+    if (key == 0 || registry->book_count >= registry->max_books) {
+        return -1;
+    }
+    
+    SymbolEntry* entry = &registry->entries[probe_symbol_key(registry, key)];
+    if (entry->key != 0) {
+        return -1;
+    }
+    book->exec_ring = registry->exec_ring;
+    book->journal = registry->journal;
+    book->market_data = registry->market_data;
+    book->risk_gate = registry->risk_gate;
+    book->stats = registry->stats;
+    
+    entry->key = key;
+    entry->book_index = registry->book_count;
+    registry->books[registry->book_count++] = book;
+    return (int)entry->book_index;
+}
+
+// Find the book for a symbol without creating it
+OrderBook* registry_find_book(const SymbolRegistry* registry, const char* symbol) {
+    int index = registry_symbol_index(registry, symbol);
+    return (index >= 0) ? registry->books[index] : NULL;
+}
+
+// Find the book for a symbol, creating it on first use
+OrderBook* registry_get_book(SymbolRegistry* registry, const char* symbol) {
+    int index = registry_intern_symbol(registry, symbol);
+    return (index >= 0) ? registry->books[index] : NULL;
+}
+
+// Route an order to the book named by its symbol
+RestingOrder* registry_add_order(SymbolRegistry* registry, Order* order) {
+    OrderBook* book = registry_get_book(registry, order->symbol);
+    if (book == NULL) {
+        fprintf(stderr, "No book for symbol: %s\n", order->symbol);
+        return NULL;
+    }
+    return add_order(book, order);
+}
+
+// Add a batch of orders in sequence, reusing the book lookup across runs of one symbol
+void registry_add_orders(SymbolRegistry* registry, Order* orders, int count) {
+    OrderBook* book = NULL;
+    uint64_t book_key = 0;
+    
+    for (int i = 0; i < count; i++) {
+        uint64_t key = symbol_key(orders[i].symbol);
+        if (book == NULL || key != book_key) {
+            book = registry_get_book(registry, orders[i].symbol);
+            book_key = key;
+            if (book == NULL) {
+                fprintf(stderr, "No book for symbol: %s\n", orders[i].symbol);
+                continue;
+            }
+        }
+        add_order(book, &orders[i]);
+    }
+    
+    // One group commit per batch
+    if (registry->journal != NULL) {
+        journal_commit(registry->journal);
+    }
+}
+
+// Route a cancel to the book for a symbol; returns -1 if the order is not live
+int registry_cancel_order(SymbolRegistry* registry, const char* symbol, const char* order_id) {
+    OrderBook* book = registry_find_book(registry, symbol);
+    return (book != NULL) ? cancel_order(book, order_id) : -1;
+}
+
+// Route a modify to the book for a symbol; returns -1 if the order is not live
+int registry_modify_order(SymbolRegistry* registry, const char* symbol, const char* order_id,
+                          int new_quantity, Price new_price) {
+    OrderBook* book = registry_find_book(registry, symbol);
+    return (book != NULL) ? modify_order(book, order_id, new_quantity, new_price) : -1;
+}
@@ -0,0 +1,54 @@
+#ifndef SYMBOL_REGISTRY_H
+#define SYMBOL_REGISTRY_H
+
+#include "../include/utils.h"
+
+#define MAX_SYMBOLS 4096             // Default number of books a registry can host
+#define ORDERS_PER_BOOK 1024         // Default pool capacity of books created on demand
+#define LADDER_SIZE_PER_BOOK 1024    // Default ladder window of books created on demand
+
+//Symbol table entry: symbol packed into one 64-bit word mapped to its book index
+typedef struct {
+    uint64_t key;            // 0 marks an empty entry
+    uint32_t book_index;
+} SymbolEntry;
+
+//Registry of order books keyed by interned symbol
+struct SymbolRegistry {
+    SymbolEntry* entries;
+    uint32_t mask;
+    OrderBook** books;       // Indexed by interned symbol index
+    uint32_t book_count;
+    uint32_t max_books;
+    uint32_t orders_per_book;
+    int ladder_size;
+    ExecRing* exec_ring;     // Attached to every book the registry creates
+    Journal* journal;        // Likewise, when commands are journaled
+    MarketDataFeed* market_data;  // Likewise, when market data is published
+    RiskGate* risk_gate;     // Likewise, when new orders are risk checked
+    EngineStats* stats;      // Likewise, when command stages are timed; frames are decoded under it too
+    uint32_t entry_owner;    // Owner of binary order-entry orders, set by ACCOUNT frames
+    void* snapshot_data;     // Private mapping backing snapshot-loaded books
+    size_t snapshot_size;
+};
+
+// Symbol registry functions
+SymbolRegistry* create_symbol_registry(uint32_t max_books, uint32_t orders_per_book, int ladder_size);
+void free_symbol_registry(SymbolRegistry* registry);
+void registry_attach_outputs(SymbolRegistry* registry, ExecRing* exec_ring, Journal* journal,
+                             MarketDataFeed* market_data);
+void registry_attach_risk_gate(SymbolRegistry* registry, RiskGate* gate);
+void registry_attach_stats(SymbolRegistry* registry, EngineStats* stats);
+uint64_t symbol_key(const char* symbol);
+int registry_symbol_index(const SymbolRegistry* registry, const char* symbol);
+int registry_intern_symbol(SymbolRegistry* registry, const char* symbol);
+int registry_add_book(SymbolRegistry* registry, OrderBook* book);
+OrderBook* registry_find_book(const SymbolRegistry* registry, const char* symbol);
+OrderBook* registry_get_book(SymbolRegistry* registry, const char* symbol);
+RestingOrder* registry_add_order(SymbolRegistry* registry, Order* order);
+void registry_add_orders(SymbolRegistry* registry, Order* orders, int count);
+int registry_cancel_order(SymbolRegistry* registry, const char* symbol, const char* order_id);
+int registry_modify_order(SymbolRegistry* registry, const char* symbol, const char* order_id,
+                          int new_quantity, Price new_price);
+
+#endif // SYMBOL_REGISTRY_H
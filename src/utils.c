@@ -1,13 +1,33 @@
 #include "../include/utils.h"
 #include "../src/orderbook.h"
+#include "../src/order_index.h"
+#include "../src/order_pool.h"
+#include "../src/exec_report.h"
+#include "../src/symbol_registry.h"
+#include "../src/csv_loader.h"
+#include "../src/journal.h"
+#include "../src/snapshot.h"
+#include "../src/stop_book.h"
+#include "../src/market_data.h"
+#include "../src/quote_view.h"
+#include "../src/event_clock.h"
+#include "../src/risk_gate.h"
+#include "../src/auction.h"
+#include "../src/stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 #include <ctype.h>
 
-// Create a new order book
+// Create a new order book with the default capacity
 OrderBook* create_order_book(const char* symbol) {
+    return create_order_book_with_capacity(symbol, MAX_ORDERS, PRICE_LADDER_SIZE);
+}
+
+// Create a new order book holding up to max_orders resting orders
+OrderBook* create_order_book_with_capacity(const char* symbol, uint32_t max_orders, int ladder_size) {
     OrderBook* book = malloc(sizeof(OrderBook));
     if (book == NULL) {
         perror("Failed to allocate memory for order book");
@@ -17,34 +37,52 @@ OrderBook* create_order_book(const char* symbol) {
     strncpy(book->symbol, symbol, MAX_SYMBOL_LENGTH - 1);
     book->symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
     
-    // Allocate memory for price levels
-    book->buy_levels = malloc(MAX_PRICE_LEVELS * sizeof(PriceLevel));
-    book->sell_levels = malloc(MAX_PRICE_LEVELS * sizeof(PriceLevel));
-    
-    if (book->buy_levels == NULL || book->sell_levels == NULL) {
-        perror("Failed to allocate memory for price levels");
-        free(book->buy_levels);
-        free(book->sell_levels);
+    // Allocate the price ladders
+    book->bids.levels = NULL;
+    book->asks.levels = NULL;
+    book->exec_ring = NULL;
+    book->journal = NULL;
+    book->market_data = NULL;
+    market_data_reset_view(book);
+    book->quote_view = NULL;
+    book->risk_gate = NULL;
+    book->stats = NULL;
+    book->mapped = false;
+    initialize_stop_heap(&book->buy_stops, BUY);
+    initialize_stop_heap(&book->sell_stops, SELL);
+    book->stop_sequence = 0;
+    book->trade_high = INT64_MIN;
+    book->trade_low = INT64_MAX;
+    book->last_trade_price = 0;
+    book->event_sequence = 0;
+    book->event_time_ns = 0;
+    book->event_stamped = false;
+    memset(&book->auction, 0, sizeof(AuctionState));
+    memset(&book->counters, 0, sizeof(BookCounters));
+    if (initialize_price_ladder(&book->bids, BUY, ladder_size) != 0 ||
+        initialize_price_ladder(&book->asks, SELL, ladder_size) != 0) {
+        free_price_ladder(&book->bids);
+        free_price_ladder(&book->asks);
         free(book);
         return NULL;
     }
     
-    // Initialize price levels
-    initialize_price_levels(book->buy_levels, MAX_PRICE_LEVELS);
-    initialize_price_levels(book->sell_levels, MAX_PRICE_LEVELS);
-    book->buy_level_count = 0;
-    book->sell_level_count = 0;
+    // Preallocate the order pool
+    if (initialize_order_pool(&book->pool, max_orders) != 0) {
+        free_price_ladder(&book->bids);
+        free_price_ladder(&book->asks);
+        free(book);
+        return NULL;
+    }
     
-    // Allocate memory for all orders
-    book->all_orders = malloc(MAX_ORDERS * sizeof(Order));
-    if (book->all_orders == NULL) {
-        perror("Failed to allocate memory for orders");
-        free(book->buy_levels);
-        free(book->sell_levels);
+    // Index live orders by ID
+    if (initialize_order_index(&book->order_index, max_orders) != 0) {
+        free_price_ladder(&book->bids);
+        free_price_ladder(&book->asks);
+        free_order_pool(&book->pool);
         free(book);
         return NULL;
     }
-    book->order_count = 0;
     
     return book;
 }
@@ -52,238 +90,591 @@ OrderBook* create_order_book(const char* symbol) {
 // Free order book memory
 void free_order_book(OrderBook* book) {
     if (book != NULL) {
-        // Free buy levels
-        for (int i = 0; i < book->buy_level_count; i++) {
-            free(book->buy_levels[i].orders);
-        }
-        free(book->buy_levels);
-        
-        // Free sell levels
-        for (int i = 0; i < book->sell_level_count; i++) {
-            free(book->sell_levels[i].orders);
+        // Snapshot-loaded arrays belong to the registry's mapping
+        if (!book->mapped) {
+            // Free price ladders
+            free_price_ladder(&book->bids);
+            free_price_ladder(&book->asks);
+            
+            // Free the order pool and the ID index
+            free_order_pool(&book->pool);
+            free_order_index(&book->order_index);
         }
-        free(book->sell_levels);
         
-        // Free all orders
-        free(book->all_orders);
+        // Stop heaps are always heap-allocated
+        free_stop_heap(&book->buy_stops);
+        free_stop_heap(&book->sell_stops);
         
         // Free the book itself
         free(book);
     }
 }
 
-// Add an order to the order book
-Order* add_order(OrderBook* book, Order* order) {
-    if (book->order_count >= MAX_ORDERS) {
-        fprintf(stderr, "Order book is full\n");
+// Match an order and rest the remainder, or arm it if it is a stop, then fire
+// any stops its trades reached; the caller's order receives the fill results
+static RestingOrder* insert_order(OrderBook* book, Order* order) {
+    if (order_index_find(&book->order_index, order->id) != NO_ORDER) {
+        fprintf(stderr, "Duplicate order ID: %s\n", order->id);
+        book->counters.rejects++;
         return NULL;
     }
     
-    // Set timestamp
-    order->timestamp = time(NULL);
+    // Time priority comes from the event sequence
+    order->sequence = book->event_sequence;
+    order->timestamp_ns = book->event_time_ns;
     order->status = OPEN;
     order->filled_quantity = 0;
     
-    // Add to all orders
-    memcpy(&book->all_orders[book->order_count], order, sizeof(Order));
-    book->order_count++;
+    // Nothing could ever trade against an empty order, so it never rests
+    if (order->quantity <= 0) {
+        fprintf(stderr, "Order quantity must be positive: %s\n", order->id);
+        order->status = CANCELLED;
+        book->counters.rejects++;
+        return NULL;
+    }
     
-    // Get a pointer to the order in the book
-    Order* book_order = &book->all_orders[book->order_count - 1];
+    if (order->type == ICEBERG && order->display_quantity <= 0) {
+        fprintf(stderr, "Iceberg order needs a positive peak: %s\n", order->id);
+        order->status = CANCELLED;
+        book->counters.rejects++;
+        return NULL;
+    }
     
-    // Determine which side to add to
-    PriceLevel* levels;
-    int* level_count;
+    // A fill-or-kill order that cannot fill is rejected before anything
+    // changes; it is reported cancelled but counted as a reject
+    if (order->type == FOK && !can_fill_completely(book, order)) {
+        order->status = CANCELLED;
+        book->counters.rejects++;
+        return NULL;
+    }
     
-    if (book_order->side == BUY) {
-        levels = book->buy_levels;
-        level_count = &book->buy_level_count;
-    } else {
-        levels = book->sell_levels;
-        level_count = &book->sell_level_count;
+    uint32_t slot = order_pool_alloc(&book->pool);
+    if (slot == NO_ORDER) {
+        fprintf(stderr, "Order book is full\n");
+        book->counters.rejects++;
+        return NULL;
+    }
+    if (book->pool.live_count > book->counters.max_live_orders) {
+        book->counters.max_live_orders = book->pool.live_count;
     }
     
-    // Check if price level already exists
-    int level_index = find_price_level_index(levels, *level_count, book_order->price);
+    // Split into the slot's hot record and cold fields, keeping the slot's generation
+    RestingOrder* book_order = &book->pool.orders[slot];
+    OrderInfo* info = &book->pool.info[slot];
+    book_order->owner = order->owner;
+    book_order->quantity = order->quantity;
+    book_order->filled_quantity = 0;
+    book_order->displayed = 0;
+    book_order->side = (uint8_t)order->side;
+    book_order->type = (uint8_t)order->type;
+    book_order->status = OPEN;
+    book_order->stp = (uint8_t)order->stp;
+    book_order->reserved = 0;
+    memcpy(info->id, order->id, MAX_ID_LENGTH);
+    info->price = order->price;
+    info->stop_price = order->stop_price;
+    info->sequence = order->sequence;
+    info->timestamp_ns = order->timestamp_ns;
+    info->display_quantity = order->display_quantity;
+    if (book->risk_gate != NULL) {
+        risk_order_opened(book->risk_gate, order->owner);
+    }
     
-    if (level_index == -1) {
-        // Create new price level
-        if (*level_count >= MAX_PRICE_LEVELS) {
-            fprintf(stderr, "Maximum price levels reached\n");
+    // Stops wait in the trigger book without touching the ladders
+    if (is_stop_type(book_order->type)) {
+        if (arm_stop_order(book, slot) != 0) {
+            fprintf(stderr, "Stop book is full\n");
+            order->status = CANCELLED;
+            book->counters.rejects++;
+            release_order_slot(book, slot);
             return NULL;
         }
-        
-        level_index = *level_count;
-        levels[level_index].price = book_order->price;
-        levels[level_index].total_quantity = 0;
-        levels[level_index].orders = NULL;
-        levels[level_index].order_count = 0;
-        (*level_count)++;
+        book->counters.adds++;
+        return book_order;
     }
     
-    // Add order to price level
-    add_to_price_level(&levels[level_index], book_order);
+    // Match against the opposite side, then rest or retire the remainder
+    book->counters.adds++;
+    RestingOrder* resting = activate_order(book, slot, false);
     
-    // Sort price levels
-    sort_price_levels(levels, *level_count, book_order->side);
+    // Report the outcome to the caller; a released slot keeps these fields
+    order->filled_quantity = book_order->filled_quantity;
+    order->status = (OrderStatus)book_order->status;
     
-    // Try to match orders
-    match_orders(book);
+    run_stop_triggers(book);
+    return resting;
+}
+
+// Take a live order out of its level and return its slot to the pool
+static void remove_order_slot(OrderBook* book, uint32_t slot) {
+    RestingOrder* order = &book->pool.orders[slot];
+    
+    order->status = CANCELLED;
     
-    return book_order;
+    // Disarm a waiting stop, or remove a resting order from its price level
+    if (is_stop_type(order->type)) {
+        stop_heap_remove((order->side == BUY) ? &book->buy_stops : &book->sell_stops,
+                         book->pool.orders, order->prev);
+    } else {
+        PriceLadder* ladder = (order->side == BUY) ? &book->bids : &book->asks;
+        PriceLevel* level = ladder_find_level(ladder, book->pool.info[slot].price);
+        if (level != NULL) {
+            remove_from_price_level(book->pool.orders, ladder, level, slot);
+            if (book->market_data != NULL) {
+                market_data_order_changed(book->market_data, book, MD_ORDER_DELETE, order, level);
+            }
+        }
+    }
+    order_index_remove(&book->order_index, book->pool.info[slot].id);
+    release_order_slot(book, slot);
 }
 
-// Cancel an order
-void cancel_order(OrderBook* book, const char* order_id) {
-    Order* order = find_order_by_id(book, order_id);
-    if (order == NULL) {
-        printf("Order not found: %s\n", order_id);
+// Remove a live order by ID; returns -1 if there is none
+static int remove_order(OrderBook* book, const char* order_id) {
+    uint32_t slot = order_index_find(&book->order_index, order_id);
+    if (slot == NO_ORDER) {
+        return -1;
+    }
+    remove_order_slot(book, slot);
+    return 0;
+}
+
+// Cancel/replace a live order in place, keeping its slot and ID. A smaller
+// quantity at the same price keeps the order's place in the queue. A price
+// change or a larger quantity loses it: the order leaves its level, takes a
+// new arrival stamp, and gets one matching attempt of its own before it rests
+// at the back of its new level. A quantity at or below what has filled
+// cancels the rest. Armed stops are updated where they wait.
+static void replace_order(OrderBook* book, uint32_t slot, int new_quantity, Price new_price) {
+    RestingOrder* order = &book->pool.orders[slot];
+    OrderInfo* info = &book->pool.info[slot];
+    if (new_quantity <= order->filled_quantity) {
+        remove_order_slot(book, slot);
         return;
     }
-    
-    if (order->status == FILLED) {
-        printf("Cannot cancel filled order: %s\n", order_id);
+    if (is_stop_type(order->type)) {
+        order->quantity = new_quantity;
+        info->price = new_price;
         return;
     }
     
-    order->status = CANCELLED;
-    
-    // Remove from price levels
-    PriceLevel* levels;
-    int* level_count;
-    
-    if (order->side == BUY) {
-        levels = book->buy_levels;
-        level_count = &book->buy_level_count;
-    } else {
-        levels = book->sell_levels;
-        level_count = &book->sell_level_count;
+    PriceLadder* ladder = (order->side == BUY) ? &book->bids : &book->asks;
+    PriceLevel* level = ladder_find_level(ladder, info->price);
+    MarketDataFeed* feed = book->market_data;
+    if (new_price == info->price && new_quantity <= order->quantity) {
+        // Shrink in place; an iceberg keeps what is left of its current peak
+        int quantity_diff = order->quantity - new_quantity;
+        if (quantity_diff == 0) {
+            return;
+        }
+        order->quantity = new_quantity;
+        int displayed = displayable_quantity(&book->pool, slot);
+        if (order->type == ICEBERG && order->displayed < displayed) {
+            displayed = order->displayed;
+        }
+        level->total_quantity -= quantity_diff;
+        level->displayed_quantity += displayed - order->displayed;
+        order->displayed = displayed;
+        if (feed != NULL) {
+            market_data_order_changed(feed, book, MD_ORDER_MODIFY, order, level);
+        }
+        return;
     }
     
-    int level_index = find_price_level_index(levels, *level_count, order->price);
-    if (level_index != -1) {
-        remove_from_price_level(&levels[level_index], order_id);
-        
-        // Remove empty price levels
-        if (levels[level_index].order_count == 0) {
-            for (int i = level_index; i < *level_count - 1; i++) {
-                levels[i] = levels[i + 1];
-            }
-            (*level_count)--;
+    // Requeue: unlink, restamp, then match and rest like a new order
+    remove_from_price_level(book->pool.orders, ladder, level, slot);
+    if (feed != NULL) {
+        market_data_order_changed(feed, book, MD_ORDER_DELETE, order, level);
+    }
+    order->quantity = new_quantity;
+    update_order_status(order);
+    info->price = new_price;
+    info->sequence = book->event_sequence;
+    info->timestamp_ns = book->event_time_ns;
+    activate_order(book, slot, true);
+    run_stop_triggers(book);
+}
+
+// Publish the event's changes to the attached market data feed and quote
+// view; during an auction call the indicative uncross is refreshed first.
+// With stats attached, the command's matching since start and the publishing
+// are timed, and the periodic dump is written when it is due.
+static void publish_book_changes(OrderBook* book, uint64_t start) {
+    EngineStats* stats = book->stats;
+    start = stats_stage_end(stats, STAGE_MATCH, start);
+    if (book->auction.call_phase) {
+        update_indicative(book);
+    }
+    if (book->market_data != NULL) {
+        market_data_publish(book->market_data, book);
+    }
+    if (book->quote_view != NULL) {
+        publish_quote_view(book->quote_view, book);
+    }
+    if (stats != NULL) {
+        stats_stage_end(stats, STAGE_PUBLISH, start);
+        if (stats->sink != NULL && book->event_time_ns >= stats->next_dump_ns) {
+            write_stats_dump(stats, book->event_time_ns);
         }
     }
+}
+
+// Use an upstream sequence number and timestamp for the next command on a
+// book instead of drawing new ones (a sequencer thread, or journal replay)
+void stamp_next_event(OrderBook* book, uint64_t sequence, uint64_t timestamp_ns) {
+    book->event_sequence = sequence;
+    book->event_time_ns = timestamp_ns;
+    book->event_stamped = true;
+}
+
+// Give an inbound command its place in the event order and its time; an
+// unstamped command is on the sequencing thread, so drawing is a plain
+// increment (see event_clock.c)
+static void begin_command(OrderBook* book) {
+    if (book->event_stamped) {
+        book->event_stamped = false;
+        return;
+    }
+    book->event_sequence = next_event_sequence();
+    book->event_time_ns = event_clock_ns();
+}
+
+// Add an order to the order book; the caller's order receives the fill results
+RestingOrder* add_order(OrderBook* book, Order* order) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
     
-    printf("Cancelled order: %s\n", order_id);
+    // Orders the risk gate turns away never reach the book or the journal
+    if (book->risk_gate != NULL) {
+        RiskRule rule = risk_check_order(book->risk_gate, book, order);
+        start = stats_stage_end(book->stats, STAGE_RISK, start);
+        if (rule != RISK_ACCEPTED) {
+            order->status = REJECTED;
+            order->filled_quantity = 0;
+            book->counters.rejects++;
+            return NULL;
+        }
+    }
+    if (book->journal != NULL) {
+        journal_append_order(book->journal, book, order);
+    }
+    RestingOrder* resting = insert_order(book, order);
+    publish_book_changes(book, start);
+    return resting;
 }
 
-// Modify an order
-void modify_order(OrderBook* book, const char* order_id, int new_quantity, double new_price) {
-    Order* order = find_order_by_id(book, order_id);
+// Cancel an order; returns -1 if no live order has that ID
+int cancel_order(OrderBook* book, const char* order_id) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    if (book->journal != NULL) {
+        journal_append_command(book->journal, JOURNAL_CANCEL, book, order_id, 0, 0);
+    }
+    int result = remove_order(book, order_id);
+    if (result == 0) {
+        book->counters.cancels++;
+    }
+    publish_book_changes(book, start);
+    return result;
+}
+
+// Journal and apply a modify of a live order; only commands that found their
+// order are journaled, so replay never meets one that cannot apply. A modify
+// that raises the quantity or moves the price of an order it leaves open is
+// risk checked like a new order first; returns -1 if the gate turns it down.
+static int modify_order_slot(OrderBook* book, uint32_t slot, int new_quantity, Price new_price, uint64_t* start) {
+    const RestingOrder* order = &book->pool.orders[slot];
+    if (book->risk_gate != NULL && new_quantity > order->filled_quantity &&
+        (new_quantity > order->quantity || new_price != book->pool.info[slot].price)) {
+        Order replaced;
+        load_order(book, slot, &replaced);
+        replaced.quantity = new_quantity;
+        replaced.price = new_price;
+        RiskRule rule = risk_check_replace(book->risk_gate, book, &replaced);
+        *start = stats_stage_end(book->stats, STAGE_RISK, *start);
+        if (rule != RISK_ACCEPTED) {
+            book->counters.rejects++;
+            return -1;
+        }
+    }
+    if (book->journal != NULL) {
+        journal_append_command(book->journal, JOURNAL_MODIFY, book, book->pool.info[slot].id, new_price,
+                               new_quantity);
+    }
+    replace_order(book, slot, new_quantity, new_price);
+    book->counters.modifies++;
+    return 0;
+}
+
+// Modify an order's quantity and price (see replace_order); returns -1 if no
+// live order has that ID
+int modify_order(OrderBook* book, const char* order_id, int new_quantity, Price new_price) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    uint32_t slot = order_index_find(&book->order_index, order_id);
+    int result = (slot != NO_ORDER) ? modify_order_slot(book, slot, new_quantity, new_price, &start) : -1;
+    publish_book_changes(book, start);
+    return result;
+}
+
+// Modify an order through a handle kept from when it was added, skipping the
+// ID lookup; returns -1 if the handle's order is gone
+int modify_order_by_handle(OrderBook* book, OrderHandle handle, int new_quantity, Price new_price) {
+    RestingOrder* order = order_pool_resolve(&book->pool, handle);
     if (order == NULL) {
-        printf("Order not found: %s\n", order_id);
-        return;
+        return -1;
     }
     
-    if (order->status == FILLED) {
-        printf("Cannot modify filled order: %s\n", order_id);
-        return;
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    int result = modify_order_slot(book, order_slot(book, order), new_quantity, new_price, &start);
+    publish_book_changes(book, start);
+    return result;
+}
+
+// Check a replacement while the order it replaces is still live: it must
+// keep that order's side, must not reuse another live order's ID, must pass
+// the risk gate and hold a positive quantity and peak, and a fill-or-kill
+// replacement must be able to fill. Returns false, with the replacement's
+// status set, if it would be turned away.
+static bool replacement_accepted(OrderBook* book, uint32_t slot, Order* order, uint64_t* start) {
+    const RestingOrder* original = &book->pool.orders[slot];
+    uint32_t existing = order_index_find(&book->order_index, order->id);
+    order->status = REJECTED;
+    order->filled_quantity = 0;
+    if ((OrderSide)original->side != order->side) {
+        fprintf(stderr, "Replacement must keep the side of %s\n", book->pool.info[slot].id);
+        book->counters.rejects++;
+        return false;
+    }
+    if (existing != NO_ORDER && existing != slot) {
+        fprintf(stderr, "Duplicate order ID: %s\n", order->id);
+        book->counters.rejects++;
+        return false;
     }
     
-    // If price is changing, we need to remove and re-add
-    if (order->price != new_price) {
-        // Cancel the original order
-        Order temp_order;
-        memcpy(&temp_order, order, sizeof(Order));
-        cancel_order(book, order_id);
-        
-        // Create a new order with the updated price and quantity
-        temp_order.price = new_price;
-        temp_order.quantity = new_quantity;
-        add_order(book, &temp_order);
-    } else if (order->quantity != new_quantity) {
-        // Only quantity is changing, update it directly
-        int quantity_diff = new_quantity - order->quantity;
-        order->quantity = new_quantity;
-        
-        // Update the price level total quantity
-        PriceLevel* levels;
-        int* level_count;
-        
-        if (order->side == BUY) {
-            levels = book->buy_levels;
-            level_count = &book->buy_level_count;
-        } else {
-            levels = book->sell_levels;
-            level_count = &book->sell_level_count;
+    // The replacement takes over the original's open order unless it changes owner
+    if (book->risk_gate != NULL) {
+        RiskRule rule = (order->owner == original->owner) ? risk_check_replace(book->risk_gate, book, order)
+                                                          : risk_check_order(book->risk_gate, book, order);
+        *start = stats_stage_end(book->stats, STAGE_RISK, *start);
+        if (rule != RISK_ACCEPTED) {
+            book->counters.rejects++;
+            return false;
         }
-        
-        int level_index = find_price_level_index(levels, *level_count, order->price);
-        if (level_index != -1) {
-            levels[level_index].total_quantity += quantity_diff;
+    }
+    if (order->quantity <= 0 || (order->type == ICEBERG && order->display_quantity <= 0)) {
+        fprintf(stderr, "Order quantity and peak must be positive: %s\n", order->id);
+        book->counters.rejects++;
+        return false;
+    }
+    if (order->type == FOK && !can_fill_completely(book, order)) {
+        order->status = CANCELLED;
+        book->counters.rejects++;
+        return false;
+    }
+    return true;
+}
+
+// Cancel a live order and add a replacement, which may take a new ID, as one
+// command with one journal record. The replacement is checked first (see
+// replacement_accepted), so the original is only cancelled once its
+// replacement will be accepted. Returns like add_order; NULL with the
+// replacement REJECTED if no live order has that ID.
+RestingOrder* cancel_replace_order(OrderBook* book, const char* order_id, Order* order) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    uint32_t slot = order_index_find(&book->order_index, order_id);
+    RestingOrder* resting = NULL;
+    if (slot == NO_ORDER) {
+        order->status = REJECTED;
+        order->filled_quantity = 0;
+    } else if (replacement_accepted(book, slot, order, &start)) {
+        if (book->journal != NULL) {
+            journal_append_replace(book->journal, book, order_id, order);
         }
-        
-        printf("Modified order quantity: %s, New Qty: %d\n", order_id, new_quantity);
+        remove_order_slot(book, slot);
+        book->counters.cancels++;
+        resting = insert_order(book, order);
     }
+    publish_book_changes(book, start);
+    return resting;
 }
 
-// Match orders in the order book
-void match_orders(OrderBook* book) {
+// Apply self-trade prevention to the same-owner orders at the front of the
+// best bid and ask; the newer of the two brings the mode
+static void prevent_resting_self_trade(OrderBook* book, PriceLevel* best_buy, PriceLevel* best_sell) {
+    const OrderInfo* info = book->pool.info;
+    bool buy_newer = info[best_buy->head].sequence > info[best_sell->head].sequence;
+    PriceLadder* newer_ladder = buy_newer ? &book->bids : &book->asks;
+    PriceLadder* older_ladder = buy_newer ? &book->asks : &book->bids;
+    PriceLevel* newer_level = buy_newer ? best_buy : best_sell;
+    PriceLevel* older_level = buy_newer ? best_sell : best_buy;
+    const RestingOrder* newer = &book->pool.orders[newer_level->head];
+    const RestingOrder* older = &book->pool.orders[older_level->head];
+    
+    int newer_cut;
+    int older_cut;
+    self_trade_cuts((SelfTradeMode)newer->stp, newer->quantity - newer->filled_quantity,
+                    older->quantity - older->filled_quantity, &newer_cut, &older_cut);
+    if (older_cut > 0) {
+        reduce_front_order(book, older_ladder, older_level, older_cut);
+    }
+    if (newer_cut > 0) {
+        reduce_front_order(book, newer_ladder, newer_level, newer_cut);
+    }
+}
+
+// Trade the best bid and ask against each other in price-time priority while
+// they cross: at the resting sell's price, or with an auction price, only
+// while the bid is at or above it and the ask at or below it, all at that
+// price. Returns the quantity traded.
+static int cross_resting_orders(OrderBook* book, Price auction_price) {
+    int traded = 0;
+    
     // Match while we have both buy and sell levels
-    while (book->buy_level_count > 0 && book->sell_level_count > 0) {
-        PriceLevel* best_buy = &book->buy_levels[0];  // Highest buy price
-        PriceLevel* best_sell = &book->sell_levels[0];  // Lowest sell price
+    while (book->bids.level_count > 0 && book->asks.level_count > 0) {
+        PriceLevel* best_buy = ladder_best_level(&book->bids);  // Highest buy price
+        PriceLevel* best_sell = ladder_best_level(&book->asks);  // Lowest sell price
         
         // Check if we can match
-        if (best_buy->price >= best_sell->price) {
+        bool crosses = (auction_price != 0) ?
+            best_buy->price >= auction_price && best_sell->price <= auction_price :
+            best_buy->price >= best_sell->price;
+        if (crosses) {
             // Get the first order in each price level (FIFO)
-            Order* buy_order = &best_buy->orders[0];
-            Order* sell_order = &best_sell->orders[0];
+            RestingOrder* buy_order = &book->pool.orders[best_buy->head];
+            RestingOrder* sell_order = &book->pool.orders[best_sell->head];
+            
+            // Retire an order with nothing open left instead of trading zero
+            if (buy_order->filled_quantity >= buy_order->quantity) {
+                reduce_front_order(book, &book->bids, best_buy, 0);
+                continue;
+            }
+            if (sell_order->filled_quantity >= sell_order->quantity) {
+                reduce_front_order(book, &book->asks, best_sell, 0);
+                continue;
+            }
+            if (buy_order->owner == sell_order->owner && buy_order->owner != NO_OWNER) {
+                prevent_resting_self_trade(book, best_buy, best_sell);
+                continue;
+            }
             
-            // Calculate trade quantity
-            int buy_qty = buy_order->quantity - buy_order->filled_quantity;
-            int sell_qty = sell_order->quantity - sell_order->filled_quantity;
+            // Calculate trade quantity from the shown sizes
+            int buy_qty = buy_order->displayed;
+            int sell_qty = sell_order->displayed;
             int trade_qty = (buy_qty < sell_qty) ? buy_qty : sell_qty;
             
             // Execute the trade
-            execute_trade(book, buy_order, sell_order, trade_qty);
-            
-            // Update price level quantities
-            best_buy->total_quantity -= trade_qty;
-            best_sell->total_quantity -= trade_qty;
+            execute_trade(book, buy_order, sell_order, (auction_price != 0) ? auction_price : best_sell->price,
+                          trade_qty);
+            traded += trade_qty;
             
-            // Clean up filled orders
-            cleanup_filled_orders(book);
+            // Pop whichever orders completed and requeue spent iceberg peaks;
+            // empty levels drop out
+            settle_front_order(book, &book->bids, best_buy, trade_qty);
+            settle_front_order(book, &book->asks, best_sell, trade_qty);
         } else {
             // No more matches possible
             break;
         }
     }
+    return traded;
+}
+
+// Uncross the resting book; add_order matches incoming orders itself, so
+// this only trades when resting orders were allowed to cross
+void match_orders(OrderBook* book) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    if (book->journal != NULL) {
+        journal_append_command(book->journal, JOURNAL_MATCH, book, NULL, 0, 0);
+    }
+    cross_resting_orders(book, 0);
+    run_stop_triggers(book);
+    publish_book_changes(book, start);
+}
+
+// Put a book into an auction call: orders rest without matching, even across
+// the spread, until uncross_auction
+void start_auction(OrderBook* book) {
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    if (book->journal != NULL) {
+        journal_append_command(book->journal, JOURNAL_AUCTION, book, NULL, 0, 0);
+    }
+    book->auction.call_phase = true;
+    book->auction.changed = true;
+    publish_book_changes(book, start);
 }
 
-// Print the order book (L2 view)
+// End the call by trading every crossing order at the equilibrium price in
+// one pass, best prices first and in time order within a price. Self-trade
+// prevention can leave a cross behind, which then matches continuously. Armed
+// stops see the auction's trades once it is over. Returns the quantity traded
+// at the auction price, or -1 if the book was not in a call.
+int uncross_auction(OrderBook* book) {
+    if (!book->auction.call_phase) {
+        return -1;
+    }
+    begin_command(book);
+    uint64_t start = stats_stage_begin(book->stats);
+    if (book->journal != NULL) {
+        journal_append_command(book->journal, JOURNAL_UNCROSS, book, NULL, 0, 0);
+    }
+    
+    Price price;
+    int matched_quantity;
+    int imbalance;
+    auction_equilibrium(book, &price, &matched_quantity, &imbalance);
+    int traded = (price != 0) ? cross_resting_orders(book, price) : 0;
+    
+    book->auction.call_phase = false;
+    book->auction.changed = true;
+    book->auction.indicative_price = price;
+    book->auction.matched_quantity = traded;
+    book->auction.imbalance = imbalance;
+    cross_resting_orders(book, 0);
+    run_stop_triggers(book);
+    publish_book_changes(book, start);
+    return traded;
+}
+
+// Print the order book (L2 view); hidden iceberg reserves are not shown
 void print_order_book(const OrderBook* book) {
     printf("\n=== ORDER BOOK: %s ===\n", book->symbol);
     printf("%-10s %-10s %-10s\n", "Price", "Quantity", "Count");
     
     // Print sell levels (from high to low)
-    for (int i = book->sell_level_count - 1; i >= 0; i--) {
+    for (int i = book->asks.high; i >= 0 && i >= book->asks.low; i--) {
+        const PriceLevel* level = &book->asks.levels[i];
+        if (level->order_count == 0) {
+            continue;
+        }
         printf("%-10.2f %-10d %-10d\n", 
-               book->sell_levels[i].price, 
-               book->sell_levels[i].total_quantity, 
-               book->sell_levels[i].order_count);
+               price_to_double(level->price), 
+               level->displayed_quantity, 
+               level->order_count);
     }
     
     printf("--------------------\n");
     
     // Print buy levels (from high to low)
-    for (int i = 0; i < book->buy_level_count; i++) {
+    for (int i = book->bids.high; i >= 0 && i >= book->bids.low; i--) {
+        const PriceLevel* level = &book->bids.levels[i];
+        if (level->order_count == 0) {
+            continue;
+        }
         printf("%-10.2f %-10d %-10d\n", 
-               book->buy_levels[i].price, 
-               book->buy_levels[i].total_quantity, 
-               book->buy_levels[i].order_count);
+               price_to_double(level->price), 
+               level->displayed_quantity, 
+               level->order_count);
     }
     
     printf("========================\n");
+    if (book->auction.call_phase) {
+        print_auction_state(book);
+    }
 }
 
 // Print an order
@@ -296,85 +687,153 @@ void print_order(const Order* order) {
         case FILLED: status_str = "FILLED"; break;
         case PARTIALLY_FILLED: status_str = "PARTIALLY FILLED"; break;
         case CANCELLED: status_str = "CANCELLED"; break;
+        case REJECTED: status_str = "REJECTED"; break;
         default: status_str = "UNKNOWN";
     }
     
-    printf("Order ID: %s, Symbol: %s, Side: %s, Price: %.2f, Quantity: %d, Filled: %d, Status: %s\n",
-           order->id, order->symbol, side_str, order->price, order->quantity, order->filled_quantity, status_str);
+    printf("Order ID: %s, Symbol: %s, Side: %s, Price: %.2f, Quantity: %d, Filled: %d, Status: %s, Seq: %llu\n",
+           order->id, order->symbol, side_str, price_to_double(order->price), order->quantity, order->filled_quantity, status_str,
+           (unsigned long long)order->sequence);
+}
+
+// Find a live (resting) order by ID
+RestingOrder* find_order_by_id(OrderBook* book, const char* order_id) {
+    uint32_t slot = order_index_find(&book->order_index, order_id);
+    return (slot != NO_ORDER) ? &book->pool.orders[slot] : NULL;
+}
+
+// Pool slot of a live order
+uint32_t order_slot(const OrderBook* book, const RestingOrder* order) {
+    return (uint32_t)(order - book->pool.orders);
+}
+
+// Cold fields (ID, price, stop price, peak, sequence, timestamp) of a live order
+const OrderInfo* order_info(const OrderBook* book, const RestingOrder* order) {
+    return &book->pool.info[order_slot(book, order)];
 }
 
-// Find an order by ID
-Order* find_order_by_id(OrderBook* book, const char* order_id) {
-    for (int i = 0; i < book->order_count; i++) {
-        if (strcmp(book->all_orders[i].id, order_id) == 0) {
-            return &book->all_orders[i];
+// Reassemble the full order held in a pool slot from its hot and cold parts
+void load_order(const OrderBook* book, uint32_t slot, Order* order) {
+    const RestingOrder* resting = &book->pool.orders[slot];
+    const OrderInfo* info = &book->pool.info[slot];
+    memset(order, 0, sizeof(Order));
+    memcpy(order->id, info->id, MAX_ID_LENGTH);
+    memcpy(order->symbol, book->symbol, MAX_SYMBOL_LENGTH);
+    order->side = (OrderSide)resting->side;
+    order->type = (OrderType)resting->type;
+    order->price = info->price;
+    order->stop_price = info->stop_price;
+    order->quantity = resting->quantity;
+    order->filled_quantity = resting->filled_quantity;
+    order->display_quantity = info->display_quantity;
+    order->owner = resting->owner;
+    order->stp = (SelfTradeMode)resting->stp;
+    order->sequence = info->sequence;
+    order->timestamp_ns = info->timestamp_ns;
+    order->status = (OrderStatus)resting->status;
+}
+
+// Get the best price level on one side of the book, or NULL when empty
+PriceLevel* best_price_level(const OrderBook* book, OrderSide side) {
+    return ladder_best_level((side == BUY) ? &book->bids : &book->asks);
+}
+
+// Parse an order type name, case-insensitive; returns -1 if it is not one
+int parse_order_type(const char* text, size_t length, OrderType* type) {
+    static const char* names[] = {"LIMIT", "MARKET", "IOC", "FOK", "STOP", "STOP_LIMIT", "ICEBERG"};
+    for (int t = LIMIT; t <= ICEBERG; t++) {
+        if (strlen(names[t]) == length && strncasecmp(text, names[t], length) == 0) {
+            *type = (OrderType)t;
+            return 0;
         }
     }
-    return NULL;
+    return -1;
 }
 
-// Load orders from a CSV file
-int load_orders_from_csv(OrderBook* book, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Failed to open file");
-        return -1;
+// Order type name for display and CSV output
+const char* order_type_to_string(OrderType type) {
+    switch (type) {
+        case MARKET: return "MARKET";
+        case IOC: return "IOC";
+        case FOK: return "FOK";
+        case STOP: return "STOP";
+        case STOP_LIMIT: return "STOP_LIMIT";
+        case ICEBERG: return "ICEBERG";
+        default: return "LIMIT";
     }
-    
-    char line[256];
-    int line_num = 0;
-    
-    // Skip header line
-    fgets(line, sizeof(line), file);
-    line_num++;
-    
-    while (fgets(line, sizeof(line), file)) {
-        line_num++;
-        
-        // Parse CSV line
-        char id[MAX_ID_LENGTH];
-        char symbol[MAX_SYMBOL_LENGTH];
-        char side_str[8];
-        double price;
-        int quantity;
-        
-        if (sscanf(line, "%[^,],%[^,],%[^,],%lf,%d", id, symbol, side_str, &price, &quantity) != 5) {
-            fprintf(stderr, "Invalid format at line %d: %s", line_num, line);
-            continue;
+}
+
+// Parse a self-trade prevention mode name, case-insensitive; returns -1 if it is not one
+int parse_stp_mode(const char* text, size_t length, SelfTradeMode* mode) {
+    static const char* names[] = {"CANCEL_NEWEST", "CANCEL_OLDEST", "CANCEL_BOTH", "DECREMENT"};
+    for (int m = STP_CANCEL_NEWEST; m <= STP_DECREMENT; m++) {
+        if (strlen(names[m]) == length && strncasecmp(text, names[m], length) == 0) {
+            *mode = (SelfTradeMode)m;
+            return 0;
         }
+    }
+    return -1;
+}
+
+// Self-trade prevention mode name for display
+const char* stp_mode_to_string(SelfTradeMode mode) {
+    switch (mode) {
+        case STP_CANCEL_OLDEST: return "CANCEL_OLDEST";
+        case STP_CANCEL_BOTH: return "CANCEL_BOTH";
+        case STP_DECREMENT: return "DECREMENT";
+        default: return "CANCEL_NEWEST";
+    }
+}
+
+// Convert a decimal price to integer ticks, rounding to the nearest tick
+Price price_from_double(double price) {
+    double ticks = price * PRICE_SCALE;
+    return (Price)((ticks < 0) ? ticks - 0.5 : ticks + 0.5);
+}
+
+// Convert integer ticks back to a decimal price for display
+double price_to_double(Price price) {
+    return (double)price / PRICE_SCALE;
+}
+
+// Route one parsed batch of CSV orders to the books for their symbols
+static void add_csv_orders(void* context, Order* orders, int count) {
+    registry_add_orders((SymbolRegistry*)context, orders, count);
+}
+
+// Load orders from a CSV file, routing each row to the book for its symbol
+int load_orders_from_csv(SymbolRegistry* registry, const char* filename) {
+    return read_order_batches_from_csv(filename, add_csv_orders, registry);
+}
+
+// Write the resting orders of one side in price-time priority
+static void write_ladder_orders(FILE* file, const OrderBook* book, const PriceLadder* ladder) {
+    for (int i = ladder->high; i >= 0 && i >= ladder->low; i--) {
+        // Best level first: bids walk down from high, asks walk up from low
+        uint32_t slot = ladder->levels[(ladder->side == BUY) ? i : ladder->low + ladder->high - i].head;
         
-        // Create order
-        Order order;
-        strncpy(order.id, id, MAX_ID_LENGTH - 1);
-        order.id[MAX_ID_LENGTH - 1] = '\0';
-        strncpy(order.symbol, symbol, MAX_SYMBOL_LENGTH - 1);
-        order.symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
-        
-        // Parse side
-        if (strcasecmp(side_str, "BUY") == 0) {
-            order.side = BUY;
-        } else if (strcasecmp(side_str, "SELL") == 0) {
-            order.side = SELL;
-        } else {
-            fprintf(stderr, "Invalid side at line %d: %s\n", line_num, side_str);
-            continue;
+        while (slot != NO_ORDER) {
+            const RestingOrder* order = &book->pool.orders[slot];
+            const OrderInfo* info = &book->pool.info[slot];
+            const char* side_str = (order->side == BUY) ? "BUY" : "SELL";
+            int remaining = order->quantity - order->filled_quantity;
+            
+            // Everything resting trades as a limit; an iceberg keeps its peak
+            fprintf(file, "%s,%s,%s,%.2f,%d,", info->id, book->symbol, side_str, price_to_double(info->price),
+                    remaining);
+            if (order->type == ICEBERG) {
+                int peak = (info->display_quantity < remaining) ? info->display_quantity : remaining;
+                fprintf(file, "ICEBERG,%d\n", peak);
+            } else {
+                fprintf(file, "LIMIT\n");
+            }
+            slot = order->next;
         }
-        
-        order.price = price;
-        order.quantity = quantity;
-        order.filled_quantity = 0;
-        order.timestamp = time(NULL);
-        order.status = OPEN;
-        
-        // Add to order book
-        add_order(book, &order);
     }
-    
-    fclose(file);
-    return 0;
 }
 
-// Save orders to a CSV file
+// Save resting orders to a CSV file in the loader's schema, each with the
+// quantity it has left, so load reads the file back into the same queues
 int save_orders_to_csv(const OrderBook* book, const char* filename) {
     FILE* file = fopen(filename, "w");
     if (file == NULL) {
@@ -383,34 +842,53 @@ int save_orders_to_csv(const OrderBook* book, const char* filename) {
     }
     
     // Write header
-    fprintf(file, "ID,Symbol,Side,Price,Quantity,Filled,Status\n");
+    fprintf(file, "ID,Symbol,Side,Price,Quantity,Type,Peak\n");
     
-    // Write orders
-    for (int i = 0; i < book->order_count; i++) {
-        const Order* order = &book->all_orders[i];
-        const char* side_str = (order->side == BUY) ? "BUY" : "SELL";
-        const char* status_str;
-        
-        switch (order->status) {
-            case OPEN: status_str = "OPEN"; break;
-            case FILLED: status_str = "FILLED"; break;
-            case PARTIALLY_FILLED: status_str = "PARTIALLY FILLED"; break;
-            case CANCELLED: status_str = "CANCELLED"; break;
-            default: status_str = "UNKNOWN";
-        }
-        
-        fprintf(file, "%s,%s,%s,%.2f,%d,%d,%s\n",
-                order->id, order->symbol, side_str, order->price,
-                order->quantity, order->filled_quantity, status_str);
-    }
+    // Write resting orders, bids first
+    write_ladder_orders(file, book, &book->bids);
+    write_ladder_orders(file, book, &book->asks);
     
     fclose(file);
     return 0;
 }
 
-// Process user input
-void process_user_input(OrderBook* book) {
+// Commit the command's journal records, then write out pending trade
+// reports unless a consumer thread owns the ring
+static void complete_command(OrderBook* book) {
+    if (book->journal != NULL) {
+        journal_commit(book->journal);
+    }
+    if (book->exec_ring != NULL && !book->exec_ring->threaded) {
+        exec_ring_flush(book->exec_ring);
+    }
+}
+
+// Report why the risk gate rejected an order, how much of an order that may
+// not rest was filled, or that a stop was armed
+static void print_immediate_outcome(const OrderBook* book, const Order* order) {
+    if (order->status == REJECTED) {
+        printf("Order %s rejected: %s\n", order->id, risk_rule_to_string(book->risk_gate->last_rule));
+    } else if (is_stop_type(order->type)) {
+        if (order->status != CANCELLED) {
+            printf("%s order %s armed at %.2f\n", order_type_to_string(order->type), order->id,
+                   price_to_double(order->stop_price));
+        }
+    } else if (order->type != LIMIT && order->type != ICEBERG) {
+        printf("%s order %s: filled %d of %d%s\n", order_type_to_string(order->type), order->id,
+               order->filled_quantity, order->quantity,
+               (order->status == CANCELLED) ? ", remainder cancelled" : "");
+    }
+}
+
+// Process user input; order commands apply to the active symbol's book
+void process_user_input(SymbolRegistry* registry, const char* symbol) {
+    OrderBook* book = registry_get_book(registry, symbol);
+    if (book == NULL) {
+        return;
+    }
     char input[256];
+    uint32_t owner = NO_OWNER;              // Set by the account command for later orders
+    SelfTradeMode stp = STP_CANCEL_NEWEST;
     
     while (1) {
         printf("\nEnter command (help for list of commands): ");
@@ -434,9 +912,15 @@ void process_user_input(OrderBook* book) {
             char id[MAX_ID_LENGTH];
             double price;
             int quantity;
+            char type_str[12];
+            double extra = 0;
+            OrderType type = LIMIT;
             
-            if (sscanf(input, "%*s %15s %lf %d", id, &price, &quantity) != 3) {
-                printf("Invalid format. Usage: buy <id> <price> <quantity>\n");
+            // Stop types take a trailing stop price, icebergs their peak
+            int fields = sscanf(input, "%*s %15s %lf %d %11s %lf", id, &price, &quantity, type_str, &extra);
+            if (fields < 3 || (fields >= 4 && parse_order_type(type_str, strlen(type_str), &type) != 0) ||
+                (fields == 5) != (is_stop_type(type) || type == ICEBERG)) {
+                printf("Invalid format. Usage: buy <id> <price> <quantity> [type] [stop_price|peak]\n");
                 continue;
             }
             
@@ -446,18 +930,31 @@ void process_user_input(OrderBook* book) {
             strncpy(order.symbol, book->symbol, MAX_SYMBOL_LENGTH - 1);
             order.symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
             order.side = BUY;
-            order.price = price;
+            order.type = type;
+            order.price = price_from_double(price);
+            order.stop_price = is_stop_type(type) ? price_from_double(extra) : 0;
+            order.display_quantity = (type == ICEBERG) ? (int)extra : 0;
             order.quantity = quantity;
+            order.owner = owner;
+            order.stp = stp;
             
             add_order(book, &order);
+            complete_command(book);
+            print_immediate_outcome(book, &order);
             print_order_book(book);
         } else if (strcasecmp(command, "sell") == 0) {
             char id[MAX_ID_LENGTH];
             double price;
             int quantity;
+            char type_str[12];
+            double extra = 0;
+            OrderType type = LIMIT;
             
-            if (sscanf(input, "%*s %15s %lf %d", id, &price, &quantity) != 3) {
-                printf("Invalid format. Usage: sell <id> <price> <quantity>\n");
+            // Stop types take a trailing stop price, icebergs their peak
+            int fields = sscanf(input, "%*s %15s %lf %d %11s %lf", id, &price, &quantity, type_str, &extra);
+            if (fields < 3 || (fields >= 4 && parse_order_type(type_str, strlen(type_str), &type) != 0) ||
+                (fields == 5) != (is_stop_type(type) || type == ICEBERG)) {
+                printf("Invalid format. Usage: sell <id> <price> <quantity> [type] [stop_price|peak]\n");
                 continue;
             }
             
@@ -467,10 +964,17 @@ void process_user_input(OrderBook* book) {
             strncpy(order.symbol, book->symbol, MAX_SYMBOL_LENGTH - 1);
             order.symbol[MAX_SYMBOL_LENGTH - 1] = '\0';
             order.side = SELL;
-            order.price = price;
+            order.type = type;
+            order.price = price_from_double(price);
+            order.stop_price = is_stop_type(type) ? price_from_double(extra) : 0;
+            order.display_quantity = (type == ICEBERG) ? (int)extra : 0;
             order.quantity = quantity;
+            order.owner = owner;
+            order.stp = stp;
             
             add_order(book, &order);
+            complete_command(book);
+            print_immediate_outcome(book, &order);
             print_order_book(book);
         } else if (strcasecmp(command, "cancel") == 0) {
             char id[MAX_ID_LENGTH];
@@ -480,7 +984,12 @@ void process_user_input(OrderBook* book) {
                 continue;
             }
             
-            cancel_order(book, id);
+            if (cancel_order(book, id) == 0) {
+                printf("Cancelled order: %s\n", id);
+            } else {
+                printf("Order not found: %s\n", id);
+            }
+            complete_command(book);
             print_order_book(book);
         } else if (strcasecmp(command, "modify") == 0) {
             char id[MAX_ID_LENGTH];
@@ -492,8 +1001,68 @@ void process_user_input(OrderBook* book) {
                 continue;
             }
             
-            modify_order(book, id, quantity, price);
+            if (modify_order(book, id, quantity, price_from_double(price)) == 0) {
+                printf("Modified order: %s, New Qty: %d, New Price: %.2f\n", id, quantity, price);
+            } else if (find_order_by_id(book, id) != NULL) {
+                printf("Modify of %s rejected: %s\n", id, risk_rule_to_string(book->risk_gate->last_rule));
+            } else {
+                printf("Order not found: %s\n", id);
+            }
+            complete_command(book);
+            print_order_book(book);
+        } else if (strcasecmp(command, "account") == 0) {
+            unsigned long account;
+            char mode_str[16];
+            SelfTradeMode mode = STP_CANCEL_NEWEST;
+            
+            int fields = sscanf(input, "%*s %lu %15s", &account, mode_str);
+            if (fields < 1 || account > UINT32_MAX ||
+                (fields == 2 && parse_stp_mode(mode_str, strlen(mode_str), &mode) != 0)) {
+                printf("Invalid format. Usage: account <owner> [cancel_newest|cancel_oldest|cancel_both|decrement]\n");
+                continue;
+            }
+            
+            owner = (uint32_t)account;
+            stp = mode;
+            if (owner == NO_OWNER) {
+                printf("Orders have no owner\n");
+            } else {
+                printf("Orders belong to account %u, self-trade prevention: %s\n", owner, stp_mode_to_string(stp));
+            }
+        } else if (strcasecmp(command, "auction") == 0) {
+            if (book->auction.call_phase) {
+                printf("Book %s is already in an auction call\n", book->symbol);
+                continue;
+            }
+            start_auction(book);
+            complete_command(book);
+            printf("Auction call started for %s; orders rest without matching until uncross\n", book->symbol);
+        } else if (strcasecmp(command, "uncross") == 0) {
+            int traded = uncross_auction(book);
+            if (traded < 0) {
+                printf("Book %s is not in an auction call\n", book->symbol);
+                continue;
+            }
+            complete_command(book);
+            if (traded > 0) {
+                printf("Uncrossed %d at %.2f\n", traded, price_to_double(book->auction.indicative_price));
+            } else {
+                printf("Auction ended without a cross\n");
+            }
             print_order_book(book);
+        } else if (strcasecmp(command, "risk") == 0) {
+            if (registry->risk_gate != NULL) {
+                print_risk_counts(registry->risk_gate);
+            } else {
+                printf("No risk gate attached\n");
+            }
+        } else if (strcasecmp(command, "stats") == 0) {
+            print_book_counters(book);
+            if (registry->stats != NULL) {
+                print_engine_stats(registry->stats);
+            } else {
+                printf("Stage timing is off; start with --stats to enable it\n");
+            }
         } else if (strcasecmp(command, "book") == 0) {
             print_order_book(book);
         } else if (strcasecmp(command, "order") == 0) {
@@ -504,9 +1073,11 @@ void process_user_input(OrderBook* book) {
                 continue;
             }
             
-            Order* order = find_order_by_id(book, id);
-            if (order != NULL) {
-                print_order(order);
+            RestingOrder* resting = find_order_by_id(book, id);
+            if (resting != NULL) {
+                Order order;
+                load_order(book, order_slot(book, resting), &order);
+                print_order(&order);
             } else {
                 printf("Order not found: %s\n", id);
             }
@@ -521,6 +1092,24 @@ void process_user_input(OrderBook* book) {
             if (save_orders_to_csv(book, filename) == 0) {
                 printf("Orders saved to %s\n", filename);
             }
+        } else if (strcasecmp(command, "snapshot") == 0) {
+            char filename[256];
+            
+            if (sscanf(input, "%*s %255s", filename) != 1) {
+                printf("Invalid format. Usage: snapshot <filename>\n");
+                continue;
+            }
+            
+            // The snapshot covers every journal record committed so far
+            uint64_t journal_sequence = 0;
+            if (registry->journal != NULL) {
+                journal_commit(registry->journal);
+                journal_sequence = registry->journal->next_sequence;
+            }
+            uint64_t exec_sequence = (registry->exec_ring != NULL) ? registry->exec_ring->next_sequence : 0;
+            if (save_snapshot(registry, filename, journal_sequence, exec_sequence) == 0) {
+                printf("Snapshot of %u books saved to %s\n", registry->book_count, filename);
+            }
         } else if (strcasecmp(command, "load") == 0) {
             char filename[256];
             
@@ -529,10 +1118,24 @@ void process_user_input(OrderBook* book) {
                 continue;
             }
             
-            if (load_orders_from_csv(book, filename) == 0) {
+            if (load_orders_from_csv(registry, filename) == 0) {
+                complete_command(book);
                 printf("Orders loaded from %s\n", filename);
                 print_order_book(book);
             }
+        } else if (strcasecmp(command, "use") == 0) {
+            char next_symbol[MAX_SYMBOL_LENGTH];
+            
+            if (sscanf(input, "%*s %7s", next_symbol) != 1) {
+                printf("Invalid format. Usage: use <symbol>\n");
+                continue;
+            }
+            
+            OrderBook* next_book = registry_get_book(registry, next_symbol);
+            if (next_book != NULL) {
+                book = next_book;
+                print_order_book(book);
+            }
         } else if (strcasecmp(command, "exit") == 0 || strcasecmp(command, "quit") == 0) {
             break;
         } else {
@@ -544,15 +1147,25 @@ void process_user_input(OrderBook* book) {
 // Display help information
 void display_help() {
     printf("\n=== ORDER BOOK COMMANDS ===\n");
-    printf("buy <id> <price> <quantity>   - Add a buy order\n");
-    printf("sell <id> <price> <quantity>  - Add a sell order\n");
+    printf("buy <id> <price> <quantity> [type]  - Add a buy order\n");
+    printf("sell <id> <price> <quantity> [type] - Add a sell order\n");
+    printf("  type: limit (default), market, ioc, fok, stop, stop_limit or iceberg\n");
+    printf("  stop and stop_limit take a stop price after the type, iceberg its peak\n");
+    printf("account <owner> [stp_mode]   - Set the owner of later orders (0 for none)\n");
+    printf("  stp_mode: cancel_newest (default), cancel_oldest, cancel_both or decrement\n");
+    printf("auction                      - Start an auction call: orders rest without matching\n");
+    printf("uncross                      - End the call, trading at the equilibrium price\n");
+    printf("risk                         - Show how many orders each risk rule rejected\n");
+    printf("stats                        - Show the book's counters and the stage timings\n");
     printf("cancel <id>                  - Cancel an order\n");
     printf("modify <id> <qty> <price>    - Modify an order\n");
     printf("book                         - Display the order book\n");
     printf("order <id>                   - Display order details\n");
     printf("save <filename>              - Save orders to CSV file\n");
+    printf("snapshot <filename>          - Save a binary snapshot of every book\n");
     printf("load <filename>              - Load orders from CSV file\n");
+    printf("use <symbol>                 - Switch to the book for a symbol\n");
     printf("help                         - Show this help message\n");
     printf("exit/quit                    - Exit the program\n");
     printf("=============================\n");
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -1,7 +1,25 @@
 #include "../include/utils.h"
 #include "../src/orderbook.h"
+#include "../src/order_index.h"
+#include "../src/order_pool.h"
+#include "../src/exec_report.h"
+#include "../src/symbol_registry.h"
+#include "../src/engine.h"
+#include "../src/histogram.h"
+#include "../src/csv_loader.h"
+#include "../src/order_protocol.h"
+#include "../src/journal.h"
+#include "../src/snapshot.h"
+#include "../src/stop_book.h"
+#include "../src/market_data.h"
+#include "../src/quote_view.h"
+#include "../src/event_clock.h"
+#include "../src/risk_gate.h"
+#include "../src/auction.h"
+#include "../src/stats.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
@@ -11,9 +29,9 @@ void test_create_order_book() {
     OrderBook* book = create_order_book("TEST");
     assert(book != NULL);
     assert(strcmp(book->symbol, "TEST") == 0);
-    assert(book->buy_level_count == 0);
-    assert(book->sell_level_count == 0);
-    assert(book->order_count == 0);
+    assert(book->bids.level_count == 0);
+    assert(book->asks.level_count == 0);
+    assert(book->pool.live_count == 0);
     
     free_order_book(book);
     printf("PASSED\n");
@@ -25,34 +43,36 @@ void test_add_order() {
     OrderBook* book = create_order_book("TEST");
     
     // Add a buy order
-    Order buy_order;
+    Order buy_order = {0};
     strcpy(buy_order.id, "B1");
     strcpy(buy_order.symbol, "TEST");
     buy_order.side = BUY;
-    buy_order.price = 100.0;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(100.0);
     buy_order.quantity = 10;
     
     add_order(book, &buy_order);
-    assert(book->buy_level_count == 1);
-    assert(book->buy_levels[0].price == 100.0);
-    assert(book->buy_levels[0].total_quantity == 10);
-    assert(book->buy_levels[0].order_count == 1);
-    assert(book->order_count == 1);
+    assert(book->bids.level_count == 1);
+    assert(best_price_level(book, BUY)->price == price_from_double(100.0));
+    assert(best_price_level(book, BUY)->total_quantity == 10);
+    assert(best_price_level(book, BUY)->order_count == 1);
+    assert(book->pool.live_count == 1);
     
     // Add a sell order
-    Order sell_order;
+    Order sell_order = {0};
     strcpy(sell_order.id, "S1");
     strcpy(sell_order.symbol, "TEST");
     sell_order.side = SELL;
-    sell_order.price = 101.0;
+    sell_order.type = LIMIT;
+    sell_order.price = price_from_double(101.0);
     sell_order.quantity = 5;
     
     add_order(book, &sell_order);
-    assert(book->sell_level_count == 1);
-    assert(book->sell_levels[0].price == 101.0);
-    assert(book->sell_levels[0].total_quantity == 5);
-    assert(book->sell_levels[0].order_count == 1);
-    assert(book->order_count == 2);
+    assert(book->asks.level_count == 1);
+    assert(best_price_level(book, SELL)->price == price_from_double(101.0));
+    assert(best_price_level(book, SELL)->total_quantity == 5);
+    assert(best_price_level(book, SELL)->order_count == 1);
+    assert(book->pool.live_count == 2);
     
     free_order_book(book);
     printf("PASSED\n");
@@ -64,33 +84,36 @@ void test_match_orders() {
     OrderBook* book = create_order_book("TEST");
     
     // Add orders that should match
-    Order buy_order;
+    Order buy_order = {0};
     strcpy(buy_order.id, "B1");
     strcpy(buy_order.symbol, "TEST");
     buy_order.side = BUY;
-    buy_order.price = 101.0;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(101.0);
     buy_order.quantity = 10;
     
-    Order sell_order;
+    Order sell_order = {0};
     strcpy(sell_order.id, "S1");
     strcpy(sell_order.symbol, "TEST");
     sell_order.side = SELL;
-    sell_order.price = 100.0;
+    sell_order.type = LIMIT;
+    sell_order.price = price_from_double(100.0);
     sell_order.quantity = 5;
     
-    Order* b_order = add_order(book, &buy_order);
-    Order* s_order = add_order(book, &sell_order);
+    RestingOrder* b_order = add_order(book, &buy_order);
+    RestingOrder* s_order = add_order(book, &sell_order);
     
-    // Check that orders matched
-    assert(book->order_count == 2);
-    assert(book->buy_levels[0].total_quantity == 5);  // 10 - 5
-    assert(book->sell_levels[0].order_count == 0);     // All sold
+    // Check that orders matched; the filled sell no longer rests
+    assert(s_order == NULL);
+    assert(book->pool.live_count == 1);
+    assert(best_price_level(book, BUY)->total_quantity == 5);  // 10 - 5
+    assert(book->asks.level_count == 0);     // All sold
     
     // Check order statuses
     assert(b_order->filled_quantity == 5); //Need to check this line; it chronically fails. 2 hours dedicated to this bug :/
-    assert(s_order->filled_quantity == 5);
+    assert(sell_order.filled_quantity == 5);
     assert(b_order->status == PARTIALLY_FILLED);
-    assert(s_order->status == FILLED);
+    assert(sell_order.status == FILLED);
     
     free_order_book(book);
     printf("PASSED\n");
@@ -102,23 +125,25 @@ void test_cancel_order() {
     OrderBook* book = create_order_book("TEST");
     
     // Add a buy order
-    Order buy_order;
+    Order buy_order = {0};
     strcpy(buy_order.id, "B1");
     strcpy(buy_order.symbol, "TEST");
     buy_order.side = BUY;
-    buy_order.price = 100.0;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(100.0);
     buy_order.quantity = 10;
     
     add_order(book, &buy_order);
-    assert(book->buy_level_count == 1);
+    assert(book->bids.level_count == 1);
     
-    // Cancel the order
-    cancel_order(book, "B1");
-    assert(book->buy_level_count == 0);
+    // Cancel the order; a second cancel finds nothing
+    assert(cancel_order(book, "B1") == 0);
+    assert(book->bids.level_count == 0);
+    assert(cancel_order(book, "B1") == -1);
     
-    // Check order status
-    Order* b_order = find_order_by_id(book, "B1");
-    assert(b_order->status == CANCELLED);
+    // Cancelled orders leave the ID index and return their slot to the pool
+    assert(find_order_by_id(book, "B1") == NULL);
+    assert(book->pool.live_count == 0);
     
     free_order_book(book);
     printf("PASSED\n");
@@ -130,24 +155,25 @@ void test_modify_order() {
     OrderBook* book = create_order_book("TEST");
     
     // Add a buy order
-    Order buy_order;
+    Order buy_order = {0};
     strcpy(buy_order.id, "B1");
     strcpy(buy_order.symbol, "TEST");
     buy_order.side = BUY;
-    buy_order.price = 100.0;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(100.0);
     buy_order.quantity = 10;
     
     add_order(book, &buy_order);
-    assert(book->buy_levels[0].total_quantity == 10);
+    assert(best_price_level(book, BUY)->total_quantity == 10);
     
     // Modify quantity only
-    modify_order(book, "B1", 15, 100.0);
-    assert(book->buy_levels[0].total_quantity == 15);
+    modify_order(book, "B1", 15, price_from_double(100.0));
+    assert(best_price_level(book, BUY)->total_quantity == 15);
     
     // Modify price
-    modify_order(book, "B1", 15, 105.0);
-    assert(book->buy_levels[0].price == 105.0);
-    assert(book->buy_levels[0].total_quantity == 15);
+    modify_order(book, "B1", 15, price_from_double(105.0));
+    assert(best_price_level(book, BUY)->price == price_from_double(105.0));
+    assert(best_price_level(book, BUY)->total_quantity == 15);
     
     free_order_book(book);
     printf("PASSED\n");
@@ -163,35 +189,38 @@ void test_fifo_matching() {
     strcpy(buy_order1.id, "B1");
     strcpy(buy_order1.symbol, "TEST");
     buy_order1.side = BUY;
-    buy_order1.price = 100.0;
+    buy_order1.type = LIMIT;
+    buy_order1.price = price_from_double(100.0);
     buy_order1.quantity = 10;
     
     Order buy_order2;
     strcpy(buy_order2.id, "B2");
     strcpy(buy_order2.symbol, "TEST");
     buy_order2.side = BUY;
-    buy_order2.price = 100.0;
+    buy_order2.type = LIMIT;
+    buy_order2.price = price_from_double(100.0);
     buy_order2.quantity = 10;
     
-    add_order(book, &buy_order1);
-    add_order(book, &buy_order2);
+    RestingOrder* b1_order = add_order(book, &buy_order1);
+    RestingOrder* b2_order = add_order(book, &buy_order2);
     
     // Add a sell order that matches
-    Order sell_order;
+    Order sell_order = {0};
     strcpy(sell_order.id, "S1");
     strcpy(sell_order.symbol, "TEST");
     sell_order.side = SELL;
-    sell_order.price = 99.0;
+    sell_order.type = LIMIT;
+    sell_order.price = price_from_double(99.0);
     sell_order.quantity = 10;
     
     add_order(book, &sell_order);
     
     // Check that the first buy order was matched (FIFO)
-    Order* b1_order = find_order_by_id(book, "B1");
-    Order* b2_order = find_order_by_id(book, "B2");
+    assert(b1_order != NULL);
+    assert(find_order_by_id(book, "B1") == NULL);
+    assert(find_order_by_id(book, "B2") == b2_order);
     
-    assert(b1_order->filled_quantity == 10);
-    assert(b1_order->status == FILLED);
+    assert(sell_order.status == FILLED);
     assert(b2_order->filled_quantity == 0);
     assert(b2_order->status == OPEN);
     
@@ -209,7 +238,8 @@ void test_price_time_priority() {
     strcpy(buy_order1.id, "B1");
     strcpy(buy_order1.symbol, "TEST");
     buy_order1.side = BUY;
-    buy_order1.price = 99.0;
+    buy_order1.type = LIMIT;
+    buy_order1.price = price_from_double(99.0);
     buy_order1.quantity = 10;
     
     // Add a buy order at a higher price
@@ -217,35 +247,1912 @@ void test_price_time_priority() {
     strcpy(buy_order2.id, "B2");
     strcpy(buy_order2.symbol, "TEST");
     buy_order2.side = BUY;
-    buy_order2.price = 100.0;
+    buy_order2.type = LIMIT;
+    buy_order2.price = price_from_double(100.0);
     buy_order2.quantity = 10;
     
-    add_order(book, &buy_order1);
-    add_order(book, &buy_order2);
+    RestingOrder* b1_order = add_order(book, &buy_order1);
+    RestingOrder* b2_order = add_order(book, &buy_order2);
     
     // Add a sell order that matches
-    Order sell_order;
+    Order sell_order = {0};
     strcpy(sell_order.id, "S1");
     strcpy(sell_order.symbol, "TEST");
     sell_order.side = SELL;
-    sell_order.price = 99.5;
+    sell_order.type = LIMIT;
+    sell_order.price = price_from_double(99.5);
     sell_order.quantity = 10;
     
     add_order(book, &sell_order);
     
     // Check that the higher price buy order was matched (price priority)
-    Order* b1_order = find_order_by_id(book, "B1");
-    Order* b2_order = find_order_by_id(book, "B2");
+    assert(b2_order != NULL);
+    assert(find_order_by_id(book, "B1") == b1_order);
+    assert(find_order_by_id(book, "B2") == NULL);
     
     assert(b1_order->filled_quantity == 0);
     assert(b1_order->status == OPEN);
-    assert(b2_order->filled_quantity == 10);
-    assert(b2_order->status == FILLED);
+    assert(sell_order.status == FILLED);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_price_ladder_recentering() {
+    printf("Testing price ladder recentering... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    
+    // First order centers the bid window around its price
+    Order buy_order1;
+    strcpy(buy_order1.id, "B1");
+    strcpy(buy_order1.symbol, "TEST");
+    buy_order1.side = BUY;
+    buy_order1.type = LIMIT;
+    buy_order1.price = price_from_double(100.0);
+    buy_order1.quantity = 10;
+    add_order(book, &buy_order1);
+    
+    // A price beyond the window edge slides the window over both levels
+    Order buy_order2;
+    strcpy(buy_order2.id, "B2");
+    strcpy(buy_order2.symbol, "TEST");
+    buy_order2.side = BUY;
+    buy_order2.type = LIMIT;
+    buy_order2.price = price_from_double(130.0);
+    buy_order2.quantity = 20;
+    assert(add_order(book, &buy_order2) != NULL);
+    
+    assert(book->bids.level_count == 2);
+    assert(best_price_level(book, BUY)->price == price_from_double(130.0));
+    assert(best_price_level(book, BUY)->total_quantity == 20);
+    assert(ladder_find_level(&book->bids, price_from_double(100.0))->total_quantity == 10);
+    
+    // A span wider than the ladder is rejected
+    Order buy_order3;
+    strcpy(buy_order3.id, "B3");
+    strcpy(buy_order3.symbol, "TEST");
+    buy_order3.side = BUY;
+    buy_order3.type = LIMIT;
+    buy_order3.price = price_from_double(200.0);
+    buy_order3.quantity = 5;
+    assert(add_order(book, &buy_order3) == NULL);
+    assert(book->bids.level_count == 2);
+    
+    // Cancelling the best bid moves the cached best to the next level
+    cancel_order(book, "B2");
+    assert(best_price_level(book, BUY)->price == price_from_double(100.0));
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_level_queue_cancel() {
+    printf("Testing level queue cancel... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    
+    // Three resting buys at the same price
+    const char* ids[] = {"B1", "B2", "B3"};
+    for (int i = 0; i < 3; i++) {
+        Order buy_order = {0};
+        strcpy(buy_order.id, ids[i]);
+        strcpy(buy_order.symbol, "TEST");
+        buy_order.side = BUY;
+        buy_order.type = LIMIT;
+        buy_order.price = price_from_double(100.0);
+        buy_order.quantity = 10;
+        add_order(book, &buy_order);
+    }
+    
+    // Cancel from the middle of the queue
+    cancel_order(book, "B2");
+    PriceLevel* level = best_price_level(book, BUY);
+    assert(level->order_count == 2);
+    assert(level->total_quantity == 20);
+    assert(strcmp(book->pool.info[level->head].id, "B1") == 0);
+    assert(strcmp(book->pool.info[level->tail].id, "B3") == 0);
+    assert(book->pool.orders[level->head].next == level->tail);
+    assert(book->pool.orders[level->tail].prev == level->head);
+    
+    // A sell for 15 fills B1 then B3 in queue order
+    Order sell_order = {0};
+    strcpy(sell_order.id, "S1");
+    strcpy(sell_order.symbol, "TEST");
+    sell_order.side = SELL;
+    sell_order.type = LIMIT;
+    sell_order.price = price_from_double(100.0);
+    sell_order.quantity = 15;
+    add_order(book, &sell_order);
+    
+    assert(find_order_by_id(book, "B1") == NULL);
+    assert(find_order_by_id(book, "B3")->filled_quantity == 5);
+    assert(best_price_level(book, BUY)->order_count == 1);
+    assert(best_price_level(book, BUY)->total_quantity == 5);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_order_index() {
+    printf("Testing order index... ");
+    
+    OrderIndex index;
+    assert(initialize_order_index(&index, 64) == 0);
+    
+    // Insert enough IDs to force collisions and probe runs
+    char id[MAX_ID_LENGTH];
+    for (uint32_t i = 0; i < 64; i++) {
+        snprintf(id, sizeof(id), "ORD%u", i);
+        assert(order_index_insert(&index, id, i) == 0);
+    }
+    assert(index.count == 64);
+    assert(order_index_insert(&index, "ORD7", 99) != 0);  // Duplicate
+    
+    // Remove every other ID and check the rest are still reachable
+    for (uint32_t i = 0; i < 64; i += 2) {
+        snprintf(id, sizeof(id), "ORD%u", i);
+        order_index_remove(&index, id);
+    }
+    for (uint32_t i = 0; i < 64; i++) {
+        snprintf(id, sizeof(id), "ORD%u", i);
+        assert(order_index_find(&index, id) == ((i % 2) ? i : NO_ORDER));
+    }
+    assert(index.count == 32);
+    
+    free_order_index(&index);
+    printf("PASSED\n");
+}
+
+void test_order_pool_reuse() {
+    printf("Testing order pool reuse... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    
+    // Cycle far more orders than the pool holds; slots are recycled
+    for (int i = 0; i < MAX_ORDERS + 1; i++) {
+        Order buy_order = {0};
+        snprintf(buy_order.id, MAX_ID_LENGTH, "B%d", i);
+        strcpy(buy_order.symbol, "TEST");
+        buy_order.side = BUY;
+        buy_order.type = LIMIT;
+        buy_order.price = price_from_double(100.0);
+        buy_order.quantity = 10;
+        assert(add_order(book, &buy_order) != NULL);
+        cancel_order(book, buy_order.id);
+    }
+    assert(book->pool.live_count == 0);
+    
+    // Handles to a released slot go stale once the slot is reused
+    Order first = {0};
+    strcpy(first.id, "H1");
+    strcpy(first.symbol, "TEST");
+    first.side = SELL;
+    first.type = LIMIT;
+    first.price = price_from_double(101.0);
+    first.quantity = 5;
+    RestingOrder* resting = add_order(book, &first);
+    uint32_t slot = order_slot(book, resting);
+    OrderHandle handle = order_pool_handle(&book->pool, slot);
+    assert(order_pool_resolve(&book->pool, handle) == resting);
+    
+    // Matching state is two records per cache line; the rest sits in a parallel array
+    assert(sizeof(RestingOrder) == 32);
+    assert(strcmp(order_info(book, resting)->id, "H1") == 0);
+    Order loaded;
+    load_order(book, slot, &loaded);
+    assert(strcmp(loaded.id, "H1") == 0 && strcmp(loaded.symbol, "TEST") == 0);
+    assert(loaded.side == SELL && loaded.price == first.price && loaded.quantity == 5);
+    
+    cancel_order(book, "H1");
+    assert(order_pool_resolve(&book->pool, handle) == NULL);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_sweep_multiple_levels() {
+    printf("Testing sweep across levels... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    
+    // Asks at 100.00, 100.01 and 100.02, two orders on the first level
+    const char* ids[] = {"S1", "S2", "S3", "S4"};
+    const double prices[] = {100.00, 100.00, 100.01, 100.02};
+    for (int i = 0; i < 4; i++) {
+        Order sell_order = {0};
+        strcpy(sell_order.id, ids[i]);
+        strcpy(sell_order.symbol, "TEST");
+        sell_order.side = SELL;
+        sell_order.type = LIMIT;
+        sell_order.price = price_from_double(prices[i]);
+        sell_order.quantity = 10;
+        add_order(book, &sell_order);
+    }
+    
+    // A buy for 35 up to 100.01 takes both levels it crosses, then rests
+    Order buy_order = {0};
+    strcpy(buy_order.id, "B1");
+    strcpy(buy_order.symbol, "TEST");
+    buy_order.side = BUY;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(100.01);
+    buy_order.quantity = 35;
+    RestingOrder* resting = add_order(book, &buy_order);
+    
+    assert(buy_order.filled_quantity == 30);
+    assert(buy_order.status == PARTIALLY_FILLED);
+    assert(resting != NULL && order_info(book, resting)->price == price_from_double(100.01));
+    assert(best_price_level(book, BUY)->total_quantity == 5);
+    
+    // Only the untouched ask level is left
+    assert(book->asks.level_count == 1);
+    assert(best_price_level(book, SELL)->price == price_from_double(100.02));
+    assert(find_order_by_id(book, "S1") == NULL);
+    assert(find_order_by_id(book, "S3") == NULL);
+    assert(find_order_by_id(book, "S4") != NULL);
+    assert(book->pool.live_count == 2);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+// Rest a limit order for the order type tests
+static void rest_limit(OrderBook* book, const char* id, OrderSide side, Price price, int quantity) {
+    Order order = {0};
+    strcpy(order.id, id);
+    strcpy(order.symbol, book->symbol);
+    order.side = side;
+    order.type = LIMIT;
+    order.price = price;
+    order.quantity = quantity;
+    assert(add_order(book, &order) != NULL);
+}
+
+// Slot of a live order by ID
+static uint32_t slot_of(OrderBook* book, const char* id) {
+    return order_slot(book, find_order_by_id(book, id));
+}
+
+void test_replace_priority() {
+    printf("Testing cancel/replace priority... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    rest_limit(book, "A", BUY, 10000, 10);
+    rest_limit(book, "B", BUY, 10000, 10);
+    rest_limit(book, "C", BUY, 10000, 10);
+    OrderHandle handle = order_pool_handle(&book->pool, slot_of(book, "A"));
+    
+    // A smaller quantity keeps the order's place
+    assert(modify_order(book, "A", 5, 10000) == 0);
+    PriceLevel* level = best_price_level(book, BUY);
+    assert(level->head == slot_of(book, "A") && level->total_quantity == 25);
+    
+    // A larger quantity sends it to the back of the queue, through its handle
+    uint64_t sequence = order_info(book, find_order_by_id(book, "A"))->sequence;
+    assert(modify_order_by_handle(book, handle, 8, 10000) == 0);
+    assert(level->head == slot_of(book, "B") && level->tail == slot_of(book, "A"));
+    assert(level->total_quantity == 28 && order_info(book, find_order_by_id(book, "A"))->sequence > sequence);
+    
+    // A new price requeues it at the back of its new level
+    assert(modify_order(book, "B", 10, 9990) == 0);
+    assert(level->head == slot_of(book, "C") && level->order_count == 2);
+    assert(ladder_find_level(&book->bids, 9990)->head == slot_of(book, "B"));
+    
+    // A price that crosses gets one matching attempt before it would rest
+    rest_limit(book, "S1", SELL, 10010, 10);
+    assert(modify_order(book, "C", 10, 10010) == 0);
+    assert(find_order_by_id(book, "C") == NULL && find_order_by_id(book, "S1") == NULL);
+    assert(book->last_trade_price == 10010 && book->asks.level_count == 0);
+    
+    // Replacing down to the filled quantity or below cancels the rest
+    Order order = {0};
+    strcpy(order.id, "S2");
+    strcpy(order.symbol, book->symbol);
+    order.side = SELL;
+    order.type = IOC;
+    order.price = 10000;
+    order.quantity = 3;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    assert(find_order_by_id(book, "A")->filled_quantity == 3);
+    assert(modify_order(book, "A", 3, 10000) == 0);
+    assert(find_order_by_id(book, "A") == NULL && best_price_level(book, BUY)->price == 9990);
+    assert(modify_order_by_handle(book, handle, 8, 10000) == -1);
+    
+    // Armed stops change where they wait
+    strcpy(order.id, "T1");
+    order.side = BUY;
+    order.type = STOP;
+    order.stop_price = 10500;
+    order.quantity = 5;
+    assert(add_order(book, &order) != NULL);
+    assert(modify_order(book, "T1", 7, 0) == 0);
+    assert(find_order_by_id(book, "T1")->quantity == 7 && book->buy_stops.count == 1);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_zero_quantity_orders() {
+    printf("Testing zero quantity orders... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    Order order = {0};
+    strcpy(order.id, "Z1");
+    strcpy(order.symbol, "TEST");
+    order.side = SELL;
+    order.type = LIMIT;
+    order.price = 10000;
+    order.quantity = 0;
+    assert(add_order(book, &order) == NULL && order.status == CANCELLED);
+    order.quantity = -5;
+    assert(add_order(book, &order) == NULL && book->pool.live_count == 0);
+    assert(book->asks.level_count == 0 && book->counters.rejects == 2);
+    
+    // A buy then rests instead of spinning on the empty sells
+    rest_limit(book, "B1", BUY, 10000, 5);
+    assert(book->counters.trades == 0);
+    
+    // A resting order with nothing open left is retired instead of traded
+    rest_limit(book, "S1", SELL, 10010, 10);
+    rest_limit(book, "S2", SELL, 10010, 5);
+    RestingOrder* spent = find_order_by_id(book, "S1");
+    PriceLevel* level = best_price_level(book, SELL);
+    level->total_quantity -= spent->quantity;
+    level->displayed_quantity -= spent->displayed;
+    spent->quantity = 0;
+    spent->displayed = 0;
+    strcpy(order.id, "B2");
+    order.side = BUY;
+    order.price = 10010;
+    order.quantity = 5;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    assert(find_order_by_id(book, "S1") == NULL && find_order_by_id(book, "S2") == NULL);
+    assert(book->counters.trades == 1 && book->asks.level_count == 0);
+    
+    // Likewise when the auction uncrosses the resting book
+    start_auction(book);
+    rest_limit(book, "S3", SELL, 9990, 5);
+    rest_limit(book, "S4", SELL, 9990, 5);
+    spent = find_order_by_id(book, "S3");
+    level = best_price_level(book, SELL);
+    level->total_quantity -= spent->quantity;
+    level->displayed_quantity -= spent->displayed;
+    spent->quantity = 0;
+    spent->displayed = 0;
+    assert(uncross_auction(book) == 5);
+    assert(find_order_by_id(book, "S3") == NULL && find_order_by_id(book, "S4") == NULL);
+    assert(find_order_by_id(book, "B1") == NULL && book->counters.trades == 2);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_order_types() {
+    printf("Testing market, IOC and FOK orders... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    rest_limit(book, "S1", SELL, 10100, 10);
+    rest_limit(book, "S2", SELL, 10200, 10);
+    rest_limit(book, "S3", SELL, 10300, 10);
+    
+    // FOK beyond the crossing depth is rejected without touching the book
+    Order order = {0};
+    strcpy(order.id, "F1");
+    strcpy(order.symbol, "TEST");
+    order.side = BUY;
+    order.type = FOK;
+    order.price = 10200;
+    order.quantity = 21;
+    assert(add_order(book, &order) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    assert(book->asks.level_count == 3 && book->pool.live_count == 3);
+    assert(find_order_by_id(book, "F1") == NULL);
+    assert(book->counters.rejects == 1 && book->counters.adds == 3);
+    
+    // FOK within the crossing depth fills across levels
+    strcpy(order.id, "F2");
+    order.quantity = 15;
+    assert(add_order(book, &order) == NULL);
+    assert(order.status == FILLED && order.filled_quantity == 15);
+    assert(best_price_level(book, SELL)->price == 10200);
+    assert(best_price_level(book, SELL)->total_quantity == 5);
+    
+    // IOC trades what crosses and never rests
+    strcpy(order.id, "I1");
+    order.type = IOC;
+    order.price = 10200;
+    order.quantity = 8;
+    assert(add_order(book, &order) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 5);
+    assert(best_price_level(book, SELL)->price == 10300);
+    assert(book->bids.level_count == 0);
+    
+    // Market orders ignore the price and cancel whatever the book cannot fill
+    strcpy(order.id, "M1");
+    order.type = MARKET;
+    order.price = 0;
+    order.quantity = 12;
+    assert(add_order(book, &order) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 10);
+    assert(book->asks.level_count == 0 && book->bids.level_count == 0);
+    assert(book->pool.live_count == 0);
+    
+    // A market sell against an empty side trades nothing
+    strcpy(order.id, "M2");
+    order.side = SELL;
+    order.quantity = 1;
+    assert(add_order(book, &order) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    
+    // Order types from CSV, with an empty price for market orders
+    Order parsed;
+    const char* row = "M3,TEST,SELL,,25,market";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0);
+    assert(parsed.type == MARKET && parsed.price == 0 && parsed.quantity == 25);
+    row = "F3,TEST,BUY,101.5,7,FOK ";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0);
+    assert(parsed.type == FOK && parsed.price == 10150 && parsed.quantity == 7);
+    row = "L1,TEST,BUY,101.5,7";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0 && parsed.type == LIMIT);
+    row = "L2,TEST,BUY,,7,limit";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    row = "L3,TEST,BUY,101.5,0";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+static void arm_stop(OrderBook* book, const char* id, OrderSide side, OrderType type,
+                     Price stop_price, Price price, int quantity) {
+    Order order = {0};
+    strcpy(order.id, id);
+    strcpy(order.symbol, book->symbol);
+    order.side = side;
+    order.type = type;
+    order.price = price;
+    order.stop_price = stop_price;
+    order.quantity = quantity;
+    assert(add_order(book, &order) != NULL && order.status == OPEN);
+}
+
+void test_stop_orders() {
+    printf("Testing stop order triggers... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    rest_limit(book, "A1", SELL, 10100, 10);
+    rest_limit(book, "A2", SELL, 10200, 10);
+    
+    // Armed stops stay off the ladders but can be found by ID
+    arm_stop(book, "SL1", BUY, STOP_LIMIT, 10100, 10150, 5);
+    arm_stop(book, "SL2", BUY, STOP_LIMIT, 10100, 10150, 5);
+    arm_stop(book, "S1", BUY, STOP, 10050, 0, 10);
+    arm_stop(book, "S2", SELL, STOP, 9000, 0, 1);
+    assert(book->bids.level_count == 0 && book->asks.level_count == 2);
+    assert(book->buy_stops.count == 3 && book->sell_stops.count == 1);
+    assert(find_order_by_id(book, "S1") != NULL);
+    
+    // A quantity change on an armed stop leaves the levels alone
+    assert(modify_order(book, "S2", 2, 0) == 0);
+    assert(best_price_level(book, SELL)->total_quantity == 10);
+    
+    // One trade at 101.00 fires all three buy stops: the lowest stop price
+    // first, then the equal stops in arrival order. S1 sweeps the rest of
+    // 101.00 and half of 102.00, so the stop-limits rest at 101.50.
+    Order order = {0};
+    strcpy(order.id, "B1");
+    strcpy(order.symbol, "TEST");
+    order.side = BUY;
+    order.type = LIMIT;
+    order.price = 10100;
+    order.quantity = 5;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    assert(book->buy_stops.count == 0 && find_order_by_id(book, "S1") == NULL);
+    assert(best_price_level(book, SELL)->price == 10200);
+    assert(best_price_level(book, SELL)->total_quantity == 5);
+    PriceLevel* level = best_price_level(book, BUY);
+    assert(level->price == 10150 && level->order_count == 2 && level->total_quantity == 10);
+    assert(strcmp(book->pool.info[level->head].id, "SL1") == 0);
+    assert(book->pool.orders[level->head].type == LIMIT);
+    
+    // Cancelling disarms a stop
+    assert(cancel_order(book, "S2") == 0);
+    assert(book->sell_stops.count == 0 && find_order_by_id(book, "S2") == NULL);
+    free_order_book(book);
+    
+    // A long cascade: each sell stop sits at a bid and its trade reaches the
+    // next stop down, so one order unwinds the whole chain in a loop
+    book = create_order_book("TEST");
+    const int chain = 500;
+    char id[MAX_ID_LENGTH];
+    for (int i = 0; i < chain; i++) {
+        snprintf(id, sizeof(id), "B%d", i);
+        rest_limit(book, id, BUY, 10000 - i, 1);
+        snprintf(id, sizeof(id), "S%d", i);
+        arm_stop(book, id, SELL, STOP, 10000 - i, 0, 1);
+    }
+    strcpy(order.id, "HIT");
+    order.side = SELL;
+    order.type = MARKET;
+    order.quantity = 1;
+    add_order(book, &order);
+    assert(order.filled_quantity == 1);
+    assert(book->bids.level_count == 0 && book->sell_stops.count == 0);
+    assert(book->pool.live_count == 0);
+    free_order_book(book);
+    
+    // Stop rows in CSV carry the stop price after the type
+    Order parsed;
+    const char* row = "T1,TEST,BUY,,10,stop,100.50";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0);
+    assert(parsed.type == STOP && parsed.stop_price == 10050 && parsed.price == 0);
+    row = "T2,TEST,SELL,99,10,STOP_LIMIT,99.5";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0);
+    assert(parsed.type == STOP_LIMIT && parsed.stop_price == 9950 && parsed.price == 9900);
+    row = "T3,TEST,SELL,99,10,STOP_LIMIT";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    row = "T4,TEST,SELL,99,10,LIMIT,99.5";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    
+    printf("PASSED\n");
+}
+
+void test_iceberg_orders() {
+    printf("Testing iceberg orders... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    Order iceberg = {0};
+    strcpy(iceberg.id, "IC1");
+    strcpy(iceberg.symbol, "TEST");
+    iceberg.side = SELL;
+    iceberg.type = ICEBERG;
+    iceberg.price = 10000;
+    iceberg.quantity = 100;
+    iceberg.display_quantity = 10;
+    assert(add_order(book, &iceberg) != NULL);
+    rest_limit(book, "L1", SELL, 10000, 5);
+    
+    // Only the peak counts toward displayed depth
+    PriceLevel* level = best_price_level(book, SELL);
+    assert(level->displayed_quantity == 15 && level->total_quantity == 105 && level->order_count == 2);
+    
+    // A spent peak is replenished behind the orders that were waiting
+    Order order = {0};
+    strcpy(order.id, "B1");
+    strcpy(order.symbol, "TEST");
+    order.side = BUY;
+    order.type = LIMIT;
+    order.price = 10000;
+    order.quantity = 12;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    assert(strcmp(book->pool.info[level->head].id, "L1") == 0);
+    assert(level->displayed_quantity == 13 && level->total_quantity == 93);
+    
+    // One sweep keeps refilling the iceberg from the back of the queue
+    strcpy(order.id, "B2");
+    order.quantity = 40;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    RestingOrder* resting = find_order_by_id(book, "IC1");
+    assert(resting->filled_quantity == 47 && resting->displayed == 3);
+    assert(level->order_count == 1 && level->displayed_quantity == 3 && level->total_quantity == 53);
+    
+    // Shrinking the order keeps what is left of the current peak
+    assert(modify_order(book, "IC1", 60, 10000) == 0);
+    assert(level->displayed_quantity == 3 && level->total_quantity == 13);
+    
+    // Hidden quantity is executable, so fill-or-kill counts it
+    strcpy(order.id, "F1");
+    order.type = FOK;
+    order.quantity = 13;
+    assert(add_order(book, &order) == NULL && order.status == FILLED);
+    assert(book->asks.level_count == 0 && book->pool.live_count == 0);
+    
+    // An iceberg needs a peak
+    strcpy(iceberg.id, "IC2");
+    iceberg.display_quantity = 0;
+    assert(add_order(book, &iceberg) == NULL && iceberg.status == CANCELLED);
+    free_order_book(book);
+    
+    // The peak travels as the seventh CSV field and in its own binary frame
+    Order parsed;
+    const char* row = "IC3,TEST,SELL,100,100,iceberg,10";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == 0);
+    assert(parsed.type == ICEBERG && parsed.display_quantity == 10 && parsed.quantity == 100);
+    row = "IC4,TEST,SELL,100,100,iceberg,0";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    row = "IC5,TEST,SELL,100,100,iceberg,101";
+    assert(parse_csv_order(row, row + strlen(row), &parsed) == -1);
+    
+    OrderMessage message = {0};
+    message.type = MSG_NEW_ICEBERG;
+    message.side = SELL;
+    message.order_type = ICEBERG;
+    message.order_id = 7;
+    message.price = 10000;
+    message.quantity = 100;
+    message.display_quantity = 10;
+    uint8_t frame[MSG_MAX_SIZE];
+    size_t size = encode_order_message(&message, frame);
+    OrderMessage decoded;
+    assert(size == MSG_ICEBERG_SIZE && decode_order_message(frame, size, &decoded) == (int)size);
+    assert(decoded.order_type == ICEBERG && decoded.display_quantity == 10);
+    frame[28] = LIMIT;
+    assert(decode_order_message(frame, size, &decoded) == -1);
+    
+    printf("PASSED\n");
+}
+
+static void assert_update(const MarketDataUpdate* update, MarketDataUpdateType type, Price price,
+                          int quantity, const char* order_id) {
+    assert(update->type == type && update->price == price && update->quantity == quantity);
+    assert(order_id == NULL || strcmp(update->order_id, order_id) == 0);
+}
+
+// Submit an order for an owner with a self-trade prevention mode
+static RestingOrder* submit_owned(OrderBook* book, Order* order, const char* id, OrderSide side, OrderType type,
+                                  Price price, int quantity, uint32_t owner, SelfTradeMode stp) {
+    memset(order, 0, sizeof(Order));
+    strcpy(order->id, id);
+    strcpy(order->symbol, book->symbol);
+    order->side = side;
+    order->type = type;
+    order->price = price;
+    order->quantity = quantity;
+    order->owner = owner;
+    order->stp = stp;
+    return add_order(book, order);
+}
+
+void test_self_trade_prevention() {
+    printf("Testing self-trade prevention... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    Order order = {0};
+    
+    // Cancel newest: the incoming order stops at its owner's order, unfilled
+    submit_owned(book, &order, "S1", SELL, LIMIT, 10100, 10, 1, STP_CANCEL_NEWEST);
+    rest_limit(book, "S2", SELL, 10100, 10);
+    assert(submit_owned(book, &order, "B1", BUY, LIMIT, 10100, 15, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    assert(book->bids.level_count == 0 && best_price_level(book, SELL)->total_quantity == 20);
+    
+    // Orders without an owner, or of another owner, trade as usual
+    assert(submit_owned(book, &order, "B2", BUY, IOC, 10100, 1, NO_OWNER, STP_CANCEL_NEWEST) == NULL);
+    assert(order.filled_quantity == 1);
+    assert(submit_owned(book, &order, "B3", BUY, IOC, 10100, 1, 2, STP_CANCEL_NEWEST) == NULL);
+    assert(order.filled_quantity == 1 && find_order_by_id(book, "S1")->filled_quantity == 2);
+    
+    // Cancel oldest: the owner's resting order goes and matching carries on
+    assert(submit_owned(book, &order, "B4", BUY, LIMIT, 10100, 15, 1, STP_CANCEL_OLDEST) != NULL);
+    assert(order.status == PARTIALLY_FILLED && order.filled_quantity == 10);
+    assert(find_order_by_id(book, "S1") == NULL && find_order_by_id(book, "S2") == NULL);
+    assert(best_price_level(book, BUY)->total_quantity == 5 && book->asks.level_count == 0);
+    assert(book->pool.live_count == 1);
+    
+    // Cancel both: the resting order and the incoming remainder
+    assert(submit_owned(book, &order, "S3", SELL, LIMIT, 10000, 8, 1, STP_CANCEL_BOTH) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    assert(find_order_by_id(book, "B4") == NULL && book->pool.live_count == 0);
+    
+    // Decrement: the smaller open quantity comes off both sides without a trade
+    submit_owned(book, &order, "B5", BUY, LIMIT, 9900, 10, 7, STP_CANCEL_NEWEST);
+    assert(submit_owned(book, &order, "S6", SELL, LIMIT, 9900, 4, 7, STP_DECREMENT) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    assert(find_order_by_id(book, "B5")->quantity == 6 && best_price_level(book, BUY)->total_quantity == 6);
+    assert(submit_owned(book, &order, "S7", SELL, LIMIT, 9900, 8, 7, STP_DECREMENT) != NULL);
+    assert(find_order_by_id(book, "B5") == NULL && find_order_by_id(book, "S7")->quantity == 2);
+    assert(book->bids.level_count == 0 && best_price_level(book, SELL)->price == 9900);
+    
+    // A decremented iceberg shows no more than it has left
+    Order iceberg;
+    memset(&iceberg, 0, sizeof(iceberg));
+    strcpy(iceberg.id, "B6");
+    strcpy(iceberg.symbol, "TEST");
+    iceberg.side = BUY;
+    iceberg.type = ICEBERG;
+    iceberg.price = 9800;
+    iceberg.quantity = 12;
+    iceberg.display_quantity = 5;
+    iceberg.owner = 9;
+    assert(add_order(book, &iceberg) != NULL);
+    assert(submit_owned(book, &order, "S8", SELL, IOC, 9800, 9, 9, STP_DECREMENT) == NULL);
+    assert(order.filled_quantity == 0 && order.status == CANCELLED);
+    PriceLevel* level = best_price_level(book, BUY);
+    assert(level->total_quantity == 3 && level->displayed_quantity == 3);
+    
+    // Fill-or-kill counts only what it can take without meeting its owner
+    rest_limit(book, "B7", BUY, 9800, 4);
+    assert(submit_owned(book, &order, "F1", SELL, FOK, 9800, 4, 9, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    assert(best_price_level(book, BUY)->total_quantity == 7);
+    assert(submit_owned(book, &order, "F2", SELL, FOK, 9800, 5, 9, STP_CANCEL_OLDEST) == NULL);
+    assert(order.status == CANCELLED && best_price_level(book, BUY)->total_quantity == 7);
+    assert(submit_owned(book, &order, "F3", SELL, FOK, 9800, 4, 9, STP_CANCEL_OLDEST) == NULL);
+    assert(order.status == FILLED && order.filled_quantity == 4);
+    assert(book->bids.level_count == 0);
+    
+    // Modes parse by name
+    SelfTradeMode mode;
+    assert(parse_stp_mode("decrement", 9, &mode) == 0 && mode == STP_DECREMENT);
+    assert(parse_stp_mode("Cancel_Oldest", 13, &mode) == 0 && mode == STP_CANCEL_OLDEST);
+    assert(parse_stp_mode("oldest", 6, &mode) == -1);
+    assert(strcmp(stp_mode_to_string(STP_CANCEL_BOTH), "CANCEL_BOTH") == 0);
+    
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_risk_gate() {
+    printf("Testing risk gate... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    RiskGate* gate = create_risk_gate(8, NULL);
+    assert(gate != NULL);
+    book->risk_gate = gate;
+    
+    RiskLimits limits = {0};
+    limits.max_quantity = 100;
+    limits.max_notional = 10000 * 50;
+    limits.collar = 200;
+    limits.max_open_orders = 2;
+    assert(risk_set_limits(gate, 1, &limits) == 0);
+    RiskLimits rate_limits = {0};
+    rate_limits.rate = 10;
+    rate_limits.burst = 2;
+    assert(risk_set_limits(gate, 2, &rate_limits) == 0);
+    assert(risk_set_limits(gate, 8, &limits) == -1);
+    
+    // Each rule turns an order away before it reaches the book
+    Order order = {0};
+    assert(submit_owned(book, &order, "U1", BUY, LIMIT, 10000, 10, 9, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == REJECTED && gate->last_rule == RISK_UNKNOWN_ACCOUNT);
+    assert(submit_owned(book, &order, "Q1", BUY, LIMIT, 10000, 0, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == REJECTED && gate->last_rule == RISK_BAD_QUANTITY);
+    assert(submit_owned(book, &order, "P1", BUY, LIMIT, 0, 10, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_BAD_PRICE);
+    assert(submit_owned(book, &order, "Q2", BUY, LIMIT, 10000, 101, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_MAX_QUANTITY);
+    assert(submit_owned(book, &order, "N1", BUY, LIMIT, 10000, 60, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_MAX_NOTIONAL);
+    assert(book->bids.level_count == 0 && book->pool.live_count == 0);
+    
+    // Before any trade the collar is measured from the BBO
+    assert(submit_owned(book, &order, "A1", BUY, LIMIT, 10000, 10, 1, STP_CANCEL_NEWEST) != NULL);
+    assert(submit_owned(book, &order, "C1", SELL, LIMIT, 10300, 10, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_PRICE_COLLAR);
+    assert(submit_owned(book, &order, "A2", SELL, LIMIT, 10100, 10, 1, STP_CANCEL_NEWEST) != NULL);
+    assert(gate->accounts[1].open_orders == 2);
+    assert(submit_owned(book, &order, "O1", BUY, LIMIT, 9990, 1, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_MAX_OPEN_ORDERS);
     
+    // Cancels and fills give open orders back; the collar follows the last trade
+    assert(cancel_order(book, "A1") == 0);
+    assert(submit_owned(book, &order, "X1", BUY, IOC, 10100, 10, 3, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == FILLED && book->last_trade_price == 10100);
+    assert(gate->accounts[1].open_orders == 0 && gate->accounts[3].open_orders == 0);
+    assert(submit_owned(book, &order, "C2", SELL, LIMIT, 10350, 1, 1, STP_CANCEL_NEWEST) == NULL);
+    assert(gate->last_rule == RISK_PRICE_COLLAR);
+    assert(submit_owned(book, &order, "A3", SELL, LIMIT, 10300, 1, 1, STP_CANCEL_NEWEST) != NULL);
+    
+    // Ten orders a second with a burst of two, on the event clock
+    stamp_next_event(book, 1001, 1000000000ULL);
+    assert(submit_owned(book, &order, "R1", BUY, IOC, 9000, 1, 2, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == CANCELLED);
+    stamp_next_event(book, 1002, 1000000000ULL);
+    submit_owned(book, &order, "R2", BUY, IOC, 9000, 1, 2, STP_CANCEL_NEWEST);
+    assert(order.status == CANCELLED);
+    stamp_next_event(book, 1003, 1000000000ULL);
+    submit_owned(book, &order, "R3", BUY, IOC, 9000, 1, 2, STP_CANCEL_NEWEST);
+    assert(order.status == REJECTED && gate->last_rule == RISK_MESSAGE_RATE);
+    stamp_next_event(book, 1004, 1100000000ULL);
+    submit_owned(book, &order, "R4", BUY, IOC, 9000, 1, 2, STP_CANCEL_NEWEST);
+    assert(order.status == CANCELLED);
+    
+    // Outcomes are counted per rule and rejections per account
+    assert(gate->counts[RISK_PRICE_COLLAR] == 2 && gate->counts[RISK_MESSAGE_RATE] == 1);
+    assert(gate->counts[RISK_ACCEPTED] == 7 && gate->accounts[1].rejected == 7);
+    assert(strcmp(risk_rule_to_string(RISK_MAX_OPEN_ORDERS), "max open orders") == 0);
+    
+    // A gate attached to a filled book counts the orders already there
+    RiskGate* late_gate = create_risk_gate(8, NULL);
+    risk_count_open_orders(late_gate, book);
+    assert(late_gate->accounts[1].open_orders == 1);
+    
+    // Modifies that raise the quantity or move the price are checked too
+    assert(modify_order(book, "A3", 101, 10300) == -1 && gate->last_rule == RISK_MAX_QUANTITY);
+    assert(modify_order(book, "A3", 1, 10350) == -1 && gate->last_rule == RISK_PRICE_COLLAR);
+    assert(modify_order(book, "A3", 1, 0) == -1 && gate->last_rule == RISK_BAD_PRICE);
+    assert(find_order_by_id(book, "A3")->quantity == 1 && book->counters.rejects > 0);
+    assert(modify_order(book, "A3", 40, 10300) == 0 && find_order_by_id(book, "A3")->quantity == 40);
+    uint64_t accepted = gate->counts[RISK_ACCEPTED];
+    assert(modify_order(book, "A3", 5, 10300) == 0 && gate->counts[RISK_ACCEPTED] == accepted);
+    assert(modify_order(book, "A3", 0, 0) == 0 && find_order_by_id(book, "A3") == NULL);
+    
+    free_risk_gate(late_gate);
+    free_risk_gate(gate);
+    free_order_book(book);
+    printf("PASSED\n");
+}
+
+void test_call_auction() {
+    printf("Testing call auction... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    MarketDataFeed* feed = create_market_data_feed(NULL, 0, false, 0);
+    book->market_data = feed;
+    assert(uncross_auction(book) == -1);
+    
+    // During the call orders rest across the spread; anything that may not rest is cancelled
+    start_auction(book);
+    assert(book->auction.call_phase && feed->updates[feed->update_count - 1].type == MD_AUCTION_INDICATIVE);
+    rest_limit(book, "B1", BUY, 10100, 10);
+    rest_limit(book, "S1", SELL, 9950, 15);
+    assert(book->auction.indicative_price != 0 && book->auction.matched_quantity == 10);
+    rest_limit(book, "B2", BUY, 10050, 20);
+    rest_limit(book, "B3", BUY, 10000, 10);
+    rest_limit(book, "S2", SELL, 10000, 10);
+    const MarketDataUpdate* update = &feed->updates[feed->update_count - 1];
+    assert(update->type == MD_AUCTION_INDICATIVE && update->price == 10025);
+    assert(update->quantity == 25 && update->order_count == 5 && update->side == BUY);
+    
+    // Orders that leave the indicative uncross as it was publish only their level
+    rest_limit(book, "S3", SELL, 10080, 30);
+    assert(feed->updates[feed->update_count - 1].type == MD_LEVEL_ADD);
+    Order order = {0};
+    assert(submit_owned(book, &order, "X1", BUY, IOC, 10100, 5, NO_OWNER, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == CANCELLED && order.filled_quantity == 0);
+    
+    // 25 can trade from 10000 to 10050; above 10000 only 5 buys are left over,
+    // and the middle of the range breaks the tie before any trade
+    assert(book->auction.indicative_price == 10025);
+    assert(book->auction.matched_quantity == 25 && book->auction.imbalance == 5);
+    Price price;
+    int matched;
+    int imbalance;
+    auction_equilibrium(book, &price, &matched, &imbalance);
+    assert(price == 10025 && matched == 25 && imbalance == 5);
+    
+    // Everything trades at the one price, best prices and earliest orders first
+    assert(uncross_auction(book) == 25);
+    assert(!book->auction.call_phase && book->last_trade_price == 10025);
+    assert(find_order_by_id(book, "B1") == NULL && find_order_by_id(book, "S1") == NULL);
+    assert(find_order_by_id(book, "S2") == NULL && find_order_by_id(book, "B2")->filled_quantity == 15);
+    assert(best_price_level(book, BUY)->price == 10050 && best_price_level(book, SELL)->price == 10080);
+    update = &feed->updates[feed->update_count - 1];
+    assert(update->type == MD_AUCTION_UNCROSS && update->price == 10025 && update->quantity == 25);
+    
+    // Matching is continuous again
+    assert(submit_owned(book, &order, "B4", BUY, IOC, 10080, 5, NO_OWNER, STP_CANCEL_NEWEST) == NULL);
+    assert(order.status == FILLED);
+    
+    // With equal quantity and imbalance the price nearest the last trade (10080) wins
+    start_auction(book);
+    assert(book->auction.indicative_price == 0);
+    rest_limit(book, "S4", SELL, 10040, 5);
+    assert(book->auction.indicative_price == 10050 && book->auction.imbalance == 0);
+    assert(uncross_auction(book) == 5);
+    assert(find_order_by_id(book, "B2") == NULL && book->last_trade_price == 10050);
+    
+    // A call on a book that never crosses ends without trades
+    start_auction(book);
+    assert(uncross_auction(book) == 0 && book->auction.indicative_price == 0);
+    
+    free_order_book(book);
+    free_market_data_feed(feed);
+    printf("PASSED\n");
+}
+
+void test_market_data() {
+    printf("Testing market data feed... ");
+    
+    // Full depth with order-level updates, written to a sink
+    FILE* sink = tmpfile();
+    MarketDataFeed* feed = create_market_data_feed(sink, 0, true, 0);
+    OrderBook* book = create_order_book("TEST");
+    book->market_data = feed;
+    
+    rest_limit(book, "S1", SELL, 10100, 10);
+    assert(feed->update_count == 2);
+    assert_update(&feed->updates[0], MD_ORDER_ADD, 10100, 10, "S1");
+    assert_update(&feed->updates[1], MD_LEVEL_ADD, 10100, 10, NULL);
+    rest_limit(book, "S2", SELL, 10100, 5);
+    assert(feed->update_count == 2);
+    assert_update(&feed->updates[1], MD_LEVEL_UPDATE, 10100, 15, NULL);
+    assert(feed->updates[1].order_count == 2);
+    
+    // A trade touching two orders publishes the level once
+    Order order = {0};
+    strcpy(order.id, "B1");
+    strcpy(order.symbol, "TEST");
+    order.side = BUY;
+    order.type = LIMIT;
+    order.price = 10100;
+    order.quantity = 12;
+    assert(add_order(book, &order) == NULL);
+    assert(feed->update_count == 3);
+    assert_update(&feed->updates[0], MD_ORDER_DELETE, 10100, 0, "S1");
+    assert_update(&feed->updates[1], MD_ORDER_MODIFY, 10100, 3, "S2");
+    assert_update(&feed->updates[2], MD_LEVEL_UPDATE, 10100, 3, NULL);
+    
+    assert(cancel_order(book, "S2") == 0);
+    assert(feed->update_count == 2);
+    assert_update(&feed->updates[1], MD_LEVEL_DELETE, 10100, 0, NULL);
+    assert(feed->updates[1].sequence == 9 && feed->next_sequence == 10);
+    assert(ftell(sink) == (long)(9 * sizeof(MarketDataUpdate)));
+    free_order_book(book);
+    free_market_data_feed(feed);
+    fclose(sink);
+    
+    // Top two levels only: levels cross the view boundary as the top changes
+    feed = create_market_data_feed(NULL, 2, false, 0);
+    book = create_order_book("TEST");
+    book->market_data = feed;
+    rest_limit(book, "B100", BUY, 10000, 1);
+    rest_limit(book, "B99", BUY, 9900, 2);
+    assert(feed->update_count == 1);
+    assert_update(&feed->updates[0], MD_LEVEL_ADD, 9900, 2, NULL);
+    rest_limit(book, "B98", BUY, 9800, 3);
+    assert(feed->update_count == 0);
+    
+    assert(cancel_order(book, "B100") == 0);
+    assert(feed->update_count == 2);
+    assert_update(&feed->updates[0], MD_LEVEL_DELETE, 10000, 0, NULL);
+    assert_update(&feed->updates[1], MD_LEVEL_ADD, 9800, 3, NULL);
+    
+    rest_limit(book, "B101", BUY, 10100, 4);
+    assert(feed->update_count == 2);
+    assert_update(&feed->updates[0], MD_LEVEL_DELETE, 9800, 0, NULL);
+    assert_update(&feed->updates[1], MD_LEVEL_ADD, 10100, 4, NULL);
+    
+    // Activity below the view publishes nothing
+    rest_limit(book, "B90", BUY, 9000, 5);
+    assert(cancel_order(book, "B98") == 0);
+    assert(feed->update_count == 0);
+    
+    // A snapshot republishes the view between markers
+    assert(market_data_snapshot(feed, book) == 4);
+    assert(feed->updates[0].type == MD_SNAPSHOT_BEGIN && feed->updates[3].type == MD_SNAPSHOT_END);
+    assert_update(&feed->updates[1], MD_LEVEL_ADD, 10100, 4, NULL);
+    assert_update(&feed->updates[2], MD_LEVEL_ADD, 9900, 2, NULL);
+    free_order_book(book);
+    free_market_data_feed(feed);
+    
+    printf("PASSED\n");
+}
+
+//Reader thread state for the quote view test
+typedef struct {
+    QuoteView* view;
+    int done;
+    long reads;
+    bool torn;
+} QuoteReader;
+
+// Read the view until told to stop, checking every copy is self-consistent;
+// at least one read is made however late the thread is scheduled
+static void* read_quotes(void* arg) {
+    QuoteReader* reader = arg;
+    uint64_t last_version = 0;
+    do {
+        BookQuote quote;
+        uint64_t version = read_quote_view(reader->view, &quote);
+        // The writer adds a bid of 10 and then an ask of 10 at one price each
+        if (version < last_version || quote.bid_count != 1 ||
+            quote.bids[0].quantity != 10 * quote.bids[0].order_count ||
+            (quote.ask_count == 1 && quote.asks[0].quantity != 10 * quote.asks[0].order_count) ||
+            quote.bids[0].order_count - (quote.ask_count ? quote.asks[0].order_count : 0) > 1 ||
+            quote.bids[0].order_count - (quote.ask_count ? quote.asks[0].order_count : 0) < 0) {
+            reader->torn = true;
+        }
+        last_version = version;
+        reader->reads++;
+    } while (!__atomic_load_n(&reader->done, __ATOMIC_ACQUIRE));
+    return NULL;
+}
+
+void test_quote_view() {
+    printf("Testing quote view... ");
+    
+    OrderBook* book = create_order_book_with_capacity("TEST", 20000, 1024);
+    rest_limit(book, "B100", BUY, 10000, 1);
+    QuoteView* view = create_quote_view(2);
+    attach_quote_view(book, view);
+    BookQuote quote;
+    assert(read_quote_view(view, &quote) == 1);
+    assert(quote.bid_count == 1 && quote.ask_count == 0);
+    assert(quote.bids[0].price == 10000 && quote.bids[0].quantity == 1 && quote.bids[0].order_count == 1);
+    
+    // Best first, limited to the view depth
+    rest_limit(book, "B99", BUY, 9900, 2);
+    rest_limit(book, "B101", BUY, 10100, 3);
+    rest_limit(book, "S102", SELL, 10200, 4);
+    assert(read_quote_view(view, &quote) == 4);
+    assert(quote.bid_count == 2 && quote.bids[0].price == 10100 && quote.bids[1].price == 10000);
+    assert(quote.ask_count == 1 && quote.asks[0].quantity == 4);
+    
+    // Changes behind the top levels leave the view and its version alone
+    assert(cancel_order(book, "B99") == 0);
+    assert(read_quote_view(view, &quote) == 4);
+    free_order_book(book);
+    free_quote_view(view);
+    
+    // A reader on another thread only ever sees whole events
+    book = create_order_book_with_capacity("TEST", 20000, 1024);
+    view = create_quote_view(1);
+    rest_limit(book, "B0", BUY, 10000, 10);
+    rest_limit(book, "S0", SELL, 10100, 10);
+    attach_quote_view(book, view);
+    QuoteReader reader = {view, 0, 0, false};
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, read_quotes, &reader) == 0);
+    char id[MAX_ID_LENGTH];
+    for (int i = 1; i < 5000; i++) {
+        snprintf(id, sizeof(id), "B%d", i);
+        rest_limit(book, id, BUY, 10000, 10);
+        snprintf(id, sizeof(id), "S%d", i);
+        rest_limit(book, id, SELL, 10100, 10);
+    }
+    __atomic_store_n(&reader.done, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    assert(!reader.torn);
+    assert(read_quote_view(view, &quote) == 1 + 2 * 4999);
+    free_order_book(book);
+    free_quote_view(view);
+    
+    printf("PASSED\n");
+}
+
+void test_exec_report_ring() {
+    printf("Testing execution report ring... ");
+    
+    OrderBook* book = create_order_book("TEST");
+    FILE* sink = tmpfile();
+    ExecRing* ring = create_exec_ring(4, sink, EXEC_FORMAT_BINARY);
+    book->exec_ring = ring;
+    
+    // Six resting asks, swept by one buy: more trades than the ring holds
+    for (int i = 0; i < 6; i++) {
+        Order sell_order = {0};
+        snprintf(sell_order.id, MAX_ID_LENGTH, "S%d", i);
+        strcpy(sell_order.symbol, "TEST");
+        sell_order.side = SELL;
+        sell_order.type = LIMIT;
+        sell_order.price = price_from_double(100.0) + i;
+        sell_order.quantity = 10;
+        add_order(book, &sell_order);
+    }
+    
+    Order buy_order = {0};
+    strcpy(buy_order.id, "B1");
+    strcpy(buy_order.symbol, "TEST");
+    buy_order.side = BUY;
+    buy_order.type = LIMIT;
+    buy_order.price = price_from_double(101.0);
+    buy_order.quantity = 60;
+    add_order(book, &buy_order);
+    exec_ring_flush(ring);
+    
+    // Records come back in order with increasing sequence numbers
+    rewind(sink);
+    ExecReport report;
+    for (int i = 0; i < 6; i++) {
+        assert(fread(&report, sizeof(report), 1, sink) == 1);
+        assert(report.sequence == (uint64_t)i + 1);
+        assert(report.price == price_from_double(100.0) + i);
+        assert(report.quantity == 10);
+        assert(report.aggressor_side == BUY);
+        assert(strcmp(report.aggressor_id, "B1") == 0);
+        char resting_id[MAX_ID_LENGTH];
+        snprintf(resting_id, sizeof(resting_id), "S%d", i);
+        assert(strcmp(report.resting_id, resting_id) == 0);
+    }
+    assert(fread(&report, sizeof(report), 1, sink) == 0);
+    
+    // Text lines carry every field of the binary record
+    FILE* text_sink = tmpfile();
+    ExecReport text_report = {0};
+    text_report.sequence = 7;
+    text_report.event_sequence = 42;
+    text_report.timestamp_ns = 123456789;
+    text_report.price = price_from_double(100.5);
+    text_report.quantity = 25;
+    text_report.aggressor_side = SELL;
+    strcpy(text_report.aggressor_id, "S9");
+    strcpy(text_report.resting_id, "B3");
+    strcpy(text_report.symbol, "TEST");
+    print_exec_report(text_sink, &text_report);
+    rewind(text_sink);
+    char line[160];
+    assert(fgets(line, sizeof(line), text_sink) != NULL);
+    assert(strcmp(line, "TRADE #7: TEST @ 100.50, Qty: 25, Aggressor: S9 (SELL), Resting: B3, Event: 42, "
+                        "Time: 123456789\n") == 0);
+    fclose(text_sink);
+    
+    free_exec_ring(ring);
+    fclose(sink);
     free_order_book(book);
     printf("PASSED\n");
 }
 
+void test_event_sequencing() {
+    printf("Testing event sequencing... ");
+    
+    calibrate_event_clock();
+    uint64_t before = event_clock_ns();
+    OrderBook* aapl = create_order_book("AAPL");
+    OrderBook* msft = create_order_book("MSFT");
+    FILE* sink = tmpfile();
+    ExecRing* ring = create_exec_ring(16, sink, EXEC_FORMAT_BINARY);
+    msft->exec_ring = ring;
+    
+    // Every command on any book takes the next global number
+    rest_limit(aapl, "A1", BUY, 10000, 5);
+    rest_limit(msft, "M1", SELL, 20000, 5);
+    rest_limit(aapl, "A2", BUY, 10000, 5);
+    const OrderInfo* a1 = order_info(aapl, find_order_by_id(aapl, "A1"));
+    const OrderInfo* m1 = order_info(msft, find_order_by_id(msft, "M1"));
+    const OrderInfo* a2 = order_info(aapl, find_order_by_id(aapl, "A2"));
+    assert(m1->sequence == a1->sequence + 1 && a2->sequence == m1->sequence + 1);
+    assert(a1->timestamp_ns >= before && a2->timestamp_ns >= a1->timestamp_ns);
+    assert(peek_event_sequence() == a2->sequence + 1);
+    
+    // A failed cancel is still an event
+    assert(cancel_order(aapl, "NONE") == -1);
+    assert(peek_event_sequence() == a2->sequence + 2);
+    
+    // An upstream stamp is used once, and trades carry their command's number
+    stamp_next_event(msft, 5000, before);
+    Order order = {0};
+    strcpy(order.id, "M2");
+    strcpy(order.symbol, "MSFT");
+    order.side = BUY;
+    order.type = IOC;
+    order.price = 20000;
+    order.quantity = 2;
+    assert(add_order(msft, &order) == NULL);
+    assert(order.sequence == 5000 && order.timestamp_ns == before);
+    exec_ring_flush(ring);
+    ExecReport report;
+    rewind(sink);
+    assert(fread(&report, sizeof(report), 1, sink) == 1);
+    assert(report.event_sequence == 5000 && report.timestamp_ns >= before);
+    rest_limit(msft, "M3", SELL, 20100, 1);
+    assert(order_info(msft, find_order_by_id(msft, "M3"))->sequence == a2->sequence + 2);
+    
+    // Restored history moves the counter forward, never back
+    advance_event_sequence(100);
+    assert(peek_event_sequence() >= a2->sequence + 3);
+    uint64_t next = peek_event_sequence() + 1000;
+    advance_event_sequence(next);
+    assert(next_event_sequence() == next);
+    
+    free_order_book(aapl);
+    free_order_book(msft);
+    free_exec_ring(ring);
+    fclose(sink);
+    printf("PASSED\n");
+}
+
+void test_exec_report_consumer_thread() {
+    printf("Testing execution report consumer thread... ");
+    
+    FILE* sink = tmpfile();
+    ExecRing* ring = create_exec_ring(64, sink, EXEC_FORMAT_BINARY);
+    assert(exec_ring_start_consumer(ring) == 0);
+    
+    // The producer outruns a small ring and waits on the consumer
+    for (int i = 0; i < 10000; i++) {
+        ExecReport* report = exec_ring_claim(ring);
+        memset(report->aggressor_id, 0, MAX_ID_LENGTH);
+        memset(report->resting_id, 0, MAX_ID_LENGTH);
+        memset(report->symbol, 0, MAX_SYMBOL_LENGTH);
+        report->price = i;
+        report->quantity = 1;
+        exec_ring_commit(ring);
+    }
+    free_exec_ring(ring);
+    
+    rewind(sink);
+    ExecReport report;
+    for (int i = 0; i < 10000; i++) {
+        assert(fread(&report, sizeof(report), 1, sink) == 1);
+        assert(report.price == i);
+    }
+    fclose(sink);
+    printf("PASSED\n");
+}
+
+void test_symbol_registry() {
+    printf("Testing symbol registry... ");
+    
+    SymbolRegistry* registry = create_symbol_registry(8, 64, 256);
+    assert(registry != NULL);
+    
+    // Orders are routed by symbol and books are created on first use
+    const char* symbols[] = {"AAPL", "MSFT", "AAPL", "GOOG"};
+    for (int i = 0; i < 4; i++) {
+        Order buy_order = {0};
+        snprintf(buy_order.id, MAX_ID_LENGTH, "B%d", i);
+        strcpy(buy_order.symbol, symbols[i]);
+        buy_order.side = BUY;
+        buy_order.type = LIMIT;
+        buy_order.price = price_from_double(100.0);
+        buy_order.quantity = 10;
+        assert(registry_add_order(registry, &buy_order) != NULL);
+    }
+    assert(registry->book_count == 3);
+    assert(registry_symbol_index(registry, "AAPL") == 0);
+    assert(registry_symbol_index(registry, "GOOG") == 2);
+    assert(registry_symbol_index(registry, "TSLA") == -1);
+    
+    OrderBook* aapl = registry_find_book(registry, "AAPL");
+    assert(strcmp(aapl->symbol, "AAPL") == 0);
+    assert(aapl->pool.capacity == 64);
+    assert(best_price_level(aapl, BUY)->total_quantity == 20);
+    assert(find_order_by_id(aapl, "B1") == NULL);
+    
+    // Cancels reach only the named book
+    registry_cancel_order(registry, "MSFT", "B1");
+    assert(registry_find_book(registry, "MSFT")->bids.level_count == 0);
+    assert(best_price_level(aapl, BUY)->total_quantity == 20);
+    
+    free_symbol_registry(registry);
+    printf("PASSED\n");
+}
+
+void test_sharded_engine() {
+    printf("Testing sharded engine... ");
+    
+    Engine* engine = create_engine(4, -1, NULL, EXEC_FORMAT_TEXT, NULL);
+    SymbolRegistry* reference = create_symbol_registry(MAX_SYMBOLS, ORDERS_PER_BOOK, LADDER_SIZE_PER_BOOK);
+    assert(engine != NULL && reference != NULL);
+    assert(engine->workers[0].stats == NULL && engine->workers[0].registry->stats == NULL);
+    assert(engine_start(engine) == 0);
+    
+    // Same flow through the engine and through one single-threaded registry
+    char symbol[MAX_SYMBOL_LENGTH];
+    for (int round = 0; round < 100; round++) {
+        for (unsigned i = 0; i < 64; i++) {
+            snprintf(symbol, sizeof(symbol), "S%u", i);
+            Order order = {0};
+            strcpy(order.symbol, symbol);
+            
+            snprintf(order.id, MAX_ID_LENGTH, "B%d", round);
+            order.side = BUY;
+            order.type = LIMIT;
+            order.price = price_from_double(100.0) - (round % 3);
+            order.quantity = 10;
+            engine_submit_order(engine, &order);
+            registry_add_order(reference, &order);
+            
+            snprintf(order.id, MAX_ID_LENGTH, "S%d", round);
+            order.side = SELL;
+            order.type = LIMIT;
+            order.price = price_from_double(100.0) - 2;
+            order.quantity = 4 + i % 5;
+            engine_submit_order(engine, &order);
+            registry_add_order(reference, &order);
+            
+            if (round % 2 == 1) {
+                snprintf(order.id, MAX_ID_LENGTH, "B%d", round - 1);
+                engine_submit_cancel(engine, symbol, order.id);
+                registry_cancel_order(reference, symbol, order.id);
+            }
+        }
+    }
+    engine_drain(engine);
+    engine_stop(engine);
+    
+    // Each worker owns a disjoint set of books, all matching the reference
+    uint32_t books = 0;
+    for (uint32_t w = 0; w < engine->worker_count; w++) {
+        books += engine->workers[w].registry->book_count;
+    }
+    assert(books == 64);
+    for (unsigned i = 0; i < 64; i++) {
+        snprintf(symbol, sizeof(symbol), "S%u", i);
+        OrderBook* book = engine_find_book(engine, symbol);
+        OrderBook* expected = registry_find_book(reference, symbol);
+        assert(book != NULL);
+        assert(book->pool.live_count == expected->pool.live_count);
+        assert(book->bids.level_count == expected->bids.level_count);
+        assert(book->asks.level_count == expected->asks.level_count);
+        assert(best_price_level(book, BUY)->total_quantity == best_price_level(expected, BUY)->total_quantity);
+        assert(best_price_level(book, BUY)->order_count == best_price_level(expected, BUY)->order_count);
+    }
+    
+    free_symbol_registry(reference);
+    free_engine(engine);
+    printf("PASSED\n");
+}
+
+void test_bulk_csv_loader() {
+    printf("Testing bulk CSV loader... ");
+    
+    // Prices go straight to ticks, rounding half up past the tick size
+    const char* prices[] = {"150", "150.5", "150.25", "150.255", "0.004", ".5", "1e3", "", "12.3.4"};
+    Price expected[] = {15000, 15050, 15025, 15026, 0, 50};
+    for (int i = 0; i < 9; i++) {
+        Price price;
+        int result = parse_price_ticks(prices[i], prices[i] + strlen(prices[i]), &price);
+        if (i < 6) {
+            assert(result == 0 && price == expected[i]);
+        } else {
+            assert(result == -1);
+        }
+    }
+    
+    // CRLF endings, blank lines, bad rows and no final newline
+    const char* filename = "bulk_loader_test.csv";
+    FILE* file = fopen(filename, "w");
+    assert(file != NULL);
+    fprintf(file, "ID,Symbol,Side,Price,Quantity\r\n");
+    fprintf(file, "B1,AAPL,buy,150.25,100\r\n");
+    fprintf(file, "\r\n");
+    fprintf(file, "THIS_ID_IS_FAR_TOO_LONG,AAPL,BUY,150.25,100\n");
+    fprintf(file, "S1,AAPL,SELL,150.30,40\n");
+    fprintf(file, "B2,MSFT,BUY,abc,10\n");
+    fprintf(file, "B3,MSFT,BUY,300,10,extra\n");
+    for (int i = 0; i < CSV_BATCH_SIZE + 10; i++) {
+        fprintf(file, "M%d,MSFT,%s,%d.%02d,1\n", i, (i % 2) ? "SELL" : "BUY", (i % 2) ? 301 : 299, i % 100);
+    }
+    fprintf(file, "S2,AAPL,SELL,150.25,30");
+    fclose(file);
+    
+    SymbolRegistry* registry = create_symbol_registry(16, 4096, 1024);
+    assert(load_orders_from_csv(registry, filename) == 0);
+    remove(filename);
+    
+    OrderBook* aapl = registry_find_book(registry, "AAPL");
+    assert(aapl != NULL);
+    assert(aapl->pool.live_count == 2);
+    assert(best_price_level(aapl, BUY)->total_quantity == 70);
+    assert(best_price_level(aapl, SELL)->price == 15030);
+    assert(find_order_by_id(aapl, "S2") == NULL);
+    
+    OrderBook* msft = registry_find_book(registry, "MSFT");
+    assert(msft != NULL);
+    assert(msft->pool.live_count == CSV_BATCH_SIZE + 10);
+    assert(best_price_level(msft, BUY)->price == 29998);
+    assert(best_price_level(msft, SELL)->price == 30101);
+    
+    assert(load_orders_from_csv(registry, "missing_orders.csv") == -1);
+    
+    // A saved book loads back with each order's remaining quantity and peak
+    Order iceberg = {0};
+    strcpy(iceberg.id, "I1");
+    strcpy(iceberg.symbol, "AAPL");
+    iceberg.side = SELL;
+    iceberg.type = ICEBERG;
+    iceberg.price = 15030;
+    iceberg.quantity = 50;
+    iceberg.display_quantity = 20;
+    assert(add_order(aapl, &iceberg) != NULL);
+    assert(save_orders_to_csv(aapl, filename) == 0);
+    SymbolRegistry* reloaded = create_symbol_registry(16, 64, 1024);
+    assert(load_orders_from_csv(reloaded, filename) == 0);
+    remove(filename);
+    OrderBook* copy = registry_find_book(reloaded, "AAPL");
+    assert(copy != NULL && copy->pool.live_count == 3);
+    assert(find_order_by_id(copy, "B1")->quantity == 70 && find_order_by_id(copy, "B1")->filled_quantity == 0);
+    assert(best_price_level(copy, SELL)->total_quantity == 90 && best_price_level(copy, SELL)->displayed_quantity == 60);
+    assert(strcmp(copy->pool.info[best_price_level(copy, SELL)->head].id, "S1") == 0);
+    assert(find_order_by_id(copy, "I1")->type == ICEBERG);
+    free_symbol_registry(reloaded);
+    free_symbol_registry(registry);
+    printf("PASSED\n");
+}
+
+void test_binary_order_protocol() {
+    printf("Testing binary order protocol... ");
+    
+    uint8_t buffer[16 * MSG_MAX_SIZE];
+    size_t length = 0;
+    OrderMessage message;
+    
+    // Round trip of a replace, the largest frame
+    memset(&message, 0, sizeof(message));
+    message.type = MSG_REPLACE;
+    message.side = SELL;
+    message.symbol_index = 7;
+    message.order_id = 42;
+    message.new_order_id = 43;
+    message.price = 15025;
+    message.quantity = 300;
+    message.order_type = IOC;
+    message.stp = STP_DECREMENT;
+    assert(encode_order_message(&message, buffer) == MSG_REPLACE_SIZE);
+    assert(buffer[0] == MSG_REPLACE_SIZE && buffer[1] == 0 && buffer[2] == 'R');
+    OrderMessage decoded;
+    assert(decode_order_message(buffer, MSG_REPLACE_SIZE - 1, &decoded) == 0);
+    assert(decode_order_message(buffer, MSG_REPLACE_SIZE, &decoded) == MSG_REPLACE_SIZE);
+    assert(decoded.type == MSG_REPLACE && decoded.side == SELL && decoded.symbol_index == 7);
+    assert(decoded.order_id == 42 && decoded.new_order_id == 43);
+    assert(decoded.price == 15025 && decoded.quantity == 300 && decoded.order_type == IOC);
+    assert(decoded.stp == STP_DECREMENT);
+    buffer[29] = STP_DECREMENT + 1;
+    assert(decode_order_message(buffer, MSG_REPLACE_SIZE, &decoded) == -1);
+    
+    // A session: bind a symbol, rest two bids, cross one, then cancel, modify and replace
+    memset(&message, 0, sizeof(message));
+    message.type = MSG_SYMBOL;
+    strcpy(message.symbol, "AAPL");
+    length += encode_order_message(&message, buffer + length);
+    
+    message.type = MSG_NEW_ORDER;
+    message.side = BUY;
+    message.price = 15000;
+    message.quantity = 100;
+    for (uint64_t id = 1; id <= 3; id++) {
+        message.order_id = id;
+        length += encode_order_message(&message, buffer + length);
+    }
+    message.order_id = 10;
+    message.side = SELL;
+    message.quantity = 150;
+    length += encode_order_message(&message, buffer + length);
+    
+    message.type = MSG_CANCEL;
+    message.order_id = 3;
+    length += encode_order_message(&message, buffer + length);
+    
+    message.type = MSG_MODIFY;
+    message.order_id = 2;
+    message.quantity = 70;
+    message.price = 15000;
+    length += encode_order_message(&message, buffer + length);
+    
+    // The replacement belongs to the account bound before it
+    message.type = MSG_ACCOUNT;
+    message.owner = 5;
+    length += encode_order_message(&message, buffer + length);
+    message.type = MSG_REPLACE;
+    message.side = BUY;
+    message.order_id = 2;
+    message.new_order_id = 20;
+    message.price = 14990;
+    message.quantity = 60;
+    length += encode_order_message(&message, buffer + length);
+    
+    // A frame with an unknown type is skipped, a partial frame is left for the next read
+    uint8_t* bad = buffer + length;
+    memset(bad, 0, MSG_CANCEL_SIZE);
+    bad[0] = MSG_CANCEL_SIZE;
+    bad[2] = 'Z';
+    length += MSG_CANCEL_SIZE;
+    message.type = MSG_CANCEL;
+    message.order_id = 20;
+    encode_order_message(&message, buffer + length);
+    
+    SymbolRegistry* registry = create_symbol_registry(16, 1024, 1024);
+    assert(process_order_messages(registry, buffer, length + 5) == length);
+    
+    OrderBook* book = registry_find_book(registry, "AAPL");
+    assert(book != NULL);
+    assert(find_order_by_id(book, "1") == NULL);
+    assert(find_order_by_id(book, "2") == NULL);
+    assert(find_order_by_id(book, "3") == NULL);
+    assert(find_order_by_id(book, "20")->quantity == 60);
+    assert(find_order_by_id(book, "20")->owner == 5 && registry->entry_owner == 5);
+    assert(book->pool.live_count == 1);
+    assert(best_price_level(book, BUY)->price == 14990);
+    assert(best_price_level(book, SELL) == NULL);
+    
+    // A replacement that would be turned away leaves the original resting
+    message.type = MSG_NEW_ORDER;
+    message.order_id = 30;
+    message.price = 14980;
+    message.quantity = 10;
+    assert(registry_apply_message(registry, &message) == 0);
+    message.type = MSG_REPLACE;
+    message.order_id = 20;
+    message.new_order_id = 30;
+    assert(registry_apply_message(registry, &message) == -1);       // Duplicate ID
+    message.new_order_id = 21;
+    message.side = SELL;
+    assert(registry_apply_message(registry, &message) == -1);       // Side change
+    message.side = BUY;
+    message.order_type = FOK;
+    assert(registry_apply_message(registry, &message) == -1);       // Cannot fill
+    message.order_id = 99;
+    message.order_type = LIMIT;
+    assert(registry_apply_message(registry, &message) == -1);       // No such order
+    assert(find_order_by_id(book, "20")->quantity == 60 && find_order_by_id(book, "21") == NULL);
+    assert(find_order_by_id(book, "30")->quantity == 10 && book->pool.live_count == 2);
+    
+    // An IOC whose remainder is cancelled was applied, traded or not
+    message.type = MSG_ACCOUNT;
+    message.owner = 6;
+    assert(registry_apply_message(registry, &message) == 0);
+    message.type = MSG_NEW_ORDER;
+    message.side = SELL;
+    message.order_type = IOC;
+    message.order_id = 40;
+    message.price = 15000;
+    message.quantity = 5;
+    assert(registry_apply_message(registry, &message) == 0);
+    message.order_id = 41;
+    message.price = 14980;
+    message.quantity = 100;
+    assert(registry_apply_message(registry, &message) == 0);
+    assert(book->pool.live_count == 0 && book->counters.traded_quantity == 150 + 70);
+    
+    // Numeric IDs are formatted as the decimal strings the book is keyed by
+    char id[MAX_ID_LENGTH];
+    format_order_id(0, id);
+    assert(strcmp(id, "0") == 0);
+    format_order_id(MAX_NUMERIC_ORDER_ID, id);
+    assert(strcmp(id, "999999999999999") == 0);
+    
+    free_symbol_registry(registry);
+    printf("PASSED\n");
+}
+
+void test_journal_recovery() {
+    printf("Testing journal recovery... ");
+    
+    const char* filename = "journal_test.log";
+    remove(filename);
+    
+    // Journal a session across two symbols with fills, cancels and modifies
+    SymbolRegistry* registry = create_symbol_registry(16, 1024, 1024);
+    uint64_t next_sequence, executions;
+    assert(recover_from_journal(registry, filename, 0, &next_sequence, &executions) == 0);
+    Journal* journal = open_journal(filename, 256, JOURNAL_SYNC_NONE, next_sequence);
+    assert(journal != NULL);
+    registry_attach_outputs(registry, NULL, journal, NULL);
+    
+    char id[MAX_ID_LENGTH];
+    for (int i = 0; i < 40; i++) {
+        Order order = {0};
+        snprintf(id, sizeof(id), "O%d", i);
+        strcpy(order.id, id);
+        strcpy(order.symbol, (i % 2) ? "AAPL" : "MSFT");
+        order.side = (i % 3 == 0) ? SELL : BUY;
+        order.type = LIMIT;
+        order.price = 10000 + (i % 7) * 5;
+        order.quantity = 10 + i;
+        registry_add_order(registry, &order);
+    }
+    registry_cancel_order(registry, "AAPL", "O1");
+    assert(registry_modify_order(registry, "AAPL", "O1", 5, 10010) == -1);   // Not journaled
+    assert(registry_modify_order(registry, "AAPL", "O7", 7, 10010) == 0);
+    assert(registry_modify_order(registry, "MSFT", "O22", 3, 10020) == 0);
+    
+    // A cancel/replace is one record
+    Order replacement = {0};
+    strcpy(replacement.id, "R7");
+    strcpy(replacement.symbol, "AAPL");
+    replacement.side = BUY;
+    replacement.type = LIMIT;
+    replacement.price = 10005;
+    replacement.quantity = 9;
+    assert(cancel_replace_order(registry_find_book(registry, "AAPL"), "O7", &replacement) != NULL);
+    assert(journal->commits > 0);
+    assert(close_journal(journal) == 0);
+    
+    // A torn record at the tail is dropped
+    FILE* file = fopen(filename, "ab");
+    fwrite("torn", 1, 4, file);
+    fclose(file);
+    
+    SymbolRegistry* recovered = create_symbol_registry(16, 1024, 1024);
+    assert(recover_from_journal(recovered, filename, 0, &next_sequence, &executions) == 44);
+    assert(next_sequence > 44);
+    assert(executions > 0 && executions == registry->books[0]->counters.trades + registry->books[1]->counters.trades);
+    assert(find_order_by_id(registry_find_book(recovered, "AAPL"), "O7") == NULL);
+    assert(find_order_by_id(registry_find_book(recovered, "AAPL"), "R7")->quantity == 9);
+    assert(recovered->book_count == 2);
+    
+    for (uint32_t b = 0; b < registry->book_count; b++) {
+        OrderBook* expected = registry->books[b];
+        OrderBook* book = registry_find_book(recovered, expected->symbol);
+        assert(book != NULL);
+        assert(book->pool.live_count == expected->pool.live_count);
+        assert(book->bids.level_count == expected->bids.level_count);
+        assert(book->asks.level_count == expected->asks.level_count);
+        for (int i = 0; i < 40; i++) {
+            snprintf(id, sizeof(id), "O%d", i);
+            RestingOrder* a = find_order_by_id(expected, id);
+            RestingOrder* r = find_order_by_id(book, id);
+            assert((a == NULL) == (r == NULL));
+            if (a != NULL) {
+                assert(order_info(expected, a)->price == order_info(book, r)->price && a->quantity == r->quantity);
+                assert(a->owner == r->owner && a->stp == r->stp);
+                assert(a->filled_quantity == r->filled_quantity);
+                assert(order_info(expected, a)->sequence == order_info(book, r)->sequence);
+                assert(order_info(expected, a)->timestamp_ns == order_info(book, r)->timestamp_ns);
+            }
+        }
+    }
+    
+    // Appending resumes the sequence after the recovered records
+    journal = open_journal(filename, 256, JOURNAL_SYNC_BATCH, next_sequence);
+    registry_attach_outputs(recovered, NULL, journal, NULL);
+    registry_cancel_order(recovered, "MSFT", "O0");
+    assert(close_journal(journal) == 0);
+    free_symbol_registry(recovered);
+    
+    recovered = create_symbol_registry(16, 1024, 1024);
+    assert(recover_from_journal(recovered, filename, 0, &next_sequence, &executions) == 45);
+    assert(find_order_by_id(registry_find_book(recovered, "MSFT"), "O0") == NULL);
+    
+    remove(filename);
+    free_symbol_registry(recovered);
+    free_symbol_registry(registry);
+    printf("PASSED\n");
+}
+
+// Round a snapshot section size up to the section alignment
+static size_t snapshot_aligned(size_t bytes) {
+    return (bytes + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+void test_snapshot_restore() {
+    printf("Testing snapshot restore... ");
+    
+    const char* snapshot_name = "snapshot_test.snap";
+    const char* journal_name = "snapshot_test.log";
+    remove(journal_name);
+    
+    // Build two books with queues, partial fills and freed slots, journaling throughout
+    SymbolRegistry* registry = create_symbol_registry(16, 256, 1024);
+    Journal* journal = open_journal(journal_name, 4096, JOURNAL_SYNC_NONE, 0);
+    registry_attach_outputs(registry, NULL, journal, NULL);
+    char id[MAX_ID_LENGTH];
+    for (int i = 0; i < 60; i++) {
+        Order order = {0};
+        snprintf(id, sizeof(id), "O%d", i);
+        strcpy(order.id, id);
+        strcpy(order.symbol, (i % 2) ? "AAPL" : "MSFT");
+        order.side = (i % 3 == 0) ? SELL : BUY;
+        order.type = LIMIT;
+        order.price = 10000 + (i % 5) * 10;
+        order.quantity = 5 + i;
+        registry_add_order(registry, &order);
+    }
+    registry_cancel_order(registry, "AAPL", "O7");
+    Order stop = {0};
+    strcpy(stop.id, "STP");
+    strcpy(stop.symbol, "MSFT");
+    stop.side = BUY;
+    stop.type = STOP_LIMIT;
+    stop.price = 12000;
+    stop.stop_price = 12000;
+    stop.quantity = 3;
+    registry_add_order(registry, &stop);
+    journal_commit(journal);
+    assert(save_snapshot(registry, snapshot_name, journal->next_sequence, 0) == 0);
+    
+    // Records after the snapshot only reach the restored books through the journal
+    Order late = {0};
+    strcpy(late.id, "LATE");
+    strcpy(late.symbol, "AAPL");
+    late.side = SELL;
+    late.type = LIMIT;
+    late.price = 9990;
+    late.quantity = 12;
+    registry_add_order(registry, &late);
+    assert(close_journal(journal) == 0);
+    
+    SymbolRegistry* restored = create_symbol_registry(16, 1024, 64);
+    uint64_t journal_sequence, exec_sequence, next_sequence, executions;
+    assert(load_snapshot(restored, snapshot_name, &journal_sequence, &exec_sequence) == 0);
+    assert(restored->book_count == 2 && restored->orders_per_book == 256);
+    assert(recover_from_journal(restored, journal_name, journal_sequence, &next_sequence, &executions) == 1);
+    assert(executions == 1);
+    
+    for (uint32_t b = 0; b < registry->book_count; b++) {
+        OrderBook* expected = registry->books[b];
+        OrderBook* book = registry_find_book(restored, expected->symbol);
+        assert(book != NULL);
+        assert(book->pool.live_count == expected->pool.live_count);
+        assert(book->bids.level_count == expected->bids.level_count);
+        assert(book->asks.level_count == expected->asks.level_count);
+        
+        // Queues come back in the same FIFO order
+        for (int side = 0; side < 2; side++) {
+            PriceLevel* a = best_price_level(expected, (OrderSide)side);
+            PriceLevel* r = best_price_level(book, (OrderSide)side);
+            assert((a == NULL) == (r == NULL));
+            if (a == NULL) {
+                continue;
+            }
+            assert(a->price == r->price && a->total_quantity == r->total_quantity);
+            for (uint32_t sa = a->head, sr = r->head; sa != NO_ORDER; ) {
+                assert(strcmp(expected->pool.info[sa].id, book->pool.info[sr].id) == 0);
+                sa = expected->pool.orders[sa].next;
+                sr = book->pool.orders[sr].next;
+            }
+        }
+    }
+    
+    // Armed stops come back in their heap
+    OrderBook* msft = registry_find_book(restored, "MSFT");
+    assert(msft->buy_stops.count == 1 && find_order_by_id(msft, "STP") != NULL);
+    assert(cancel_order(msft, "STP") == 0 && msft->buy_stops.count == 0);
+    
+    // The restored books keep trading and reusing slots
+    OrderBook* aapl = registry_find_book(restored, "AAPL");
+    assert(find_order_by_id(aapl, "O7") == NULL);
+    assert(cancel_order(aapl, "O1") == 0);
+    Order order = {0};
+    strcpy(order.id, "NEW");
+    strcpy(order.symbol, "AAPL");
+    order.side = BUY;
+    order.type = LIMIT;
+    order.price = 10000;
+    order.quantity = 1;
+    assert(add_order(aapl, &order) != NULL);
+    
+    // A ladder bound or queue link outside the book is refused
+    FILE* file = fopen(snapshot_name, "rb");
+    fseek(file, 0, SEEK_END);
+    size_t snapshot_size = (size_t)ftell(file);
+    uint8_t* snapshot = malloc(snapshot_size);
+    rewind(file);
+    assert(fread(snapshot, 1, snapshot_size, file) == snapshot_size);
+    fclose(file);
+    size_t book_offset = snapshot_aligned(sizeof(SnapshotHeader));
+    SnapshotBook entry;
+    memcpy(&entry, snapshot + book_offset, sizeof(entry));
+    size_t pool_offset = book_offset + snapshot_aligned(sizeof(SnapshotBook));
+    size_t level_offset = pool_offset + snapshot_aligned(entry.pool_capacity * sizeof(RestingOrder)) +
+        snapshot_aligned(entry.pool_capacity * sizeof(OrderInfo)) + (size_t)entry.bid_high * sizeof(PriceLevel);
+    PriceLevel best_bid;
+    memcpy(&best_bid, snapshot + level_offset, sizeof(best_bid));
+    assert(best_bid.order_count > 0);
+    size_t patches[3] = {book_offset + offsetof(SnapshotBook, bid_high), level_offset + offsetof(PriceLevel, tail),
+                         pool_offset + best_bid.head * sizeof(RestingOrder) + offsetof(RestingOrder, next)};
+    const char* corrupt_name = "snapshot_test_corrupt.snap";
+    for (int i = 0; i < 3; i++) {
+        uint32_t original, bad = 4096;
+        memcpy(&original, snapshot + patches[i], sizeof(original));
+        memcpy(snapshot + patches[i], &bad, sizeof(bad));
+        file = fopen(corrupt_name, "wb");
+        assert(fwrite(snapshot, 1, snapshot_size, file) == snapshot_size);
+        fclose(file);
+        memcpy(snapshot + patches[i], &original, sizeof(original));
+        SymbolRegistry* corrupt = create_symbol_registry(16, 256, 1024);
+        assert(load_snapshot(corrupt, corrupt_name, &journal_sequence, &exec_sequence) == -1);
+        free_symbol_registry(corrupt);
+    }
+    remove(corrupt_name);
+    free(snapshot);
+    
+    // A snapshot from an incompatible build or a truncated file is refused
+    file = fopen(snapshot_name, "r+b");
+    fseek(file, 0, SEEK_SET);
+    fputc('X', file);
+    fclose(file);
+    SymbolRegistry* rejected = create_symbol_registry(16, 256, 1024);
+    assert(load_snapshot(rejected, snapshot_name, &journal_sequence, &exec_sequence) == -1);
+    
+    remove(snapshot_name);
+    remove(journal_name);
+    free_symbol_registry(rejected);
+    free_symbol_registry(restored);
+    free_symbol_registry(registry);
+    printf("PASSED\n");
+}
+
+void test_latency_histogram() {
+    printf("Testing latency histogram... ");
+    
+    Histogram histogram, other;
+    histogram_reset(&histogram);
+    histogram_reset(&other);
+    
+    // Small values are recorded exactly
+    for (uint64_t v = 1; v <= 100; v++) {
+        histogram_record(&histogram, v);
+    }
+    assert(histogram.count == 100);
+    assert(histogram.min == 1 && histogram.max == 100);
+    assert(histogram_percentile(&histogram, 50.0) == 50);
+    assert(histogram_percentile(&histogram, 100.0) == 100);
+    
+    // Large values keep their relative precision
+    histogram_record(&other, 1000000);
+    histogram_merge(&histogram, &other);
+    assert(histogram.count == 101);
+    assert(histogram.max == 1000000);
+    uint64_t p999 = histogram_percentile(&histogram, 99.9);
+    assert(p999 <= 1000000 && p999 >= 1000000 - 1000000 / 64);
+    
+    printf("PASSED\n");
+}
+
+void test_stats() {
+    printf("Testing stats... ");
+    
+    SymbolRegistry* registry = create_symbol_registry(16, 64, 256);
+    FILE* sink = tmpfile();
+    EngineStats* stats = create_engine_stats(registry, sink, 3600000000000ULL);
+    registry_attach_stats(registry, stats);
+    OrderBook* book = registry_get_book(registry, "TEST");
+    assert(book->stats == stats && ((uintptr_t)stats % CACHE_LINE_SIZE) == 0);
+    
+    // Levels and high-water marks follow the orders that rest
+    rest_limit(book, "B1", BUY, 10000, 10);
+    rest_limit(book, "B2", BUY, 10000, 10);
+    rest_limit(book, "B3", BUY, 9990, 10);
+    rest_limit(book, "S1", SELL, 10010, 10);
+    const BookCounters* counters = &book->counters;
+    assert(counters->adds == 4 && counters->levels_created == 3);
+    assert(counters->max_queue_depth == 2 && counters->max_levels == 2 && counters->max_live_orders == 4);
+    
+    // A sell through the bid level empties it and rests its remainder on a new level
+    Order order = {0};
+    strcpy(order.id, "S2");
+    strcpy(order.symbol, "TEST");
+    order.side = SELL;
+    order.type = LIMIT;
+    order.price = 10000;
+    order.quantity = 25;
+    assert(add_order(book, &order) != NULL);
+    assert(counters->trades == 2 && counters->traded_quantity == 20 && counters->levels_created == 4);
+    assert(book->bids.level_count + book->asks.level_count == 3);
+    
+    // Only cancels and modifies of live orders count
+    assert(cancel_order(book, "B3") == 0 && cancel_order(book, "B3") == -1);
+    assert(modify_order(book, "S1", 5, 10010) == 0 && modify_order(book, "B3", 5, 10010) == -1);
+    assert(counters->cancels == 1 && counters->modifies == 1);
+    
+    // Duplicate IDs and risk rejections are rejects, not adds
+    assert(add_order(book, &order) == NULL && counters->rejects == 1);
+    RiskLimits limits = {0};
+    limits.max_quantity = 10;
+    RiskGate* gate = create_risk_gate(4, &limits);
+    registry_attach_risk_gate(registry, gate);
+    strcpy(order.id, "S3");
+    assert(add_order(book, &order) == NULL && order.status == REJECTED);
+    assert(counters->rejects == 2 && counters->adds == 5);
+    
+    // Every command but the rejected add was timed through matching and
+    // publishing; only that add through the risk stage
+    assert(stats->stages[STAGE_MATCH].count == 10 && stats->stages[STAGE_PUBLISH].count == 10);
+    assert(stats->stages[STAGE_RISK].count == 1 && stats->stages[STAGE_DECODE].count == 0);
+    
+    // Decoding is timed per frame
+    uint8_t buffer[MSG_MAX_SIZE];
+    OrderMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = MSG_SYMBOL;
+    strcpy(message.symbol, "TEST");
+    size_t length = encode_order_message(&message, buffer);
+    assert(process_order_messages(registry, buffer, length) == length);
+    assert(stats->stages[STAGE_DECODE].count == 1);
+    
+    // A dump was written on the first command, the next is due an interval of event time later
+    assert(stats->dumps == 1);
+    stamp_next_event(book, 1000, stats->next_dump_ns - 1);
+    cancel_order(book, "S1");
+    assert(stats->dumps == 1);
+    stamp_next_event(book, 1001, stats->next_dump_ns);
+    cancel_order(book, "S2");
+    assert(stats->dumps == 2);
+    
+    // Each dump is one JSON line with the stages and every book
+    char line[2048];
+    rewind(sink);
+    assert(fgets(line, sizeof(line), sink) != NULL && line[strlen(line) - 1] == '\n');
+    assert(strstr(line, "\"match\":{\"count\":1,") != NULL);
+    assert(fgets(line, sizeof(line), sink) != NULL);
+    assert(strstr(line, "\"symbol\":\"TEST\",\"adds\":5,\"cancels\":3,") != NULL);
+    assert(strstr(line, "\"levels_created\":4,\"levels_destroyed\":4,") != NULL);
+    assert(fgets(line, sizeof(line), sink) == NULL);
+    
+    registry_attach_risk_gate(registry, NULL);
+    free_risk_gate(gate);
+    free_symbol_registry(registry);
+    free_engine_stats(stats);
+    fclose(sink);
+    
+    printf("PASSED\n");
+}
+
 int main() {
     printf("=== ORDER BOOK TESTS ===\n");
     
@@ -254,9 +2161,35 @@ int main() {
     test_match_orders();
     test_cancel_order();
     test_modify_order();
+    test_replace_priority();
     test_fifo_matching();
     test_price_time_priority();
+    test_price_ladder_recentering();
+    test_level_queue_cancel();
+    test_order_index();
+    test_order_pool_reuse();
+    test_sweep_multiple_levels();
+    test_zero_quantity_orders();
+    test_order_types();
+    test_stop_orders();
+    test_iceberg_orders();
+    test_self_trade_prevention();
+    test_risk_gate();
+    test_call_auction();
+    test_market_data();
+    test_quote_view();
+    test_exec_report_ring();
+    test_exec_report_consumer_thread();
+    test_event_sequencing();
+    test_symbol_registry();
+    test_sharded_engine();
+    test_latency_histogram();
+    test_stats();
+    test_bulk_csv_loader();
+    test_binary_order_protocol();
+    test_journal_recovery();
+    test_snapshot_restore();
     
     printf("=== ALL TESTS PASSED ===\n");
     return 0;
-}
\ No newline at end of file
+}